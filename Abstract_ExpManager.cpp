@@ -8,17 +8,28 @@
 
 /**
  * Create stats and backup directory
+ *
+ * @param prefix : Empty, or the directory (ending with a '/') in which they are created
  */
-void Abstract_ExpManager::create_directory() {
+void Abstract_ExpManager::create_directory(const std::string &prefix) {
+    if (!prefix.empty()) {
+        int status = mkdir(prefix.c_str(), 0755);
+        if (status == -1 && errno != EEXIST) {
+            err(EXIT_FAILURE, "%s", prefix.c_str());
+        }
+    }
+
     // Backup
-    int status = mkdir("backup", 0755);
+    std::string backup = prefix + "backup";
+    int status = mkdir(backup.c_str(), 0755);
     if (status == -1 && errno != EEXIST) {
-        err(EXIT_FAILURE, "backup");
+        err(EXIT_FAILURE, "%s", backup.c_str());
     }
 
     // Stats
-    status = mkdir("stats", 0755);
+    std::string stats = prefix + "stats";
+    status = mkdir(stats.c_str(), 0755);
     if (status == -1 && errno != EEXIST) {
-        err(EXIT_FAILURE, "stats");
+        err(EXIT_FAILURE, "%s", stats.c_str());
     }
-}
\ No newline at end of file
+}
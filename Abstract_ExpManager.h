@@ -6,23 +6,36 @@
 
 
 #include <memory>
+#include <string>
 #include "Threefry.h"
 #include "DnaMutator.h"
 #include "Organism.h"
 #include "Stats.h"
+#include "TrajectoryChecker.h"
 
 class Abstract_ExpManager {
 
 public:
     virtual ~Abstract_ExpManager() = default;
 
-    static void create_directory();
+    /// Create the backup and stats directories under a prefix (empty, or a directory ending with a '/' that is also
+    /// created)
+    static void create_directory(const std::string &prefix = "");
 
     virtual void save(int t) const = 0;
 
     virtual void load(int t) = 0;
 
     virtual void run_evolution(int nb_gen) = 0;
+
+    /**
+     * Record or verify the trajectory of run_evolution (the first evaluation and every generation) with checker,
+     * which is not owned. run_evolution exits at the first divergence.
+     */
+    void set_trajectory_checker(TrajectoryChecker *checker) { trajectory_checker_ = checker; }
+
+protected:
+    TrajectoryChecker *trajectory_checker_ = nullptr;
 };
 
 
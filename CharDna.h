@@ -0,0 +1,62 @@
+//
+// Created by arrouan on 01/10/18.
+//
+
+#pragma once
+
+#include <vector>
+#include <zlib.h>
+
+#include "Threefry.h"
+#include "aevol_constants.h"
+
+/**
+ * Reference genome with one ASCII '0'/'1' byte per base.
+ *
+ * This is the original representation of Dna, kept to compare results and performance against the packed Dna.
+ * It is not used by the simulation itself.
+ */
+class CharDna {
+
+public:
+    CharDna() = default;
+
+    CharDna(const CharDna &clone) = default;
+
+    CharDna(int length, Threefry::Gen &&rng);
+
+    ~CharDna() = default;
+
+    int length() const;
+
+    void save(gzFile backup_file);
+
+    void load(gzFile backup_file);
+
+    void set(int pos, char c);
+
+    /// Remove the DNA inbetween pos_1 and pos_2
+    void remove(int pos_1, int pos_2);
+
+    /// Insert a sequence of a given length at a given position into the DNA of the Organism
+    void insert(int pos, std::vector<char> seq);
+
+    /// Insert a sequence of a given length at a given position into the DNA of the Organism
+    void insert(int pos, CharDna *seq);
+
+    void do_switch(int pos);
+
+    void do_duplication(int pos_1, int pos_2, int pos_3);
+
+    int promoter_at(int pos);
+
+    int terminator_at(int pos);
+
+    bool shine_dal_start(int pos);
+
+    bool protein_stop(int pos);
+
+    int codon_at(int pos);
+
+    std::vector<char> seq_;
+};
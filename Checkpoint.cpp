@@ -0,0 +1,858 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "Checkpoint.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+namespace {
+    // "AEVC": start of a backup in a chunked format (a gzip backup starts with its positive time instead)
+    constexpr int32_t CHUNKED_MAGIC = 0x43564541;
+    // Version 2 added the reference of a delta, version 1 backups are still read
+    constexpr int32_t CHUNKED_VERSION = 2;
+
+    /// Marker of a delta record in a block of a chunked backup (a packed genome starts with its negative length)
+    constexpr int32_t DELTA_RECORD = 0;
+
+    /// Longest chain of deltas read to restore a backup (only reached through corrupted references)
+    constexpr int MAX_DELTA_DEPTH = 1 << 10;
+
+    /// Number of organisms of a block of a chunked backup
+    constexpr int ORGANISMS_PER_BLOCK = 256;
+
+    // "AEVM": start of a mapped backup
+    constexpr int32_t MAPPED_MAGIC = 0x4d564541;
+    constexpr int32_t MAPPED_VERSION = 1;
+
+    /// Alignment of the sections of a mapped backup, and of each genome
+    constexpr uint64_t PAGE_ALIGNMENT = 4096;
+    constexpr uint64_t GENOME_ALIGNMENT = 64;
+
+    /// Entry of the genome table of a mapped backup
+    struct GenomeIndex {
+        uint64_t offset;
+        int32_t length;
+        int32_t reserved;
+    };
+
+    inline uint64_t align(uint64_t offset, uint64_t alignment) {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    /// Write zeros up to offset, false on a write error
+    bool pad(FILE *file, uint64_t &position, uint64_t offset) {
+        static const char zeros[PAGE_ALIGNMENT] = {};
+        while (position < offset) {
+            size_t nb = std::min<uint64_t>(offset - position, PAGE_ALIGNMENT);
+            if (fwrite(zeros, 1, nb, file) != nb) return false;
+            position += nb;
+        }
+        return true;
+    }
+
+    /// Entry of the index of a chunked backup
+    struct BlockIndex {
+        uint64_t offset;
+        uint64_t compressed_size;
+        uint64_t raw_size;
+    };
+
+    template<typename T>
+    void append(std::vector<char> &buffer, const T *values, size_t nb) {
+        const char *bytes = reinterpret_cast<const char *>(values);
+        buffer.insert(buffer.end(), bytes, bytes + nb * sizeof(T));
+    }
+
+    template<typename T>
+    void append(std::vector<char> &buffer, const T &value) {
+        append(buffer, &value, 1);
+    }
+
+    bool compress_block(Checkpoint::Format format, const std::vector<char> &raw, std::vector<char> &compressed) {
+        switch (format) {
+            case Checkpoint::CHUNKED_ZLIB: {
+                uLongf size = compressBound(raw.size());
+                compressed.resize(size);
+                // The level of the gzip backups: the clones of a block compress well
+                if (compress2((Bytef *) compressed.data(), &size, (const Bytef *) raw.data(), raw.size(),
+                              Z_DEFAULT_COMPRESSION) != Z_OK)
+                    return false;
+                compressed.resize(size);
+                return true;
+            }
+#ifdef HAVE_ZSTD
+            case Checkpoint::CHUNKED_ZSTD: {
+                compressed.resize(ZSTD_compressBound(raw.size()));
+                size_t size = ZSTD_compress(compressed.data(), compressed.size(), raw.data(), raw.size(), 1);
+                if (ZSTD_isError(size)) return false;
+                compressed.resize(size);
+                return true;
+            }
+#endif
+#ifdef HAVE_LZ4
+            case Checkpoint::CHUNKED_LZ4: {
+                compressed.resize(LZ4_compressBound(raw.size()));
+                int size = LZ4_compress_default(raw.data(), compressed.data(), raw.size(), compressed.size());
+                if (size <= 0) return false;
+                compressed.resize(size);
+                return true;
+            }
+#endif
+            default:
+                return false;
+        }
+    }
+
+    bool decompress_block(Checkpoint::Format format, const std::vector<char> &compressed, std::vector<char> &raw) {
+        switch (format) {
+            case Checkpoint::CHUNKED_ZLIB: {
+                uLongf size = raw.size();
+                return uncompress((Bytef *) raw.data(), &size, (const Bytef *) compressed.data(),
+                                  compressed.size()) == Z_OK && size == raw.size();
+            }
+#ifdef HAVE_ZSTD
+            case Checkpoint::CHUNKED_ZSTD: {
+                size_t size = ZSTD_decompress(raw.data(), raw.size(), compressed.data(), compressed.size());
+                return !ZSTD_isError(size) && size == raw.size();
+            }
+#endif
+#ifdef HAVE_LZ4
+            case Checkpoint::CHUNKED_LZ4: {
+                int size = LZ4_decompress_safe(compressed.data(), raw.data(), compressed.size(), raw.size());
+                return size >= 0 && (size_t) size == raw.size();
+            }
+#endif
+            default:
+                return false;
+        }
+    }
+
+    /// Sequential and positioned reads of a file, that remember whether one of them failed
+    class FileReader {
+    public:
+        explicit FileReader(int fd) : fd_(fd) {}
+
+        bool ok() const { return ok_; }
+
+        uint64_t offset() const { return offset_; }
+
+        template<typename T>
+        void read(T *values, size_t nb) {
+            ok_ = ok_ && read_at(offset_, values, nb * sizeof(T));
+            offset_ += nb * sizeof(T);
+        }
+
+        template<typename T>
+        T read() {
+            T value{};
+            read(&value, 1);
+            return value;
+        }
+
+        /// Read size bytes at offset, whatever the current one (can be called concurrently)
+        bool read_at(uint64_t offset, void *dest, size_t size) const {
+            char *bytes = static_cast<char *>(dest);
+            while (size > 0) {
+                ssize_t nb = pread(fd_, bytes, size, offset);
+                if (nb <= 0) return false;
+                bytes += nb;
+                offset += nb;
+                size -= nb;
+            }
+            return true;
+        }
+
+    private:
+        int fd_;
+        uint64_t offset_ = 0;
+        bool ok_ = true;
+    };
+}
+
+bool Checkpoint::format_available(Format format) {
+    switch (format) {
+        case GZIP:
+        case CHUNKED_ZLIB:
+        case MAPPED:
+            return true;
+#ifdef HAVE_ZSTD
+        case CHUNKED_ZSTD:
+            return true;
+#endif
+#ifdef HAVE_LZ4
+        case CHUNKED_LZ4:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+std::vector<std::array<int32_t, 2>> Checkpoint::parameters() const {
+    std::vector<std::array<int32_t, 2>> parameters = {{SELECTION_SCHEME, selection_scheme},
+                                                      {SELECTION_RADIUS, selection_radius}};
+    // A backup of the whole grid has no FIRST_CELL parameter
+    if (first_cell >= 0)
+        parameters.push_back({FIRST_CELL, first_cell});
+    // Nor one of switches only a rearrangement rate
+    if (rearrangement_rate != 0.0) {
+        uint64_t bits;
+        memcpy(&bits, &rearrangement_rate, sizeof(bits));
+        parameters.push_back({REARRANGEMENT_RATE_LOW, (int32_t) (uint32_t) bits});
+        parameters.push_back({REARRANGEMENT_RATE_HIGH, (int32_t) (uint32_t) (bits >> 32)});
+    }
+    return parameters;
+}
+
+void Checkpoint::set_parameter(const int32_t parameter[2]) {
+    switch (parameter[0]) {
+        case SELECTION_SCHEME:
+            selection_scheme = static_cast<SelectionScheme>(parameter[1]);
+            break;
+        case SELECTION_RADIUS:
+            selection_radius = parameter[1];
+            break;
+        case FIRST_CELL:
+            first_cell = parameter[1];
+            break;
+        case REARRANGEMENT_RATE_LOW:
+        case REARRANGEMENT_RATE_HIGH: {
+            uint64_t bits;
+            memcpy(&bits, &rearrangement_rate, sizeof(bits));
+            int shift = parameter[0] == REARRANGEMENT_RATE_LOW ? 0 : 32;
+            bits = (bits & ~(uint64_t{0xffffffff} << shift)) | (uint64_t{(uint32_t) parameter[1]} << shift);
+            memcpy(&rearrangement_rate, &bits, sizeof(bits));
+            break;
+        }
+        default:
+            // Unknown parameters are skipped
+            break;
+    }
+}
+
+bool Checkpoint::write(const char *file_name, const std::atomic<bool> *cancel) const {
+    const std::string tmp_file_name = std::string(file_name) + ".tmp";
+
+    if (first_cell >= 0 && (format == GZIP || format == MAPPED)) {
+        fprintf(stderr, "Error: the shard %s can only be written in a chunked format\n", file_name);
+        return false;
+    }
+
+    bool success;
+    switch (format) {
+        case GZIP:
+            success = write_gzip(tmp_file_name.c_str(), cancel);
+            break;
+        case MAPPED:
+            success = write_mapped(tmp_file_name.c_str(), cancel);
+            break;
+        default:
+            success = write_chunked(tmp_file_name.c_str(), cancel);
+    }
+    if (!success) {
+        remove(tmp_file_name.c_str());
+        return false;
+    }
+
+    if (rename(tmp_file_name.c_str(), file_name) != 0) {
+        fprintf(stderr, "Error: could not rename %s to %s\n", tmp_file_name.c_str(), file_name);
+        remove(tmp_file_name.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Gzip format (native byte order), a single gzip stream of:
+ *  - int32 time, grid_height, grid_width, backup_step
+ *  - double mutation_rate, FUZZY_SAMPLING doubles of the target
+ *  - the genomes (see Dna::save(gzFile)), in the packed format or, in older backups, in the legacy one char per base
+ *    format (see Dna::load(gzFile)). Both can be mixed in the same file.
+ *  - the PRNG state (see Threefry::save)
+ *  - the parameter block (PARAMETERS_MAGIC, number of parameters, (key, value) int32 pairs), absent from older
+ *    backups
+ */
+bool Checkpoint::write_gzip(const char *file_name, const std::atomic<bool> *cancel) const {
+    gzFile backup_file = gzopen(file_name, "w");
+    if (backup_file == Z_NULL) {
+        fprintf(stderr, "Error: could not open backup file %s\n", file_name);
+        return false;
+    }
+    // The genomes are written a few words at a time, compress them in larger blocks
+    gzbuffer(backup_file, 1 << 20);
+
+    gzwrite(backup_file, &time, sizeof(time));
+
+    gzwrite(backup_file, &grid_height, sizeof(grid_height));
+    gzwrite(backup_file, &grid_width, sizeof(grid_width));
+
+    gzwrite(backup_file, &backup_step, sizeof(backup_step));
+
+    gzwrite(backup_file, &mutation_rate, sizeof(mutation_rate));
+
+    gzwrite(backup_file, target.data(), target.size() * sizeof(target[0]));
+
+    bool cancelled = false;
+    for (const auto &organism: organisms) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            cancelled = true;
+            break;
+        }
+        organism->save(backup_file);
+    }
+
+    if (!cancelled) {
+        rng.save(backup_file);
+
+        auto parameters = this->parameters();
+        int32_t nb_parameters = parameters.size();
+        gzwrite(backup_file, &PARAMETERS_MAGIC, sizeof(PARAMETERS_MAGIC));
+        gzwrite(backup_file, &nb_parameters, sizeof(nb_parameters));
+        gzwrite(backup_file, parameters.data(), nb_parameters * sizeof(parameters[0]));
+    }
+
+    // A failed gzwrite leaves the error in the stream, and gzclose reports the errors of the last writes
+    int error;
+    gzerror(backup_file, &error);
+    int close_error = gzclose(backup_file);
+    if (error == Z_OK) error = close_error;
+
+    if (!cancelled && error != Z_OK)
+        fprintf(stderr, "Error while writing backup file %s (zlib error %d)\n", file_name, error);
+    return !cancelled && error == Z_OK;
+}
+
+/**
+ * Chunked format (native byte order):
+ *  - int32 CHUNKED_MAGIC, CHUNKED_VERSION, format, time, grid_height, grid_width, backup_step
+ *  - double mutation_rate, FUZZY_SAMPLING doubles of the target
+ *  - int32 seed, uint64 compressed size of the PRNG counters, then the compressed counters
+ *    (grid_height * grid_width * Threefry::NPHASES uint64, small integers that compress well)
+ *  - the parameter block of the gzip format (PARAMETERS_MAGIC, number of parameters, (key, value) pairs), with
+ *    FIRST_CELL for a shard
+ *  - int32 length of the name of the reference of a delta (0 for a full backup), then the name (since version 2)
+ *  - int32 number of organisms, ORGANISMS_PER_BLOCK, number of blocks
+ *  - the index: a BlockIndex per block (offset in the file, compressed size, uncompressed size)
+ *  - the compressed blocks. Uncompressed, a block is a record per organism:
+ *    - either its genome in the packed format of Dna::save,
+ *    - or, in a delta, int32 DELTA_RECORD, the index of its ancestor in the reference, the number of switched
+ *      positions and the positions. A delta record is only written when it is not larger than the packed genome.
+ */
+bool Checkpoint::write_chunked(const char *file_name, const std::atomic<bool> *cancel) const {
+    const int nb_organisms = organisms.size();
+    const int nb_blocks = (nb_organisms + ORGANISMS_PER_BLOCK - 1) / ORGANISMS_PER_BLOCK;
+
+    std::vector<std::vector<char>> blocks(nb_blocks);
+    std::vector<BlockIndex> index(nb_blocks);
+    std::vector<char> compressed_ok(nb_blocks, 0);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int block = 0; block < nb_blocks; block++) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) continue;
+
+        std::vector<char> raw;
+        std::vector<int32_t> positions;
+        int last = std::min(nb_organisms, (block + 1) * ORGANISMS_PER_BLOCK);
+        for (int indiv_id = block * ORGANISMS_PER_BLOCK; indiv_id < last; indiv_id++) {
+            const Dna &dna = *organisms[indiv_id]->dna_;
+            int32_t ancestor = reference_genomes ? reference_ids[indiv_id] : -1;
+            // A packed genome takes a bit per base (and 4 bytes), a delta record 32 bits per position (and 12 bytes)
+            if (ancestor >= 0 && dna.differences((*reference_genomes)[ancestor], dna.length() / 32 - 2, positions)) {
+                append(raw, DELTA_RECORD);
+                append(raw, ancestor);
+                append(raw, (int32_t) positions.size());
+                append(raw, positions.data(), positions.size());
+            } else {
+                dna.save(raw);
+            }
+        }
+
+        index[block].raw_size = raw.size();
+        compressed_ok[block] = compress_block(format, raw, blocks[block]);
+        index[block].compressed_size = blocks[block].size();
+    }
+
+    if (cancel && cancel->load(std::memory_order_relaxed)) return false;
+
+    std::vector<char> counters;
+    append(counters, rng.counters().data(), rng.counters().size());
+    std::vector<char> compressed_counters;
+    bool counters_ok = compress_block(format, counters, compressed_counters);
+
+    if (!counters_ok || std::find(compressed_ok.begin(), compressed_ok.end(), 0) != compressed_ok.end()) {
+        fprintf(stderr, "Error: could not compress backup file %s (format %d)\n", file_name, format);
+        return false;
+    }
+
+    std::vector<char> header;
+    append(header, CHUNKED_MAGIC);
+    append(header, CHUNKED_VERSION);
+    append(header, format);
+    append(header, time);
+    append(header, grid_height);
+    append(header, grid_width);
+    append(header, backup_step);
+    append(header, mutation_rate);
+    append(header, target.data(), target.size());
+
+    append(header, (int32_t) rng.get_seed());
+    append(header, (uint64_t) compressed_counters.size());
+    append(header, compressed_counters.data(), compressed_counters.size());
+
+    auto parameters = this->parameters();
+    append(header, PARAMETERS_MAGIC);
+    append(header, (int32_t) parameters.size());
+    append(header, parameters.data(), parameters.size());
+
+    append(header, (int32_t) reference_name.size());
+    append(header, reference_name.data(), reference_name.size());
+
+    append(header, (int32_t) nb_organisms);
+    append(header, (int32_t) ORGANISMS_PER_BLOCK);
+    append(header, (int32_t) nb_blocks);
+
+    uint64_t offset = header.size() + index.size() * sizeof(BlockIndex);
+    for (auto &entry: index) {
+        entry.offset = offset;
+        offset += entry.compressed_size;
+    }
+    append(header, index.data(), index.size());
+
+    FILE *backup_file = fopen(file_name, "wb");
+    if (backup_file == nullptr) {
+        fprintf(stderr, "Error: could not open backup file %s\n", file_name);
+        return false;
+    }
+
+    bool success = fwrite(header.data(), 1, header.size(), backup_file) == header.size();
+    for (const auto &block: blocks)
+        success = success && fwrite(block.data(), 1, block.size(), backup_file) == block.size();
+    success = (fclose(backup_file) == 0) && success;
+
+    if (!success)
+        fprintf(stderr, "Error while writing backup file %s\n", file_name);
+    return success;
+}
+
+std::unique_ptr<Checkpoint> Checkpoint::read(const char *file_name) {
+    return read(file_name, 0);
+}
+
+std::unique_ptr<Checkpoint> Checkpoint::read(const char *file_name, int depth) {
+    FILE *backup_file = fopen(file_name, "rb");
+    if (backup_file == nullptr) {
+        fprintf(stderr, "Error: could not open backup file %s\n", file_name);
+        return nullptr;
+    }
+    int32_t magic = 0;
+    if (fread(&magic, sizeof(magic), 1, backup_file) != 1) magic = 0;
+    fclose(backup_file);
+
+    if (magic == CHUNKED_MAGIC) return read_chunked(file_name, depth);
+    if (magic == MAPPED_MAGIC) return read_mapped(file_name);
+    return read_gzip(file_name);
+}
+
+std::unique_ptr<Checkpoint> Checkpoint::read_gzip(const char *file_name) {
+    gzFile backup_file = gzopen(file_name, "r");
+    if (backup_file == Z_NULL) {
+        fprintf(stderr, "Error: could not open backup file %s\n", file_name);
+        return nullptr;
+    }
+
+    int32_t time = 0, grid_height = 0, grid_width = 0, backup_step = 0;
+    double mutation_rate = 0.0;
+    std::vector<double> target(FUZZY_SAMPLING);
+    gzread(backup_file, &time, sizeof(time));
+    gzread(backup_file, &grid_height, sizeof(grid_height));
+    gzread(backup_file, &grid_width, sizeof(grid_width));
+    gzread(backup_file, &backup_step, sizeof(backup_step));
+    gzread(backup_file, &mutation_rate, sizeof(mutation_rate));
+    gzread(backup_file, target.data(), target.size() * sizeof(target[0]));
+    if (grid_height <= 0 || grid_width <= 0) {
+        fprintf(stderr, "Error: could not read backup file %s (truncated header)\n", file_name);
+        gzclose(backup_file);
+        return nullptr;
+    }
+
+    std::vector<std::shared_ptr<Organism>> organisms(grid_height * grid_width);
+    for (auto &organism: organisms)
+        organism = std::make_shared<Organism>(backup_file);
+
+    auto checkpoint = std::make_unique<Checkpoint>(Threefry(grid_width, grid_height, backup_file));
+    checkpoint->format = GZIP;
+    checkpoint->time = time;
+    checkpoint->grid_height = grid_height;
+    checkpoint->grid_width = grid_width;
+    checkpoint->backup_step = backup_step;
+    checkpoint->mutation_rate = mutation_rate;
+    checkpoint->target = std::move(target);
+    checkpoint->organisms = std::move(organisms);
+
+    // The parameters of a backup without a parameter block (or missing from it) keep their default value
+    int32_t magic = 0;
+    int32_t nb_parameters = 0;
+    if (gzread(backup_file, &magic, sizeof(magic)) == sizeof(magic) && magic == PARAMETERS_MAGIC)
+        gzread(backup_file, &nb_parameters, sizeof(nb_parameters));
+    for (int32_t i = 0; i < nb_parameters; i++) {
+        int32_t parameter[2];
+        if (gzread(backup_file, parameter, sizeof(parameter)) != sizeof(parameter)) {
+            fprintf(stderr, "Error: could not read backup file %s (truncated parameter block)\n", file_name);
+            gzclose(backup_file);
+            return nullptr;
+        }
+        checkpoint->set_parameter(parameter);
+    }
+
+    if (gzclose(backup_file) != Z_OK)
+        fprintf(stderr, "Error while closing backup file %s\n", file_name);
+    return checkpoint;
+}
+
+std::unique_ptr<Checkpoint> Checkpoint::read_chunked(const char *file_name, int depth) {
+    int fd = open(file_name, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Error: could not open backup file %s\n", file_name);
+        return nullptr;
+    }
+    FileReader reader(fd);
+
+    auto fail = [&](const char *cause) -> std::unique_ptr<Checkpoint> {
+        fprintf(stderr, "Error: could not read backup file %s (%s)\n", file_name, cause);
+        close(fd);
+        return nullptr;
+    };
+
+    if (reader.read<int32_t>() != CHUNKED_MAGIC) return fail("not a chunked backup");
+    auto version = reader.read<int32_t>();
+    if (version < 1 || version > CHUNKED_VERSION) return fail("unknown version");
+    auto format = static_cast<Format>(reader.read<int32_t>());
+    if (format == GZIP || !format_available(format)) return fail("compression not available in this build");
+
+    auto time = reader.read<int32_t>();
+    auto grid_height = reader.read<int32_t>();
+    auto grid_width = reader.read<int32_t>();
+    auto backup_step = reader.read<int32_t>();
+    auto mutation_rate = reader.read<double>();
+    std::vector<double> target(FUZZY_SAMPLING);
+    reader.read(target.data(), target.size());
+    auto seed = reader.read<int32_t>();
+    if (!reader.ok() || grid_height <= 0 || grid_width <= 0) return fail("truncated header");
+
+    auto checkpoint = std::make_unique<Checkpoint>(Threefry(grid_width, grid_height, seed));
+    checkpoint->format = format;
+    checkpoint->time = time;
+    checkpoint->grid_height = grid_height;
+    checkpoint->grid_width = grid_width;
+    checkpoint->backup_step = backup_step;
+    checkpoint->mutation_rate = mutation_rate;
+    checkpoint->target = std::move(target);
+
+    std::vector<char> compressed_counters(reader.read<uint64_t>());
+    reader.read(compressed_counters.data(), compressed_counters.size());
+    std::vector<char> counters(checkpoint->rng.counters().size() * sizeof(checkpoint->rng.counters()[0]));
+    if (!reader.ok() || !decompress_block(format, compressed_counters, counters)) return fail("corrupted counters");
+    memcpy(checkpoint->rng.counters().data(), counters.data(), counters.size());
+
+    if (reader.read<int32_t>() != PARAMETERS_MAGIC) return fail("no parameter block");
+    auto nb_parameters = reader.read<int32_t>();
+    for (int32_t i = 0; i < nb_parameters && reader.ok(); i++) {
+        int32_t parameter[2];
+        reader.read(parameter, 2);
+        checkpoint->set_parameter(parameter);
+    }
+
+    if (version >= 2) {
+        auto name_length = reader.read<int32_t>();
+        if (!reader.ok() || name_length < 0 || name_length > PATH_MAX) return fail("truncated header");
+        checkpoint->reference_name.resize(name_length);
+        reader.read(&checkpoint->reference_name[0], name_length);
+    }
+
+    auto nb_organisms = reader.read<int32_t>();
+    auto organisms_per_block = reader.read<int32_t>();
+    auto nb_blocks = reader.read<int32_t>();
+    const bool whole_grid = checkpoint->first_cell < 0 && nb_organisms == grid_height * grid_width;
+    const bool shard = checkpoint->first_cell >= 0 && nb_organisms >= 0 &&
+                       (int64_t) checkpoint->first_cell + nb_organisms <= (int64_t) grid_height * grid_width;
+    if (!reader.ok() || !(whole_grid || shard) || organisms_per_block <= 0 ||
+        nb_blocks != (nb_organisms + organisms_per_block - 1) / organisms_per_block)
+        return fail("inconsistent block layout");
+
+    std::vector<BlockIndex> index(nb_blocks);
+    reader.read(index.data(), index.size());
+    if (!reader.ok()) return fail("truncated index");
+
+    std::unique_ptr<Checkpoint> reference;
+    if (!checkpoint->reference_name.empty()) {
+        if (depth >= MAX_DELTA_DEPTH) return fail("chain of deltas too long");
+        std::string path = file_name;
+        path = path.substr(0, path.find_last_of('/') + 1) + checkpoint->reference_name;
+        reference = read(path.c_str(), depth + 1);
+        if (!reference) return fail("reference backup not readable");
+    }
+
+    checkpoint->organisms.resize(nb_organisms);
+    std::vector<char> block_ok(nb_blocks, 0);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int block = 0; block < nb_blocks; block++) {
+        std::vector<char> compressed(index[block].compressed_size);
+        std::vector<char> raw(index[block].raw_size);
+        if (!reader.read_at(index[block].offset, compressed.data(), compressed.size()) ||
+            !decompress_block(format, compressed, raw))
+            continue;
+
+        const char *data = raw.data();
+        const char *end = data + raw.size();
+        int last = std::min(nb_organisms, (block + 1) * organisms_per_block);
+        bool ok = true;
+        for (int indiv_id = block * organisms_per_block; ok && indiv_id < last; indiv_id++) {
+            Dna *dna;
+            // DELTA_RECORD, ancestor, number of switched positions (a packed genome is at least as long)
+            int32_t record[3] = {-1, 0, 0};
+            if (reference && end - data >= (ptrdiff_t) sizeof(record)) memcpy(record, data, sizeof(record));
+            if (record[0] == DELTA_RECORD) {
+                data += sizeof(record);
+                ok = record[1] >= 0 && record[1] < (int32_t) reference->organisms.size() && record[2] >= 0 &&
+                     (size_t) (end - data) >= record[2] * sizeof(int32_t);
+                if (!ok) break;
+
+                // The genome shares the chunks of its ancestor that hold no switched position
+                dna = new Dna(*reference->organisms[record[1]]->dna_);
+                for (int32_t i = 0; ok && i < record[2]; i++, data += sizeof(int32_t)) {
+                    int32_t pos;
+                    memcpy(&pos, data, sizeof(pos));
+                    ok = pos >= 0 && pos < dna->length();
+                    if (ok) dna->do_switch(pos);
+                }
+            } else {
+                dna = new Dna();
+                ok = dna->load(data, end);
+            }
+            if (ok) checkpoint->organisms[indiv_id] = std::make_shared<Organism>(dna);
+            else delete dna;
+        }
+        block_ok[block] = ok && data == end;
+    }
+
+    if (std::find(block_ok.begin(), block_ok.end(), 0) != block_ok.end()) return fail("corrupted block");
+
+    close(fd);
+    return checkpoint;
+}
+
+/**
+ * Mapped format (native byte order, uncompressed):
+ *  - int32 MAPPED_MAGIC, MAPPED_VERSION, time, grid_height, grid_width, backup_step
+ *  - double mutation_rate, FUZZY_SAMPLING doubles of the target
+ *  - int32 seed, the parameter block of the gzip format, int32 number of organisms
+ *  - uint64 offset of the PRNG counters, then the genome table: a GenomeIndex (offset, length) per organism
+ *  - at a page boundary, the PRNG counters (grid_height * grid_width * Threefry::NPHASES uint64)
+ *  - from the next page boundary, the chunks of each genome as they are in memory (see Dna::save_chunks), each
+ *    genome starting at a multiple of GENOME_ALIGNMENT
+ */
+bool Checkpoint::write_mapped(const char *file_name, const std::atomic<bool> *cancel) const {
+    const int nb_organisms = organisms.size();
+
+    std::vector<char> header;
+    append(header, MAPPED_MAGIC);
+    append(header, MAPPED_VERSION);
+    append(header, time);
+    append(header, grid_height);
+    append(header, grid_width);
+    append(header, backup_step);
+    append(header, mutation_rate);
+    append(header, target.data(), target.size());
+    append(header, (int32_t) rng.get_seed());
+
+    auto parameters = this->parameters();
+    append(header, PARAMETERS_MAGIC);
+    append(header, (int32_t) parameters.size());
+    append(header, parameters.data(), parameters.size());
+
+    append(header, (int32_t) nb_organisms);
+
+    const uint64_t counters_offset = align(header.size() + sizeof(uint64_t) + nb_organisms * sizeof(GenomeIndex),
+                                           PAGE_ALIGNMENT);
+    append(header, counters_offset);
+
+    uint64_t offset = align(counters_offset + rng.counters().size() * sizeof(rng.counters()[0]), PAGE_ALIGNMENT);
+    std::vector<GenomeIndex> genomes(nb_organisms);
+    for (int indiv_id = 0; indiv_id < nb_organisms; indiv_id++) {
+        int length = organisms[indiv_id]->length();
+        genomes[indiv_id] = {offset, length, 0};
+        offset = align(offset + Dna::chunks_size(length), GENOME_ALIGNMENT);
+    }
+    append(header, genomes.data(), genomes.size());
+
+    FILE *backup_file = fopen(file_name, "wb");
+    if (backup_file == nullptr) {
+        fprintf(stderr, "Error: could not open backup file %s\n", file_name);
+        return false;
+    }
+
+    uint64_t position = header.size();
+    bool success = fwrite(header.data(), 1, header.size(), backup_file) == header.size();
+
+    success = success && pad(backup_file, position, counters_offset) &&
+              fwrite(rng.counters().data(), sizeof(rng.counters()[0]), rng.counters().size(), backup_file) ==
+              rng.counters().size();
+    position += rng.counters().size() * sizeof(rng.counters()[0]);
+
+    bool cancelled = false;
+    for (int indiv_id = 0; success && indiv_id < nb_organisms; indiv_id++) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            cancelled = true;
+            break;
+        }
+        success = pad(backup_file, position, genomes[indiv_id].offset) &&
+                  organisms[indiv_id]->dna_->save_chunks(backup_file);
+        position += Dna::chunks_size(genomes[indiv_id].length);
+    }
+    success = (fclose(backup_file) == 0) && success;
+
+    if (!success)
+        fprintf(stderr, "Error while writing backup file %s\n", file_name);
+    return success && !cancelled;
+}
+
+std::unique_ptr<Checkpoint> Checkpoint::read_mapped(const char *file_name) {
+    int fd = open(file_name, O_RDONLY);
+    struct stat file_stat;
+    if (fd == -1 || fstat(fd, &file_stat) != 0) {
+        fprintf(stderr, "Error: could not open backup file %s\n", file_name);
+        if (fd != -1) close(fd);
+        return nullptr;
+    }
+
+    // Private and writable: a genome held by a single organism is mutated in place (see Dna::map_chunks), and the
+    // modified pages are copies that never reach the file
+    const size_t size = file_stat.st_size;
+    void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        fprintf(stderr, "Error: could not map backup file %s\n", file_name);
+        return nullptr;
+    }
+    // The genomes keep the mapping alive
+    std::shared_ptr<char> mapping(static_cast<char *>(address), [size](char *data) { munmap(data, size); });
+
+    const char *cursor = mapping.get();
+    const char *const end = cursor + size;
+    bool ok = true;
+    auto read = [&](void *dest, size_t nb) {
+        ok = ok && (size_t) (end - cursor) >= nb;
+        if (ok) memcpy(dest, cursor, nb);
+        cursor += ok ? nb : 0;
+    };
+    auto fail = [&](const char *cause) -> std::unique_ptr<Checkpoint> {
+        fprintf(stderr, "Error: could not read backup file %s (%s)\n", file_name, cause);
+        return nullptr;
+    };
+
+    int32_t magic, version, time, grid_height, grid_width, backup_step, seed;
+    double mutation_rate;
+    std::vector<double> target(FUZZY_SAMPLING);
+    read(&magic, sizeof(magic));
+    read(&version, sizeof(version));
+    if (!ok || magic != MAPPED_MAGIC || version != MAPPED_VERSION) return fail("not a mapped backup");
+    read(&time, sizeof(time));
+    read(&grid_height, sizeof(grid_height));
+    read(&grid_width, sizeof(grid_width));
+    read(&backup_step, sizeof(backup_step));
+    read(&mutation_rate, sizeof(mutation_rate));
+    read(target.data(), target.size() * sizeof(target[0]));
+    read(&seed, sizeof(seed));
+    if (!ok || grid_height <= 0 || grid_width <= 0) return fail("truncated header");
+
+    auto checkpoint = std::make_unique<Checkpoint>(Threefry(grid_width, grid_height, seed));
+    checkpoint->format = MAPPED;
+    checkpoint->time = time;
+    checkpoint->grid_height = grid_height;
+    checkpoint->grid_width = grid_width;
+    checkpoint->backup_step = backup_step;
+    checkpoint->mutation_rate = mutation_rate;
+    checkpoint->target = std::move(target);
+
+    int32_t parameters_magic = 0, nb_parameters = 0;
+    read(&parameters_magic, sizeof(parameters_magic));
+    read(&nb_parameters, sizeof(nb_parameters));
+    if (!ok || parameters_magic != PARAMETERS_MAGIC) return fail("no parameter block");
+    for (int32_t i = 0; i < nb_parameters && ok; i++) {
+        int32_t parameter[2];
+        read(parameter, sizeof(parameter));
+        checkpoint->set_parameter(parameter);
+    }
+
+    int32_t nb_organisms = 0;
+    uint64_t counters_offset = 0;
+    read(&nb_organisms, sizeof(nb_organisms));
+    read(&counters_offset, sizeof(counters_offset));
+    if (!ok || nb_organisms != grid_height * grid_width) return fail("inconsistent header");
+
+    std::vector<GenomeIndex> genomes(nb_organisms);
+    read(genomes.data(), genomes.size() * sizeof(genomes[0]));
+    auto &counters = checkpoint->rng.counters();
+    const size_t counters_size = counters.size() * sizeof(counters[0]);
+    if (!ok || counters_offset > size || size - counters_offset < counters_size) return fail("truncated file");
+    memcpy(counters.data(), mapping.get() + counters_offset, counters_size);
+
+    checkpoint->organisms.resize(nb_organisms);
+    std::vector<char> genome_ok(nb_organisms, 0);
+
+#pragma omp parallel for
+    for (int indiv_id = 0; indiv_id < nb_organisms; indiv_id++) {
+        const GenomeIndex &genome = genomes[indiv_id];
+        if (genome.length <= 0 || genome.offset % sizeof(uint64_t) != 0 || genome.offset > size ||
+            size - genome.offset < Dna::chunks_size(genome.length))
+            continue;
+
+        auto dna = new Dna();
+        dna->map_chunks(mapping, mapping.get() + genome.offset, genome.length);
+        checkpoint->organisms[indiv_id] = std::make_shared<Organism>(dna);
+        genome_ok[indiv_id] = 1;
+    }
+
+    if (std::find(genome_ok.begin(), genome_ok.end(), 0) != genome_ok.end()) return fail("corrupted genome table");
+    return checkpoint;
+}
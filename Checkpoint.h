@@ -0,0 +1,147 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Organism.h"
+#include "SelectionPolicy.h"
+#include "Threefry.h"
+
+/**
+ * Snapshot of a simulation, to be written as a backup
+ *
+ * Taking a snapshot is cheap: its organisms are copies of the genomes of the population (see Population), which share
+ * their chunks (the genomes are copy-on-write), and the PRNG counters are copied. A snapshot can thus be written by
+ * another thread while the simulation goes on (see CheckpointWriter).
+ *
+ * A backup is written in one of these formats:
+ *  - GZIP, a single gzip stream,
+ *  - CHUNKED_*, a header with an index, then blocks of ORGANISMS_PER_BLOCK genomes compressed independently (with
+ *    zlib, or zstd / lz4 when built with them), which are compressed and decompressed in parallel,
+ *  - MAPPED, uncompressed and page-aligned, for fast local checkpoints: it is loaded with mmap and the genomes use the
+ *    mapped memory in place (see Dna::map_chunks).
+ *
+ * Whatever its format, the backup of generation T is named backup_T.zae, the name a resume, the lineage rebuilder and
+ * the references of the deltas look for: only a GZIP backup is a gzip file. The format is told by the first 4 bytes of
+ * the file (see read): "AEVC" for CHUNKED_*, "AEVM" for MAPPED, else GZIP.
+ *
+ * A chunked backup can also be a delta from an earlier backup, its reference: each genome is then stored as the index
+ * of a genome of the reference and the positions switched since, unless the packed genome is smaller. Reading the
+ * backup reads its reference first, which may itself be a delta.
+ */
+struct Checkpoint {
+    enum Format : int32_t {
+        GZIP = 0, CHUNKED_ZLIB = 1, CHUNKED_ZSTD = 2, CHUNKED_LZ4 = 3, MAPPED = 4
+    };
+
+    /// Whether this build can write and read the format
+    static bool format_available(Format format);
+
+    /**
+     * Read a backup of any format, nullptr (after printing the cause) if it cannot be read. The format is detected
+     * from the first bytes of the file, not from its name (see above).
+     */
+    static std::unique_ptr<Checkpoint> read(const char *file_name);
+
+    explicit Checkpoint(const Threefry &rng) : rng(rng) {}
+
+    Format format = GZIP;
+
+    int time = 0;
+    int grid_height = 0;
+    int grid_width = 0;
+    int backup_step = 0;
+    double mutation_rate = 0.0;
+    // Stored in the parameter block when not 0
+    double rearrangement_rate = 0.0;
+    std::vector<double> target;
+    std::vector<std::shared_ptr<Organism>> organisms;
+    Threefry rng;
+    SelectionScheme selection_scheme = FITNESS_PROPORTIONAL;
+    int selection_radius = 1;
+
+    /**
+     * Shard of a distributed simulation (see MpiExpManager), in a chunked format only: its organisms are those of the
+     * cells [first_cell, first_cell + organisms.size()[ of the grid. -1 (the default) for a backup of the whole grid.
+     */
+    int first_cell = -1;
+
+    /**
+     * Delta from an earlier backup (a chunked format only): name of its file, relative to the directory of this one
+     * (empty for a full backup), its genomes, and for each organism the index of its ancestor among them (-1 if
+     * none). The genomes of the reference are not needed to read a backup, only to write it.
+     */
+    std::string reference_name;
+    std::shared_ptr<const std::vector<Dna>> reference_genomes;
+    std::vector<int32_t> reference_ids;
+
+    /**
+     * Write the backup (see the write_* functions for the formats) to a temporary file renamed to file_name once
+     * complete.
+     *
+     * @return false, after printing the cause, if the backup could not be written or if cancel was set meanwhile
+     */
+    bool write(const char *file_name, const std::atomic<bool> *cancel = nullptr) const;
+
+private:
+    bool write_gzip(const char *file_name, const std::atomic<bool> *cancel) const;
+
+    bool write_chunked(const char *file_name, const std::atomic<bool> *cancel) const;
+
+    bool write_mapped(const char *file_name, const std::atomic<bool> *cancel) const;
+
+    /// (key, value) pairs of the parameter block (see ParameterKey)
+    std::vector<std::array<int32_t, 2>> parameters() const;
+
+    /// Set the parameter of a pair of the parameter block, an unknown one being skipped
+    void set_parameter(const int32_t parameter[2]);
+
+    /// read() of a backup found after depth deltas
+    static std::unique_ptr<Checkpoint> read(const char *file_name, int depth);
+
+    static std::unique_ptr<Checkpoint> read_gzip(const char *file_name);
+
+    static std::unique_ptr<Checkpoint> read_chunked(const char *file_name, int depth);
+
+    static std::unique_ptr<Checkpoint> read_mapped(const char *file_name);
+};
+
+// "AEVP": start of the parameter block at the end of a backup, followed by the number of parameters and the
+// (key, value) pairs
+constexpr int32_t PARAMETERS_MAGIC = 0x50564541;
+
+enum ParameterKey : int32_t {
+    SELECTION_SCHEME = 1, SELECTION_RADIUS = 2, FIRST_CELL = 3,
+    // The low and high 32 bits of a double
+    REARRANGEMENT_RATE_LOW = 4, REARRANGEMENT_RATE_HIGH = 5
+};
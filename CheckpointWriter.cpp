@@ -24,31 +24,36 @@
 //
 // ***************************************************************************************************************
 
-#pragma once
+#include "CheckpointWriter.h"
 
-/**
- * Class to store a protein and its related variable
- */
-class Protein {
-public:
-    Protein() = default;
-    Protein(int t_protein_start, int t_protein_end, int t_protein_length, double t_e) {
-        protein_start = t_protein_start;
-        protein_end = t_protein_end;
-        protein_length = t_protein_length;
-        e = t_e;
-        is_init_ = true;
-    }
+#include <cstdio>
+
+bool CheckpointWriter::submit(std::unique_ptr<Checkpoint> checkpoint, std::string file_name) {
+    bool previous_success = wait();
 
-    int protein_start = 0;
-    int protein_end = 0;
-    int protein_length = 0;
+    checkpoint_ = std::move(checkpoint);
+    cancel_ = false;
+    success_ = true;
+    thread_ = std::thread([this, file_name]() {
+        success_ = checkpoint_->write(file_name.c_str(), &cancel_);
+        if (success_)
+            printf("Backup for generation %d done !\n", checkpoint_->time);
+    });
 
-    double m = 0.0;
-    double w = 0.0;
-    double h = 0.0;
-    double e = 0.0;
-    bool is_functional = false;
+    return previous_success;
+}
+
+bool CheckpointWriter::wait() {
+    if (thread_.joinable()) {
+        thread_.join();
+        if (!success_ && !cancel_)
+            fprintf(stderr, "Error: the backup of generation %d failed\n", checkpoint_->time);
+        checkpoint_.reset();
+    }
+    return success_ || cancel_;
+}
 
-    bool is_init_ = false;
-};
+void CheckpointWriter::cancel() {
+    cancel_ = true;
+    wait();
+}
@@ -0,0 +1,73 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "Checkpoint.h"
+
+/**
+ * Write backups in a background thread while the simulation goes on
+ *
+ * One checkpoint is written at a time: submitting the next one first waits for the previous one, so that at most two
+ * snapshots exist at once (the one being written and the one being submitted).
+ */
+class CheckpointWriter {
+public:
+    CheckpointWriter() = default;
+
+    CheckpointWriter(const CheckpointWriter &) = delete;
+
+    CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+    /// Waits for the checkpoint being written
+    ~CheckpointWriter() { wait(); }
+
+    /**
+     * Start writing a checkpoint to file_name, once the previous one is written
+     *
+     * @return false if the previous checkpoint could not be written
+     */
+    bool submit(std::unique_ptr<Checkpoint> checkpoint, std::string file_name);
+
+    /// Wait for the checkpoint being written, false if it could not be written
+    bool wait();
+
+    /// Stop writing the checkpoint being written as soon as possible (its backup file is not created), then wait()
+    void cancel();
+
+private:
+    std::thread thread_;
+    // Destroyed by wait(), in the simulation thread (see Checkpoint)
+    std::unique_ptr<Checkpoint> checkpoint_;
+    std::atomic<bool> cancel_{false};
+    // Written by the thread, read once it is joined
+    bool success_ = true;
+};
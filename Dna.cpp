@@ -3,38 +3,307 @@
 //
 
 #include "Dna.h"
+#include "DnaRope.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+// The AVX2 and AVX-512 promoter scanners are compiled for their own target and picked at runtime
+#define DNA_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace {
+    /// Pack the first `size` characters of a motif as bits (bit k set when motif[k] is '1', '*' is left to 0)
+    constexpr uint64_t motif_bits(const char *motif, int size) {
+        uint64_t bits = 0;
+        for (int k = 0; k < size; k++)
+            if (motif[k] == '1') bits |= uint64_t{1} << k;
+        return bits;
+    }
+
+    constexpr uint64_t PROM_BITS = motif_bits(PROM_SEQ, PROM_SIZE);
+    constexpr uint64_t PROM_MASK = (uint64_t{1} << PROM_SIZE) - 1;
+
+    // Shine-Dalgarno: SHINE_DAL_SIZE bases, a SD_START_SPACER wildcard, then the START codon
+    constexpr uint64_t SHINE_DAL_BITS = motif_bits(SHINE_DAL_SEQ, SD_TO_START);
+    constexpr uint64_t SHINE_DAL_MASK = ((uint64_t{1} << SHINE_DAL_SIZE) - 1) |
+                                        (((uint64_t{1} << CODON_SIZE) - 1) << (SHINE_DAL_SIZE + SD_START_SPACER));
+
+    constexpr uint64_t PROTEIN_END_BITS = motif_bits(PROTEIN_END, CODON_SIZE);
+    constexpr uint64_t CODON_MASK = (uint64_t{1} << CODON_SIZE) - 1;
+
+    // Bit reversal of a terminator stem: the stem read backward is compared to the stem read forward
+    constexpr uint8_t REVERSE_STEM[16] = {0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+                                          0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF};
+    static_assert(TERM_STEM_SIZE == 4, "REVERSE_STEM is built for 4 bases stems");
+
+    /*
+     * Promoter scan
+     *
+     * The 64 start positions of a word are scored together (bit-sliced): for each of the PROM_SIZE bases of the
+     * motif, the window of the 64 bases shifted by k is compared to the k-th base of the consensus, and the
+     * mismatches are added to a 3 bits per position counter (c2 c1 c0) that sets `over` once it reaches 8.
+     * A promoter starts wherever the count is at most PROM_MAX_DIFF.
+     */
+    static_assert(PROM_MAX_DIFF == 4, "The promoter scan threshold is built for PROM_MAX_DIFF == 4");
+    static_assert(PROM_SIZE < 64, "The promoter scan reads at most two words per start position");
+
+    /// All ones when the k-th base of the consensus is a 1
+    constexpr uint64_t prom_base(int k) {
+        return uint64_t{0} - ((PROM_BITS >> k) & 1);
+    }
+
+    /// Promoter starts among the 64 positions of word lo (hi being the next word)
+    uint64_t promoter_mask(uint64_t lo, uint64_t hi) {
+        uint64_t c0 = 0, c1 = 0, c2 = 0, over = 0;
+        for (int k = 0; k < PROM_SIZE; k++) {
+            uint64_t window = k == 0 ? lo : (lo >> k) | (hi << (64 - k));
+            uint64_t mismatch = window ^ prom_base(k);
+
+            uint64_t carry_0 = c0 & mismatch;
+            c0 ^= mismatch;
+            uint64_t carry_1 = c1 & carry_0;
+            c1 ^= carry_0;
+            over |= c2 & carry_1;
+            c2 ^= carry_1;
+        }
+        return ~(over | (c2 & (c1 | c0)));
+    }
+
+#ifdef DNA_X86_SIMD
+    /// promoter_mask() of the 4 words starting at seq
+    __attribute__((target("avx2")))
+    void promoter_masks_avx2(const uint64_t *seq, uint64_t *masks) {
+        __m256i lo = _mm256_loadu_si256((const __m256i *) seq);
+        __m256i hi = _mm256_loadu_si256((const __m256i *) (seq + 1));
+
+        __m256i c0 = _mm256_setzero_si256(), c1 = c0, c2 = c0, over = c0;
+        for (int k = 0; k < PROM_SIZE; k++) {
+            __m256i window = k == 0 ? lo : _mm256_or_si256(_mm256_srl_epi64(lo, _mm_cvtsi32_si128(k)),
+                                                           _mm256_sll_epi64(hi, _mm_cvtsi32_si128(64 - k)));
+            __m256i mismatch = _mm256_xor_si256(window, _mm256_set1_epi64x(prom_base(k)));
+
+            __m256i carry_0 = _mm256_and_si256(c0, mismatch);
+            c0 = _mm256_xor_si256(c0, mismatch);
+            __m256i carry_1 = _mm256_and_si256(c1, carry_0);
+            c1 = _mm256_xor_si256(c1, carry_0);
+            over = _mm256_or_si256(over, _mm256_and_si256(c2, carry_1));
+            c2 = _mm256_xor_si256(c2, carry_1);
+        }
+        __m256i reject = _mm256_or_si256(over, _mm256_and_si256(c2, _mm256_or_si256(c1, c0)));
+        _mm256_storeu_si256((__m256i *) masks, _mm256_xor_si256(reject, _mm256_set1_epi64x(-1)));
+    }
+
+    /// promoter_mask() of the 8 words starting at seq
+    __attribute__((target("avx512f")))
+    void promoter_masks_avx512(const uint64_t *seq, uint64_t *masks) {
+        __m512i lo = _mm512_loadu_si512(seq);
+        __m512i hi = _mm512_loadu_si512(seq + 1);
+
+        __m512i c0 = _mm512_setzero_si512(), c1 = c0, c2 = c0, over = c0;
+        for (int k = 0; k < PROM_SIZE; k++) {
+            // The masked shifts, all lanes set: the plain ones merge into an undefined vector that GCC warns of
+            __m512i window = k == 0 ? lo : _mm512_or_si512(_mm512_mask_srl_epi64(lo, 0xFF, lo, _mm_cvtsi32_si128(k)),
+                                                           _mm512_mask_sll_epi64(hi, 0xFF, hi,
+                                                                                 _mm_cvtsi32_si128(64 - k)));
+            __m512i mismatch = _mm512_xor_si512(window, _mm512_set1_epi64(prom_base(k)));
+
+            __m512i carry_0 = _mm512_and_si512(c0, mismatch);
+            c0 = _mm512_xor_si512(c0, mismatch);
+            __m512i carry_1 = _mm512_and_si512(c1, carry_0);
+            c1 = _mm512_xor_si512(c1, carry_0);
+            over = _mm512_or_si512(over, _mm512_and_si512(c2, carry_1));
+            c2 = _mm512_xor_si512(c2, carry_1);
+        }
+        __m512i reject = _mm512_or_si512(over, _mm512_and_si512(c2, _mm512_or_si512(c1, c0)));
+        _mm512_storeu_si512(masks, _mm512_xor_si512(reject, _mm512_set1_epi64(-1)));
+    }
+
+    enum SimdLevel {
+        SCALAR, AVX2, AVX512
+    };
+
+    SimdLevel cpu_simd_level() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return AVX512;
+        if (__builtin_cpu_supports("avx2")) return AVX2;
+        return SCALAR;
+    }
+#endif
+}
 
-Dna::Dna(int length, Threefry::Gen &&rng) : seq_(length) {
-    // Generate a random genome
-    for (int32_t i = 0; i < length; i++) {
-        seq_[i] = '0' + rng.random(NB_BASE);
+// Needed by std::min, which takes its arguments by reference (C++14)
+constexpr int Dna::CHUNK_WORDS;
+
+Dna::Dna(int length, Threefry::Gen &&rng) {
+    std::vector<uint64_t> words(nb_words(length), 0);
+    // Generate a random genome, a word at a time (the same draws as one rng.random(NB_BASE) per base)
+    unsigned int bases[64];
+    for (int32_t i = 0; i < length; i += 64) {
+        int nb = std::min(64, length - i);
+        rng.fill_random(bases, nb, NB_BASE);
+        for (int k = 0; k < nb; k++)
+            words[i >> 6] |= uint64_t{bases[k]} << k;
     }
+    assign_words(length, std::move(words));
 }
 
 int Dna::length() const {
-    return seq_.size();
+    return length_;
+}
+
+/**
+ * Save the genome in the packed format: the opposite of its length, then its words (little-endian uint64).
+ *
+ * A negative length is what distinguishes it from the legacy format (positive length then one char per base),
+ * which load() still reads.
+ */
+void Dna::save(gzFile backup_file) const {
+    int packed_length = -length();
+    gzwrite(backup_file, &packed_length, sizeof(packed_length));
+
+    int remaining = nb_words(length_);
+    for (const auto &chunk: chunks_) {
+        if (remaining <= 0) break;
+        int nb = std::min(remaining, CHUNK_WORDS);
+        gzwrite(backup_file, chunk->words, nb * sizeof(chunk->words[0]));
+        remaining -= nb;
+    }
 }
 
-void Dna::save(gzFile backup_file) {
-    int dna_length = length();
-    gzwrite(backup_file, &dna_length, sizeof(dna_length));
-    gzwrite(backup_file, seq_.data(), dna_length * sizeof(seq_[0]));
+void Dna::save(std::vector<char> &buffer) const {
+    int packed_length = -length();
+    size_t size = buffer.size();
+    buffer.resize(size + sizeof(packed_length) + nb_words(length_) * sizeof(uint64_t));
+    char *dest = buffer.data() + size;
+
+    memcpy(dest, &packed_length, sizeof(packed_length));
+    dest += sizeof(packed_length);
+
+    int remaining = nb_words(length_);
+    for (const auto &chunk: chunks_) {
+        if (remaining <= 0) break;
+        int nb = std::min(remaining, CHUNK_WORDS);
+        memcpy(dest, chunk->words, nb * sizeof(chunk->words[0]));
+        dest += nb * sizeof(chunk->words[0]);
+        remaining -= nb;
+    }
+}
+
+bool Dna::load(const char *&data, const char *end) {
+    int packed_length;
+    if (end - data < (ptrdiff_t) sizeof(packed_length)) return false;
+    memcpy(&packed_length, data, sizeof(packed_length));
+    if (packed_length >= 0) return false;
+
+    std::vector<uint64_t> words(nb_words(-packed_length));
+    size_t size = words.size() * sizeof(words[0]);
+    if ((size_t) (end - data) - sizeof(packed_length) < size) return false;
+    memcpy(words.data(), data + sizeof(packed_length), size);
+    data += sizeof(packed_length) + size;
+
+    assign_words(-packed_length, std::move(words));
+    return true;
+}
+
+bool Dna::save_chunks(FILE *file) const {
+    for (const auto &chunk: chunks_)
+        if (fwrite(chunk.get(), sizeof(Chunk), 1, file) != 1) return false;
+    return true;
+}
+
+void Dna::map_chunks(const std::shared_ptr<char> &mapping, char *chunks, int length) {
+    length_ = length;
+    chunks_.resize((nb_stored_words(length) + CHUNK_WORDS - 1) / CHUNK_WORDS);
+    for (size_t chunk_idx = 0; chunk_idx < chunks_.size(); chunk_idx++) {
+        // Aliasing constructor: the chunk shares the ownership of the whole mapping
+        chunks_[chunk_idx] = std::shared_ptr<Chunk>(mapping, reinterpret_cast<Chunk *>(chunks) + chunk_idx);
+    }
+    hash_ = compute_hash();
+}
+
+bool Dna::differences(const Dna &reference, int max_positions, std::vector<int32_t> &positions) const {
+    positions.clear();
+    if (reference.length_ != length_) return false;
+
+    const int last_word = nb_words(length_) - 1;
+    for (int chunk_idx = 0; chunk_idx * CHUNK_WORDS <= last_word; chunk_idx++) {
+        if (chunks_[chunk_idx] == reference.chunks_[chunk_idx]) continue;
+
+        const uint64_t *words = chunks_[chunk_idx]->words;
+        const uint64_t *reference_words = reference.chunks_[chunk_idx]->words;
+        for (int i = 0; i < CHUNK_WORDS && chunk_idx * CHUNK_WORDS + i <= last_word; i++) {
+            int base = (chunk_idx * CHUNK_WORDS + i) << 6;
+            uint64_t diff = words[i] ^ reference_words[i];
+            // Ignore the copy of the first bases that follows the last one
+            if (length_ - base < 64) diff &= (uint64_t{1} << (length_ - base)) - 1;
+
+            for (; diff; diff &= diff - 1) {
+                if ((int) positions.size() >= max_positions) return false;
+                positions.push_back(base + __builtin_ctzll(diff));
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t Dna::word_key(int idx, uint64_t bases) {
+    // splitmix64 finalizer of the bases mixed with that of the index
+    auto mix = [](uint64_t x) {
+        x += 0x9e3779b97f4a7c15;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+        return x ^ (x >> 31);
+    };
+    return mix(bases ^ mix(idx));
+}
+
+uint64_t Dna::compute_hash() const {
+    uint64_t hash = word_key(-1, length_);
+    const int count = nb_words(length_);
+    for (int idx = 0; idx < count; idx++)
+        hash ^= word_key(idx, genome_word(idx));
+    return hash;
+}
+
+uint64_t Dna::hash(const char *bases, int length) {
+    uint64_t hash = word_key(-1, length);
+    for (int idx = 0; idx < nb_words(length); idx++) {
+        uint64_t word = 0;
+        for (int pos = idx << 6; pos < length && pos < (idx + 1) << 6; pos++)
+            word |= uint64_t(bases[pos] == '1') << (pos & 63);
+        hash ^= word_key(idx, word);
+    }
+    return hash;
 }
 
+/**
+ * Load a genome saved either in the packed format or in the legacy char format
+ */
 void Dna::load(gzFile backup_file) {
     int dna_length;
     gzread(backup_file, &dna_length, sizeof(dna_length));
 
-    char tmp_seq[dna_length];
-    gzread(backup_file, tmp_seq, dna_length * sizeof(tmp_seq[0]));
-
-    seq_ = std::vector<char>(tmp_seq, tmp_seq + dna_length);
+    if (dna_length < 0) {
+        // Packed format
+        std::vector<uint64_t> words(nb_words(-dna_length));
+        gzread(backup_file, words.data(), words.size() * sizeof(words[0]));
+        assign_words(-dna_length, std::move(words));
+    } else {
+        // Legacy format
+        std::vector<char> tmp_seq(dna_length);
+        gzread(backup_file, tmp_seq.data(), dna_length * sizeof(tmp_seq[0]));
+
+        assign_chars(tmp_seq);
+    }
 }
 
 void Dna::set(int pos, char c) {
-    seq_[pos] = c;
+    if (base_at(pos) != (c == '1'))
+        flip_base(pos);
 }
 
 /**
@@ -44,8 +313,11 @@ void Dna::set(int pos, char c) {
  * @param pos_2
  */
 void Dna::remove(int pos_1, int pos_2) {
-    assert(pos_1 >= 0 && pos_2 >= pos_1 && pos_2 <= seq_.size());
-    seq_.erase(seq_.begin() + pos_1, seq_.begin() + pos_2);
+    assert(pos_1 >= 0 && pos_2 >= pos_1 && pos_2 <= length_);
+    if (pos_1 == pos_2) return;
+    DnaRope rope(*this);
+    rope.remove(pos_1, pos_2);
+    rope.write(*this);
 }
 
 /**
@@ -57,9 +329,11 @@ void Dna::remove(int pos_1, int pos_2) {
  */
 void Dna::insert(int pos, std::vector<char> seq) {
 // Insert sequence 'seq' at position 'pos'
-    assert(pos >= 0 && pos < seq_.size());
+    assert(pos >= 0 && pos < length_);
 
-    seq_.insert(seq_.begin() + pos, seq.begin(), seq.end());
+    DnaRope rope(*this);
+    rope.insert(pos, seq);
+    rope.write(*this);
 }
 
 /**
@@ -71,174 +345,209 @@ void Dna::insert(int pos, std::vector<char> seq) {
  */
 void Dna::insert(int pos, Dna *seq) {
 // Insert sequence 'seq' at position 'pos'
-    assert(pos >= 0 && pos < seq_.size());
+    assert(pos >= 0 && pos < length_);
 
-    seq_.insert(seq_.begin() + pos, seq->seq_.begin(), seq->seq_.end());
+    DnaRope rope(*this);
+    rope.insert(pos, *seq);
+    rope.write(*this);
 }
 
 void Dna::do_switch(int pos) {
-    if (seq_[pos] == '0') seq_[pos] = '1';
-    else seq_[pos] = '0';
+    flip_base(pos);
 }
 
 void Dna::do_duplication(int pos_1, int pos_2, int pos_3) {
-    // Duplicate segment [pos_1; pos_2[ and insert the duplicate before pos_3
-    char *duplicate_segment = NULL;
-
-    int32_t seg_length;
-
-    if (pos_1 < pos_2) {
-        //
-        //       pos_1         pos_2                   -> 0-
-        //         |             |                   -       -
-        // 0--------------------------------->      -         -
-        //         ===============                  -         - pos_1
-        //           tmp (copy)                      -       -
-        //                                             -----      |
-        //                                             pos_2    <-'
-        //
-        std::vector<char> seq_dupl =
-                std::vector<char>(seq_.begin() + pos_1, seq_.begin() + pos_2);
-
-        insert(pos_3, seq_dupl);
-    } else { // if (pos_1 >= pos_2)
-        // The segment to duplicate includes the origin of replication.
-        // The copying process will be done in two steps.
-        //
-        //                                            ,->
-        //    pos_2                 pos_1            |      -> 0-
-        //      |                     |                   -       - pos_2
-        // 0--------------------------------->     pos_1 -         -
-        // ======                     =======            -         -
-        //  tmp2                        tmp1              -       -
-        //                                                  -----
-        //
-        //
-        std::vector<char>
-                seq_dupl = std::vector<char>(seq_.begin() + pos_1, seq_.end());
-        seq_dupl.insert(seq_dupl.end(), seq_.begin(), seq_.begin() + pos_2);
-
-        insert(pos_3, seq_dupl);
-    }
-}
-
-int Dna::promoter_at(int pos) {
-    int prom_dist[PROM_SIZE];
-
-    for (int motif_id = 0; motif_id < PROM_SIZE; motif_id++) {
-        int search_pos = pos + motif_id;
-        if (search_pos >= seq_.size())
-            search_pos -= seq_.size();
-        // Searching for the promoter
-        prom_dist[motif_id] =
-                PROM_SEQ[motif_id] == seq_[search_pos] ? 0 : 1;
-
-    }
-
-
-    // Computing if a promoter exists at that position
-    int dist_lead = prom_dist[0] +
-                    prom_dist[1] +
-                    prom_dist[2] +
-                    prom_dist[3] +
-                    prom_dist[4] +
-                    prom_dist[5] +
-                    prom_dist[6] +
-                    prom_dist[7] +
-                    prom_dist[8] +
-                    prom_dist[9] +
-                    prom_dist[10] +
-                    prom_dist[11] +
-                    prom_dist[12] +
-                    prom_dist[13] +
-                    prom_dist[14] +
-                    prom_dist[15] +
-                    prom_dist[16] +
-                    prom_dist[17] +
-                    prom_dist[18] +
-                    prom_dist[19] +
-                    prom_dist[20] +
-                    prom_dist[21];
-
-    return dist_lead;
+    // Duplicate segment [pos_1; pos_2[ and insert the duplicate before pos_3. When pos_1 >= pos_2, the segment
+    // includes the origin of replication: it is [pos_1; length[ followed by [0; pos_2[.
+    DnaRope rope(*this);
+    rope.duplicate(pos_1, pos_2, pos_3);
+    rope.write(*this);
+}
+
+void Dna::do_translocation(int pos_1, int pos_2, int pos_3) {
+    DnaRope rope(*this);
+    rope.translocate(pos_1, pos_2, pos_3);
+    rope.write(*this);
+}
+
+int Dna::promoter_at(int pos) const {
+    // Hamming distance to the consensus
+    return __builtin_popcountll((window(pos) ^ PROM_BITS) & PROM_MASK);
 }
 
 // Given a, b, c, d boolean variable and X random boolean variable,
 // a terminator look like : a b c d X X !d !c !b !a
-int Dna::terminator_at(int pos) {
-    int term_dist[TERM_STEM_SIZE];
-    for (int motif_id = 0; motif_id < TERM_STEM_SIZE; motif_id++) {
-        int right = pos + motif_id;
-        int left = pos + (TERM_SIZE - 1) - motif_id;
-
-        // loop back the dna inf needed
-        if (right >= length()) right -= length();
-        if (left >= length()) left -= length();
-
-        // Search for the terminators
-        term_dist[motif_id] = seq_[right] != seq_[left] ? 1 : 0;
-    }
-    int dist_term_lead = term_dist[0] +
-                         term_dist[1] +
-                         term_dist[2] +
-                         term_dist[3];
-
-    return dist_term_lead;
-}
-
-bool Dna::shine_dal_start(int pos) {
-    bool start = false;
-    int t_pos, k_t;
-
-    for (int k = 0; k < SHINE_DAL_SIZE + CODON_SIZE; k++) {
-        k_t = k >= SHINE_DAL_SIZE ? k + SD_START_SPACER : k;
-        t_pos = pos + k_t;
-        if (t_pos >= seq_.size())
-            t_pos -= seq_.size();
-
-        if (seq_[t_pos] == SHINE_DAL_SEQ[k_t]) {
-            start = true;
-        } else {
-            start = false;
-            break;
-        }
+int Dna::terminator_at(int pos) const {
+    uint64_t bases = window(pos);
+    uint64_t stem = bases & 0xF;
+    uint64_t reverse_stem = REVERSE_STEM[(bases >> (TERM_STEM_SIZE + TERM_LOOP_SIZE)) & 0xF];
+
+    // Number of complementary base pairs in the stem
+    return __builtin_popcountll(stem ^ reverse_stem);
+}
+
+bool Dna::shine_dal_start(int pos) const {
+    return ((window(pos) ^ SHINE_DAL_BITS) & SHINE_DAL_MASK) == 0;
+}
+
+bool Dna::protein_stop(int pos) const {
+    return ((window(pos) ^ PROTEIN_END_BITS) & CODON_MASK) == 0;
+}
+
+int Dna::codon_at(int pos) const {
+    // The first base of the codon is its most significant bit
+    uint64_t bases = window(pos);
+    return (int) (((bases & 1) << 2) | (bases & 2) | ((bases >> 2) & 1));
+}
+
+void Dna::promoter_masks(int word, int nb, uint64_t *masks) const {
+#ifdef DNA_X86_SIMD
+    static const SimdLevel simd_level = cpu_simd_level();
+#endif
+
+    for (int i = 0; i < nb;) {
+        int idx = (word + i) % CHUNK_WORDS;
+        const uint64_t *words = chunks_[(word + i) / CHUNK_WORDS]->words + idx;
+        // The words to score in this chunk are contiguous, followed by the copy of the next one
+        int in_chunk = std::min(nb - i, CHUNK_WORDS - idx);
+        int j = 0;
+
+#ifdef DNA_X86_SIMD
+        if (simd_level >= AVX512)
+            for (; j + 8 <= in_chunk; j += 8)
+                promoter_masks_avx512(words + j, masks + i + j);
+        if (simd_level >= AVX2)
+            for (; j + 4 <= in_chunk; j += 4)
+                promoter_masks_avx2(words + j, masks + i + j);
+#endif
+
+        for (; j < in_chunk; j++)
+            masks[i + j] = promoter_mask(words[j], words[j + 1]);
+        i += in_chunk;
     }
+}
+
+void Dna::terminator_masks(uint64_t *masks) const {
+    static_assert(TERM_SIZE < 64, "The terminator scan reads at most two words per start position");
 
-    return start;
+    int nb = nb_words(length_);
+    for (int word = 0; word < nb; word++) {
+        const uint64_t *words = chunks_[word / CHUNK_WORDS]->words + word % CHUNK_WORDS;
+        uint64_t lo = words[0], hi = words[1];
+        auto shifted = [lo, hi](int k) { return k == 0 ? lo : (lo >> k) | (hi << (64 - k)); };
+
+        // Each base of the stem must be the complement of its mirror at the other end of the terminator
+        uint64_t mask = ~uint64_t{0};
+        for (int k = 0; k < TERM_STEM_SIZE; k++)
+            mask &= shifted(k) ^ shifted(TERM_SIZE - 1 - k);
+        masks[word] = mask;
+    }
+
+    if (length_ & 63)
+        masks[nb - 1] &= (uint64_t{1} << (length_ & 63)) - 1;
 }
 
-bool Dna::protein_stop(int pos) {
-    bool is_protein;
-    int t_k;
+void Dna::shine_dal_masks(uint64_t *masks) const {
+    static_assert(SD_TO_START < 64, "The Shine-Dalgarno scan reads at most two words per start position");
 
-    for (int k = 0; k < CODON_SIZE; k++) {
-        t_k = pos + k;
-        if (t_k >= seq_.size())
-            t_k -= seq_.size();
+    int nb = nb_words(length_);
+    for (int word = 0; word < nb; word++) {
+        const uint64_t *words = chunks_[word / CHUNK_WORDS]->words + word % CHUNK_WORDS;
+        uint64_t lo = words[0], hi = words[1];
+        auto shifted = [lo, hi](int k) { return k == 0 ? lo : (lo >> k) | (hi << (64 - k)); };
 
-        if (seq_[t_k] == PROTEIN_END[k]) {
-            is_protein = true;
-        } else {
-            is_protein = false;
-            break;
+        // Each base of the motif (but the spacer) must be that of SHINE_DAL_SEQ
+        uint64_t mask = ~uint64_t{0};
+        for (int k = 0; k < SD_TO_START; k++) {
+            if ((SHINE_DAL_MASK >> k) & 1)
+                mask &= (SHINE_DAL_BITS >> k) & 1 ? shifted(k) : ~shifted(k);
         }
+        masks[word] = mask;
     }
 
-    return is_protein;
+    if (length_ & 63)
+        masks[nb - 1] &= (uint64_t{1} << (length_ & 63)) - 1;
+}
+
+void Dna::to_char(char *dest) const {
+    for (int i = 0; i < length_; i++) {
+        dest[i] = '0' + base_at(i);
+    }
 }
 
-int Dna::codon_at(int pos) {
-    int value = 0;
+std::vector<char> Dna::to_char() const {
+    std::vector<char> seq(length_);
+    to_char(seq.data());
+    return seq;
+}
 
-    int t_pos;
+void Dna::own_chunks() {
+    for (auto &chunk: chunks_)
+        chunk = std::make_shared<Chunk>(*chunk);
+}
 
-    for (int i = 0; i < CODON_SIZE; i++) {
-        t_pos = pos + i;
-        if (t_pos >= seq_.size())
-            t_pos -= seq_.size();
-        if (seq_[t_pos] == '1')
-            value += 1 << (CODON_SIZE - i - 1);
+uint64_t *Dna::mutable_chunk(int chunk_idx) {
+    auto &chunk = chunks_[chunk_idx];
+    // A chunk held only by this Dna can not get shared meanwhile: only a copy of this Dna could share it
+    if (chunk.use_count() > 1)
+        chunk = std::make_shared<Chunk>(*chunk);
+    return chunk->words;
+}
+
+void Dna::flip_base(int pos) {
+    int word_idx = pos >> 6;
+    uint64_t bases = genome_word(word_idx);
+    hash_ ^= word_key(word_idx, bases) ^ word_key(word_idx, bases ^ (uint64_t{1} << (pos & 63)));
+
+    // The base itself, then its copies after the end of the genome (when pos < WINDOW_SIZE)
+    for (int copy_pos = pos; copy_pos < length_ + WINDOW_SIZE; copy_pos += length_) {
+        int idx = copy_pos >> 6;
+        uint64_t mask = uint64_t{1} << (copy_pos & 63);
+
+        mutable_chunk(idx / CHUNK_WORDS)[idx % CHUNK_WORDS] ^= mask;
+        // The first word of a chunk is also stored at the end of the previous one
+        if (idx % CHUNK_WORDS == 0 && idx > 0)
+            mutable_chunk(idx / CHUNK_WORDS - 1)[CHUNK_WORDS] ^= mask;
     }
+}
 
-    return value;
-}
\ No newline at end of file
+void Dna::assign_words(int length, std::vector<uint64_t> words) {
+    length_ = length;
+
+    int nb_stored = nb_stored_words(length);
+    words.resize(nb_stored);
+    if (length & 63)
+        words[length >> 6] &= (uint64_t{1} << (length & 63)) - 1;
+    std::fill(words.begin() + nb_words(length), words.end(), 0);
+
+    // Copy of the first bases after the end of the genome
+    for (int pos = length; pos < length + WINDOW_SIZE; pos++) {
+        int src = pos % length;
+        words[pos >> 6] |= ((words[src >> 6] >> (src & 63)) & 1) << (pos & 63);
+    }
+
+    std::vector<std::shared_ptr<Chunk>> previous;
+    previous.swap(chunks_);
+    chunks_.resize((nb_stored + CHUNK_WORDS - 1) / CHUNK_WORDS);
+    for (int chunk_idx = 0; chunk_idx < (int) chunks_.size(); chunk_idx++) {
+        int first = chunk_idx * CHUNK_WORDS;
+        int last = std::min(first + CHUNK_WORDS + 1, nb_stored);
+        // A whole chunk that did not change is kept (e.g. those before the first rearrangement, see DnaRope)
+        if (last - first == CHUNK_WORDS + 1 && chunk_idx < (int) previous.size() &&
+            std::equal(words.begin() + first, words.begin() + last, previous[chunk_idx]->words)) {
+            chunks_[chunk_idx] = std::move(previous[chunk_idx]);
+            continue;
+        }
+        chunks_[chunk_idx] = std::make_shared<Chunk>();
+        std::copy(words.begin() + first, words.begin() + last, chunks_[chunk_idx]->words);
+    }
+    hash_ = compute_hash();
+}
+
+void Dna::assign_chars(const std::vector<char> &seq) {
+    std::vector<uint64_t> words(nb_words(seq.size()), 0);
+    for (int i = 0; i < (int) seq.size(); i++) {
+        words[i >> 6] |= uint64_t{seq[i] == '1'} << (i & 63);
+    }
+    assign_words(seq.size(), std::move(words));
+}
@@ -4,15 +4,40 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstdio>
+#include <memory>
 #include <vector>
 #include <zlib.h>
 
 #include "Threefry.h"
 #include "aevol_constants.h"
 
+/**
+ * Genome of an Organism, stored with one bit per base (NB_BASE == 2), 64 bases per word.
+ *
+ * Base i is bit (i % 64) of word (i / 64). The genome is circular: the words are followed by a copy of the first
+ * WINDOW_SIZE bases, so that any window of WINDOW_SIZE bases can be read with two word loads and two shifts,
+ * whatever its position. Motif searches are then a XOR against the motif followed by a mask and a popcount.
+ *
+ * The words are stored in chunks of CHUNK_WORDS words shared between copies of a Dna (copy-on-write): a copy only
+ * shares the chunks of the original, and a mutation copies the chunk it modifies if it is still shared. Cloning a
+ * genome and applying a few switches thus only copies the few chunks that hold the switched bases. Each chunk also
+ * holds a copy of the first word of the next chunk, so that window() always reads a single chunk.
+ *
+ * The rearrangements (deletions, insertions, duplications, translocations) are applied to a DnaRope, which packs its
+ * result back in a single pass.
+ *
+ * See CharDna for the former representation (one char per base).
+ */
 class Dna {
+    // Packs its segments into a Dna (see DnaRope::write)
+    friend class DnaRope;
 
 public:
+    /// Number of bases returned by window()
+    static constexpr int WINDOW_SIZE = 64;
+
     Dna() = default;
 
     Dna(const Dna &clone) = default;
@@ -23,10 +48,60 @@ public:
 
     int length() const;
 
-    void save(gzFile backup_file);
+    void save(gzFile backup_file) const;
 
     void load(gzFile backup_file);
 
+    /// Append the genome to buffer, in the packed format of save(gzFile)
+    void save(std::vector<char> &buffer) const;
+
+    /**
+     * Read a genome in the packed format from data, which is moved past it
+     *
+     * @return false if [data, end[ does not start with a packed genome
+     */
+    bool load(const char *&data, const char *end);
+
+    /// Number of bytes written by save_chunks for a genome of `length` bases
+    static size_t chunks_size(int length) {
+        return (nb_stored_words(length) + CHUNK_WORDS - 1) / CHUNK_WORDS * sizeof(Chunk);
+    }
+
+    /// Copy the chunks shared with other genomes or mapped, so that the genome has its own memory, allocated by the
+    /// calling thread (see ExpManager::set_numa)
+    void own_chunks();
+
+    /// Write the chunks of the genome as they are in memory (see map_chunks), false on a write error
+    bool save_chunks(FILE *file) const;
+
+    /**
+     * Replace the genome by `length` bases whose chunks, as written by save_chunks, are at `chunks` (8 bytes aligned)
+     * in a memory mapping. The chunks are used in place and keep `mapping` alive.
+     *
+     * The mapping must be writable (a private one, so that the file is not modified): a chunk held by a single Dna
+     * is mutated in place, like any other.
+     */
+    void map_chunks(const std::shared_ptr<char> &mapping, char *chunks, int length);
+
+    /**
+     * Positions, in increasing order, of the bases that differ from those of reference: the genome is reference
+     * with these positions switched. The chunks still shared with reference are skipped without being read.
+     *
+     * @return false if the genomes do not have the same length or differ at more than max_positions positions
+     */
+    bool differences(const Dna &reference, int max_positions, std::vector<int32_t> &positions) const;
+
+    /**
+     * Hash of the genome, in the manner of a Zobrist hash: the XOR of a key of the length and of a key of each word of
+     * 64 bases (of its index and its bases), so that a switch only changes the key of its word. It is kept up to date
+     * by the mutations: a switch updates it with the keys of its word, a genome replaced as a whole (e.g. by a
+     * DnaRope) computes it again.
+     */
+    uint64_t hash() const { return hash_; }
+
+    /// hash() of a genome given as '0'/'1' characters
+    static uint64_t hash(const char *bases, int length);
+
     void set(int pos, char c);
 
     /// Remove the DNA inbetween pos_1 and pos_2
@@ -42,15 +117,129 @@ public:
 
     void do_duplication(int pos_1, int pos_2, int pos_3);
 
-    int promoter_at(int pos);
+    /// Move the segment [pos_1, pos_2[ (see do_duplication) before pos_3, a position of the genome without it
+    void do_translocation(int pos_1, int pos_2, int pos_3);
+
+    /// Number of mismatches between PROM_SEQ and the bases starting at pos
+    int promoter_at(int pos) const;
+
+    int terminator_at(int pos) const;
+
+    bool shine_dal_start(int pos) const;
+
+    bool protein_stop(int pos) const;
+
+    int codon_at(int pos) const;
+
+    /**
+     * Call f(pos), in increasing order, for every position pos in [pos_1, pos_2[ where a promoter starts, i.e.
+     * where promoter_at(pos) <= PROM_MAX_DIFF.
+     *
+     * The positions are scored 64 at a time (several words at once when AVX2 or AVX-512 is available).
+     */
+    template<typename F>
+    void for_each_promoter(int pos_1, int pos_2, F &&f) const {
+        if (pos_1 >= pos_2) return;
+
+        uint64_t masks[PROMOTER_SCAN_WORDS];
+        int last_word = (pos_2 - 1) >> 6;
+        for (int word = pos_1 >> 6; word <= last_word; word += PROMOTER_SCAN_WORDS) {
+            int nb = last_word - word + 1 < PROMOTER_SCAN_WORDS ? last_word - word + 1 : PROMOTER_SCAN_WORDS;
+            promoter_masks(word, nb, masks);
+
+            for (int i = 0; i < nb; i++) {
+                int base = (word + i) << 6;
+                uint64_t mask = masks[i];
+                // Keep only the positions of [pos_1, pos_2[
+                if (base < pos_1) mask &= ~uint64_t{0} << (pos_1 - base);
+                if (pos_2 - base < 64) mask &= (uint64_t{1} << (pos_2 - base)) - 1;
+
+                for (; mask; mask &= mask - 1) f(base + __builtin_ctzll(mask));
+            }
+        }
+    }
+
+    /**
+     * Set bit k of masks[w] when a terminator starts at position 64 * w + k (i.e. terminator_at() == TERM_STEM_SIZE),
+     * for each of the (length() + 63) / 64 words. The bits after the last base are cleared.
+     */
+    void terminator_masks(uint64_t *masks) const;
+
+    /// Same as terminator_masks, for the positions where a Shine-Dalgarno sequence and its start codon start (i.e.
+    /// shine_dal_start())
+    void shine_dal_masks(uint64_t *masks) const;
+
+    /// Base at pos (0 or 1)
+    int base_at(int pos) const { return (word(pos >> 6) >> (pos & 63)) & 1; }
+
+    /// WINDOW_SIZE bases starting at pos (bit k is the base at pos + k, modulo the length)
+    uint64_t window(int pos) const {
+        int word = pos >> 6;
+        int offset = pos & 63;
+        const uint64_t *words = chunks_[word / CHUNK_WORDS]->words + word % CHUNK_WORDS;
+        // The double shift of the high word avoids an undefined shift by 64 when offset is 0
+        return (words[0] >> offset) | ((words[1] << 1) << (63 - offset));
+    }
+
+    /// Write the genome as ASCII '0'/'1' characters (length() chars, no terminating null)
+    void to_char(char *dest) const;
+
+private:
+    /// Number of words of a chunk (1024 bases)
+    static constexpr int CHUNK_WORDS = 16;
+
+    struct Chunk {
+        // The last word is a copy of the first word of the next chunk
+        uint64_t words[CHUNK_WORDS + 1];
+    };
+
+    /// Number of words scored by a single promoter_masks() call
+    static constexpr int PROMOTER_SCAN_WORDS = 8;
+
+    /// Set bit k of masks[i] when a promoter starts at position 64 * (word + i) + k, for i in [0, nb[
+    void promoter_masks(int word, int nb, uint64_t *masks) const;
+
+    uint64_t word(int idx) const { return chunks_[idx / CHUNK_WORDS]->words[idx % CHUNK_WORDS]; }
+
+    /// Words of a chunk, copied first if they are shared with another Dna
+    uint64_t *mutable_chunk(int chunk_idx);
 
-    int terminator_at(int pos);
+    /// Flip the base at pos, and its copy after the end of the genome if any
+    void flip_base(int pos);
 
-    bool shine_dal_start(int pos);
+    /// Key of the word of index idx holding the given bases (see hash)
+    static uint64_t word_key(int idx, uint64_t bases);
 
-    bool protein_stop(int pos);
+    /// Bases of the word of index idx, without the copy of the first bases that follows the last one
+    uint64_t genome_word(int idx) const {
+        uint64_t bases = word(idx);
+        if (length_ - (idx << 6) < 64) bases &= (uint64_t{1} << (length_ - (idx << 6))) - 1;
+        return bases;
+    }
 
-    int codon_at(int pos);
+    /// hash() computed from the words
+    uint64_t compute_hash() const;
 
-    std::vector<char> seq_;
+    /// Number of words holding `length` bases
+    static int nb_words(int length) { return (length + 63) >> 6; }
+
+    /// Number of words stored for `length` bases: the bases, the copy of the first WINDOW_SIZE ones, and one more
+    /// word so that window() can always read two words
+    static int nb_stored_words(int length) { return ((length + WINDOW_SIZE) >> 6) + 1; }
+
+    /**
+     * Replace the whole genome by `length` bases stored with one bit per base in `words` (nb_words(length) words at
+     * least, whatever follows the last base is ignored). The chunks whose words do not change are kept, still
+     * shared with the copies of the genome.
+     */
+    void assign_words(int length, std::vector<uint64_t> words);
+
+    /// Replace the whole genome by the given '0'/'1' characters
+    void assign_chars(const std::vector<char> &seq);
+
+    std::vector<char> to_char() const;
+
+    std::vector<std::shared_ptr<Chunk>> chunks_;
+    int length_ = 0;
+    uint64_t hash_ = word_key(-1, 0);
 };
@@ -26,47 +26,105 @@
 
 #include "DnaMutator.h"
 
+#include "aevol_constants.h"
+
 /**
- * Constructor for DnaMutator class
- *
- * Generate mutations of the DNA of an Organism
+ * Generate both type of the mutations (see below), replacing those of the previous call
  *
  * @param mut_prng : PRNG to simulate the mutation
- * @param length  : Size of the DNA at the initialization
+ * @param length  : Size of the DNA of the Organism
  * @param mutation_rate : Mutation rate of the organisms
+ * @param rearrangement_rate : Rearrangement rate of the organisms
  */
-DnaMutator::DnaMutator(Threefry::Gen *mut_prng, int length, double mutation_rate) {
-    mut_prng_ = mut_prng;
-    length_ = length;
-    mutation_rate_ = mutation_rate;
-}
-
-/**
- * Generate both type of the mutations (see below)
- */
-void DnaMutator::generate_mutations() {
+void DnaMutator::generate_mutations(Threefry::Gen &mut_prng, int length, double mutation_rate,
+                                    double rearrangement_rate) {
+    mutation_list_.clear();
     hasMutate_ = false;
-    nb_mut_ = mut_prng_->binomial_random(length_, mutation_rate_);
+    nb_mut_ = mut_prng.binomial_random(length, mutation_rate);
 
     if (nb_mut_ > 0) {
+        // The positions are drawn in one batch, from the same counters as nb_mut_ successive random(length) calls
+        positions_.resize(nb_mut_);
+        mut_prng.fill_random(positions_.data(), nb_mut_, length);
         for (int i = 0; i < nb_mut_; ++i) {
-            generate_next_mutation(length_);
+            generate_next_mutation(positions_[i]);
         }
         hasMutate_ = true;
     }
+
+    if (rearrangement_rate > 0.0) {
+        generate_rearrangements(mut_prng, length, rearrangement_rate);
+        hasMutate_ = !mutation_list_.empty();
+    }
+}
+
+namespace {
+    /// Number of bases of the segment [pos_1, pos_2[ of a genome of `length` bases (see Dna::do_duplication)
+    int segment_length(int pos_1, int pos_2, int length) {
+        return pos_1 < pos_2 ? pos_2 - pos_1 : length - pos_1 + pos_2;
+    }
+}
+
+/**
+ * Each rearrangement is a small insertion, a deletion, a duplication or a translocation with the same probability,
+ * its positions being drawn uniformly on the genome left by the previous ones. A rearrangement that would take the
+ * length of the genome out of [MIN_GENOME_LENGTH, MAX_GENOME_LENGTH] is drawn but not applied.
+ */
+void DnaMutator::generate_rearrangements(Threefry::Gen &mut_prng, int length, double rearrangement_rate) {
+    int nb_rearrangements = mut_prng.binomial_random(length, rearrangement_rate);
+
+    for (int i = 0; i < nb_rearrangements; i++) {
+        MutationEvent mevent;
+        switch (mut_prng.random(4)) {
+            case 0: {
+                int pos = mut_prng.random(length);
+                int nb_bases = 1 + mut_prng.random(MAX_INDEL_SIZE);
+                uint32_t bases = mut_prng.random(1u << nb_bases);
+                if (length + nb_bases > MAX_GENOME_LENGTH) continue;
+                mevent.small_insertion(pos, nb_bases, bases);
+                length += nb_bases;
+                break;
+            }
+            case 1: {
+                int pos_1 = mut_prng.random(length);
+                int pos_2 = mut_prng.random(length);
+                int removed = segment_length(pos_1, pos_2, length);
+                if (length - removed < MIN_GENOME_LENGTH) continue;
+                mevent.deletion(pos_1, pos_2);
+                length -= removed;
+                break;
+            }
+            case 2: {
+                int pos_1 = mut_prng.random(length);
+                int pos_2 = mut_prng.random(length);
+                int pos_3 = mut_prng.random(length);
+                int added = segment_length(pos_1, pos_2, length);
+                if (length + added > MAX_GENOME_LENGTH) continue;
+                mevent.duplication(pos_1, pos_2, pos_3);
+                length += added;
+                break;
+            }
+            default: {
+                int pos_1 = mut_prng.random(length);
+                int pos_2 = mut_prng.random(length);
+                int moved = segment_length(pos_1, pos_2, length);
+                // Moving the whole genome would leave it unchanged
+                if (moved == length) continue;
+                mevent.translocation(pos_1, pos_2, mut_prng.random(length - moved));
+                break;
+            }
+        }
+        mutation_list_.push_back(mevent);
+    }
 }
 
 /**
  * Generate the next mutation event for an organism.
  *
- * @param length : Update size of the DNA of the Organism
- * @return The generated mutation event (or nullptr if none was created)
+ * @param pos : Position of the switch
  */
-MutationEvent *DnaMutator::generate_next_mutation(int length) {
-    int pos = mut_prng_->random(length);
-
-    auto mevent = new MutationEvent();
-    mevent->switch_pos(pos);
+void DnaMutator::generate_next_mutation(int pos) {
+    MutationEvent mevent;
+    mevent.switch_pos(pos);
     mutation_list_.push_back(mevent);
-    return mevent;
-};
+}
@@ -26,47 +26,45 @@
 
 #pragma once
 
-#include <list>
+#include <vector>
 
-#include "Organism.h"
 #include "Threefry.h"
 #include "MutationEvent.h"
 
 
 /**
  * Class that generates the mutation events for a given Organism
+ *
+ * A DnaMutator is a reusable slot: each cell of the grid keeps its own one from a generation to the next, and its
+ * list of events keeps its storage, so that generating the mutations does not allocate once the list is big enough.
  */
 class DnaMutator {
 public:
+    DnaMutator() = default;
 
-    DnaMutator(Threefry::Gen *mut_prng, int length, double mutation_rate);
+    /**
+     * Draw the mutations of an organism of `length` bases: switches at mutation_rate per base, then rearrangements at
+     * rearrangement_rate per base (none are drawn, nor random numbers for them, when it is 0)
+     */
+    void generate_mutations(Threefry::Gen &mut_prng, int length, double mutation_rate,
+                            double rearrangement_rate = 0.0);
 
-    ~DnaMutator() {
-        for (auto repl : mutation_list_) {
-            delete repl;
-        }
-        mutation_list_.clear();
-        delete mut_prng_;
-    }
-
-    void generate_mutations();
-
-    MutationEvent *generate_next_mutation(int length);
-
-    std::list<MutationEvent *> mutation_list_;
+    std::vector<MutationEvent> mutation_list_;
 
     bool hasMutate() const { return hasMutate_; }
 
     void setMutate(bool mutate) { hasMutate_ = mutate; }
 
-    // private:
-    Threefry::Gen *mut_prng_;
-    int length_;
+private:
+    void generate_next_mutation(int pos);
 
-    double mutation_rate_;
+    /// Append the rearrangements, of an organism of `length` bases once switched
+    void generate_rearrangements(Threefry::Gen &mut_prng, int length, double rearrangement_rate);
+
+    // Positions of the mutations, kept from a call to the next like mutation_list_
+    std::vector<unsigned int> positions_;
 
     //--------------------------- Mutation counters
     int nb_mut_{};
     bool hasMutate_ = false;
 };
-
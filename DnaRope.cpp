@@ -0,0 +1,185 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "DnaRope.h"
+
+#include <algorithm>
+#include <cassert>
+
+constexpr int32_t DnaRope::INSERTED;
+
+DnaRope::DnaRope(const Dna &dna) : inserted_(1, 0), length_(dna.length()) {
+    sources_.push_back(dna);
+    segments_.push_back(Segment{0, 0, length_});
+}
+
+int DnaRope::base_at(int pos) const {
+    assert(pos >= 0 && pos < length_);
+    int start = 0;
+    for (const auto &segment: segments_) {
+        if (pos < start + segment.length)
+            return window(segment, pos - start) & 1;
+        start += segment.length;
+    }
+    return 0;
+}
+
+void DnaRope::do_switch(int pos) {
+    uint64_t base = base_at(pos) ^ 1;
+    size_t idx = split(pos);
+    split(pos + 1);
+    segments_[idx] = append_inserted(base, 1);
+}
+
+void DnaRope::insert(int pos, uint64_t bases, int nb) {
+    insert_segments(pos, {append_inserted(bases, nb)});
+}
+
+void DnaRope::insert(int pos, const std::vector<char> &seq) {
+    std::vector<Segment> segments;
+    for (size_t first = 0; first < seq.size(); first += 64) {
+        int nb = std::min<size_t>(64, seq.size() - first);
+        uint64_t bases = 0;
+        for (int k = 0; k < nb; k++)
+            bases |= uint64_t{seq[first + k] == '1'} << k;
+        segments.push_back(append_inserted(bases, nb));
+    }
+    insert_segments(pos, segments);
+}
+
+void DnaRope::insert(int pos, const Dna &seq) {
+    sources_.push_back(seq);
+    insert_segments(pos, {Segment{(int32_t) sources_.size() - 1, 0, seq.length()}});
+}
+
+void DnaRope::remove(int pos_1, int pos_2) {
+    if (pos_1 < pos_2) {
+        remove_range(pos_1, pos_2);
+    } else {
+        assert(pos_1 > pos_2);
+        remove_range(pos_1, length_);
+        remove_range(0, pos_2);
+    }
+}
+
+void DnaRope::duplicate(int pos_1, int pos_2, int pos_3) {
+    insert_segments(pos_3, segments_of(pos_1, pos_2));
+}
+
+void DnaRope::translocate(int pos_1, int pos_2, int pos_3) {
+    auto segments = segments_of(pos_1, pos_2);
+    remove(pos_1, pos_2);
+    insert_segments(pos_3, segments);
+}
+
+void DnaRope::write(Dna &dna) const {
+    std::vector<uint64_t> words(Dna::nb_words(length_), 0);
+    int dest = 0;
+    for (const auto &segment: segments_) {
+        for (int offset = 0; offset < segment.length;) {
+            // Up to the end of the destination word
+            int nb = std::min(64 - (dest & 63), segment.length - offset);
+            uint64_t bases = window(segment, offset);
+            if (nb < 64) bases &= (uint64_t{1} << nb) - 1;
+            words[dest >> 6] |= bases << (dest & 63);
+            dest += nb;
+            offset += nb;
+        }
+    }
+    dna.assign_words(length_, std::move(words));
+}
+
+size_t DnaRope::split(int pos) {
+    assert(pos >= 0 && pos <= length_);
+    int start = 0;
+    for (size_t idx = 0; idx < segments_.size(); idx++) {
+        Segment &segment = segments_[idx];
+        if (pos == start)
+            return idx;
+        if (pos < start + segment.length) {
+            Segment tail{segment.source, segment.pos + (pos - start), segment.length - (pos - start)};
+            segment.length = pos - start;
+            segments_.insert(segments_.begin() + idx + 1, tail);
+            return idx + 1;
+        }
+        start += segment.length;
+    }
+    return segments_.size();
+}
+
+std::vector<DnaRope::Segment> DnaRope::segments_of(int pos_1, int pos_2) {
+    if (pos_1 < pos_2) {
+        size_t first = split(pos_1);
+        size_t last = split(pos_2);
+        return std::vector<Segment>(segments_.begin() + first, segments_.begin() + last);
+    }
+
+    // Around the origin: [pos_1, length_[ then [0, pos_2[ (splitting at pos_2 first keeps first valid)
+    size_t last = split(pos_2);
+    size_t first = split(pos_1);
+    std::vector<Segment> segments(segments_.begin() + first, segments_.end());
+    segments.insert(segments.end(), segments_.begin(), segments_.begin() + last);
+    return segments;
+}
+
+void DnaRope::remove_range(int pos_1, int pos_2) {
+    size_t first = split(pos_1);
+    size_t last = split(pos_2);
+    segments_.erase(segments_.begin() + first, segments_.begin() + last);
+    length_ -= pos_2 - pos_1;
+    assert(length_ > 0);
+}
+
+void DnaRope::insert_segments(int pos, const std::vector<Segment> &segments) {
+    size_t idx = split(pos);
+    segments_.insert(segments_.begin() + idx, segments.begin(), segments.end());
+    for (const auto &segment: segments)
+        length_ += segment.length;
+}
+
+DnaRope::Segment DnaRope::append_inserted(uint64_t bases, int nb) {
+    assert(nb > 0 && nb <= 64);
+    if (nb < 64) bases &= (uint64_t{1} << nb) - 1;
+
+    inserted_.resize(std::max(inserted_.size(), (size_t) ((inserted_length_ + nb) >> 6) + 2), 0);
+    int word = inserted_length_ >> 6;
+    int offset = inserted_length_ & 63;
+    inserted_[word] |= bases << offset;
+    if (offset > 0) inserted_[word + 1] |= bases >> (64 - offset);
+
+    Segment segment{INSERTED, inserted_length_, nb};
+    inserted_length_ += nb;
+    return segment;
+}
+
+uint64_t DnaRope::window(const Segment &segment, int offset) const {
+    int pos = segment.pos + offset;
+    if (segment.source != INSERTED)
+        return sources_[segment.source].window(pos);
+
+    const uint64_t *words = inserted_.data() + (pos >> 6);
+    return (words[0] >> (pos & 63)) | ((words[1] << 1) << (63 - (pos & 63)));
+}
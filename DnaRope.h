@@ -0,0 +1,111 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Dna.h"
+
+/**
+ * Genome being rearranged, stored as a sequence of segments: each one a range of bases of a source genome or of the
+ * bases inserted so far. A deletion, an insertion, a duplication or a translocation only splits and moves segments,
+ * whatever their lengths. Once the rearrangements done, write() packs the segments into a Dna, 64 bases at a time,
+ * and the chunks of the genome that did not change stay shared with its copies.
+ *
+ * An operation walks along the segments, a few more per rearrangement: applying k rearrangements to a genome of n
+ * bases costs O(k^2 + n / 64), against O(k * n) when each of them moves the bases that follow it.
+ *
+ * The segments [pos_1, pos_2[ of the operations go around the origin when pos_2 <= pos_1, and are the whole genome
+ * when pos_1 == pos_2 (see Dna::do_duplication).
+ */
+class DnaRope {
+public:
+    explicit DnaRope(const Dna &dna);
+
+    int length() const { return length_; }
+
+    /// Base at pos (0 or 1)
+    int base_at(int pos) const;
+
+    void do_switch(int pos);
+
+    /// Insert nb bases (nb <= 64, bit k of bases being the k-th one) before pos, in [0, length()]
+    void insert(int pos, uint64_t bases, int nb);
+
+    /// Insert '0'/'1' characters before pos
+    void insert(int pos, const std::vector<char> &seq);
+
+    /// Insert the whole genome seq before pos
+    void insert(int pos, const Dna &seq);
+
+    /// Remove [pos_1, pos_2[, which must not be the whole genome
+    void remove(int pos_1, int pos_2);
+
+    /// Insert a copy of [pos_1, pos_2[ before pos_3
+    void duplicate(int pos_1, int pos_2, int pos_3);
+
+    /// Move [pos_1, pos_2[ before pos_3, a position of the genome without the segment
+    void translocate(int pos_1, int pos_2, int pos_3);
+
+    /// Replace the genome of dna by that of the rope
+    void write(Dna &dna) const;
+
+private:
+    struct Segment {
+        // Index in sources_, or INSERTED for the bases of inserted_
+        int32_t source;
+        int32_t pos;
+        int32_t length;
+    };
+
+    static constexpr int32_t INSERTED = -1;
+
+    /// Index of the segment starting at pos, splitting the one holding it if needed (segments_.size() for length())
+    size_t split(int pos);
+
+    /// Segments of [pos_1, pos_2[ (see the class)
+    std::vector<Segment> segments_of(int pos_1, int pos_2);
+
+    /// Remove [pos_1, pos_2[, pos_1 <= pos_2
+    void remove_range(int pos_1, int pos_2);
+
+    void insert_segments(int pos, const std::vector<Segment> &segments);
+
+    /// Segment of the bases appended to inserted_, nb <= 64
+    Segment append_inserted(uint64_t bases, int nb);
+
+    /// 64 bases from the offset-th base of segment (those after its end are undefined)
+    uint64_t window(const Segment &segment, int offset) const;
+
+    std::vector<Dna> sources_;
+    // Bit k of word w is the inserted base 64 * w + k, followed by a word of padding so that window() reads two words
+    std::vector<uint64_t> inserted_;
+    int inserted_length_ = 0;
+    std::vector<Segment> segments_;
+    int length_;
+};
@@ -0,0 +1,131 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "Ensemble.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
+#include "AeTime.h"
+#include "ExpManager.h"
+#include "ProgressLog.h"
+
+bool Ensemble::parse_rates(const char *list, std::vector<double> &rates) {
+    rates.clear();
+    const char *c = list;
+    while (*c != '\0') {
+        char *end;
+        double rate = strtod(c, &end);
+        if (end == c || rate < 0.0 || rate > 1.0 || (*end != ',' && *end != '\0')) return false;
+        rates.push_back(rate);
+        c = *end == ',' ? end + 1 : end;
+    }
+    return !rates.empty();
+}
+
+bool Ensemble::run(const char *summary_file_name) const {
+    FILE *summary = fopen(summary_file_name, "w");
+    if (summary == nullptr) {
+        fprintf(stderr, "Error: could not open ensemble summary %s\n", summary_file_name);
+        return false;
+    }
+
+    const int nb_replicates = (int) mutation_rates.size() * nb_seeds;
+    std::vector<std::unique_ptr<ExpManager>> replicates(nb_replicates);
+    AeTime::set_time(0);
+
+    int max_threads = 1;
+#ifdef USE_OMP
+    max_threads = omp_get_max_threads();
+    // The loops of a replicate run alone in the threads of the rounds
+    omp_set_max_active_levels(1);
+#endif
+    const bool across_replicates = nb_replicates >= max_threads;
+    printf("Ensemble of %d replicates, %s\n", nb_replicates,
+           across_replicates ? "the threads taking the replicates of each generation" : "each one on all the threads");
+
+    // Each one searches its initial organism
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int replicate = 0; replicate < nb_replicates; replicate++) {
+        int replicate_seed = seed + replicate % nb_seeds;
+        double mutation_rate = mutation_rates[replicate / nb_seeds];
+        auto exp_manager = std::make_unique<ExpManager>(height, width, replicate_seed, mutation_rate, genome_size,
+                                                        backup_step, selection_scheme, selection_radius,
+                                                        "replicate_" + std::to_string(replicate));
+        exp_manager->set_rearrangement_rate(rearrangement_rate);
+        exp_manager->set_delta_evaluation(delta_evaluation);
+        exp_manager->set_async_backup(async_backup);
+        exp_manager->set_backup_format(backup_format);
+        exp_manager->set_stats_format(stats_format);
+        exp_manager->set_stats_step(stats_step);
+        exp_manager->set_progress_messages(false);
+        replicates[replicate] = std::move(exp_manager);
+    }
+
+    for (auto &exp_manager: replicates)
+        exp_manager->start_evolution(nb_gen);
+    printf("Running evolution from %d to %d\n", AeTime::time(), AeTime::time() + nb_gen);
+    ProgressLog progress(verbosity, progress_step, progress_interval, progress_file);
+    progress.start(AeTime::time(), AeTime::time() + nb_gen);
+
+    for (int gen = 0; gen < nb_gen; gen++) {
+        AeTime::plusplus();
+
+#pragma omp parallel for schedule(dynamic, 1) if (across_replicates)
+        for (int replicate = 0; replicate < nb_replicates; replicate++)
+            replicates[replicate]->run_generation();
+
+        int best = 0;
+        long long nb_evaluations = replicates[0]->nb_evaluations();
+        for (int replicate = 1; replicate < nb_replicates; replicate++) {
+            if (replicates[replicate]->best_fitness() > replicates[best]->best_fitness()) best = replicate;
+            nb_evaluations += replicates[replicate]->nb_evaluations();
+        }
+        progress.generation(AeTime::time(), replicates[best]->best_fitness(), nb_evaluations, best);
+    }
+    progress.finish();
+
+    fprintf(summary, "Replicate,Seed,Mutation_rate,Best_fitness\n");
+    for (int replicate = 0; replicate < nb_replicates; replicate++) {
+        replicates[replicate]->finish_evolution();
+        fprintf(summary, "%d,%d,%g,%e\n", replicate, seed + replicate % nb_seeds,
+                mutation_rates[replicate / nb_seeds], replicates[replicate]->best_fitness());
+    }
+    replicates.clear();
+
+    if (fclose(summary) != 0) {
+        fprintf(stderr, "Error while writing the ensemble summary %s\n", summary_file_name);
+        return false;
+    }
+    printf("Summary of the %d replicates written to %s\n", nb_replicates, summary_file_name);
+    return true;
+}
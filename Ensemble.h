@@ -0,0 +1,78 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Checkpoint.h"
+#include "SelectionPolicy.h"
+#include "Stats.h"
+
+/**
+ * Ensemble of independent simulations run in one process: nb_seeds replicates (the seeds seed, seed + 1...) for each
+ * of the mutation rates, all of the same grid and genome size.
+ *
+ * The replicates share the environmental target (see ExpManager::environment_target) and the OpenMP threads. Their
+ * generations are interleaved: each round runs the same generation of every replicate. When there are at least as
+ * many replicates as threads, the threads take the replicates of a round one at a time, each one running its loops
+ * alone, which balances replicates of different speeds. Otherwise the replicates of a round run one after the other,
+ * each one with all the threads. A replicate follows the same trajectory as the same simulation run alone.
+ *
+ * Replicate k writes its backups and stats to replicate_k/ (see the output directory of ExpManager), and the summary
+ * file gets a CSV line per replicate (its seed, mutation rate and final best fitness). The progress messages (see
+ * ProgressLog) give the best fitness over the replicates of each round.
+ */
+struct Ensemble {
+    int nb_gen = 1000;
+    int width = 32;
+    int height = 32;
+    int genome_size = 5000;
+    int backup_step = 1000;
+    int seed = 566545665;
+    int nb_seeds = 1;
+    std::vector<double> mutation_rates;
+    double rearrangement_rate = 0.0;
+    SelectionScheme selection_scheme = FITNESS_PROPORTIONAL;
+    int selection_radius = 1;
+    bool delta_evaluation = true;
+    bool async_backup = false;
+    Checkpoint::Format backup_format = Checkpoint::GZIP;
+    Stats::Format stats_format = Stats::CSV;
+    int stats_step = 1;
+    // Progress messages (see ProgressLog)
+    int verbosity = 1;
+    int progress_step = 1;
+    double progress_interval = 0.0;
+    std::string progress_file;
+
+    /// Parse a comma-separated list of mutation rates, false if it is not one
+    static bool parse_rates(const char *list, std::vector<double> &rates);
+
+    /// Run the replicates and write the summary to summary_file_name, false (after printing the cause) on an error
+    bool run(const char *summary_file_name) const;
+};
@@ -0,0 +1,146 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "EvaluationCache.h"
+
+#include <algorithm>
+#include <cassert>
+
+constexpr int EvaluationCache::NB_SHARDS;
+constexpr int32_t EvaluationCache::NONE;
+
+EvaluationCache::EvaluationCache(int capacity) : shard_capacity_(std::max(1, (capacity + NB_SHARDS - 1) / NB_SHARDS)) {
+    assert(capacity > 0);
+    bucket_bits_ = 1;
+    while ((1 << bucket_bits_) < 2 * shard_capacity_)
+        bucket_bits_++;
+    bucket_mask_ = (1u << bucket_bits_) - 1;
+
+    for (auto &shard: shards_) {
+        shard.entries.reserve(shard_capacity_);
+        shard.buckets.assign(1u << bucket_bits_, NONE);
+    }
+}
+
+bool EvaluationCache::find(uint64_t hash, int length, Evaluation &evaluation) {
+    Shard &s = shard(hash);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.nb_lookups++;
+
+    int32_t idx = lookup(s, hash);
+    if (idx == NONE || s.entries[idx].length != length)
+        return false;
+
+    s.nb_hits++;
+    unlink(s, idx);
+    push_front(s, idx);
+    evaluation = s.entries[idx].evaluation;
+    return true;
+}
+
+void EvaluationCache::insert(uint64_t hash, int length, const Evaluation &evaluation) {
+    Shard &s = shard(hash);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    // Another thread may have evaluated the same genome meanwhile
+    if (lookup(s, hash) != NONE)
+        return;
+
+    int32_t idx;
+    if ((int) s.entries.size() < shard_capacity_) {
+        idx = s.entries.size();
+        s.entries.emplace_back();
+    } else {
+        idx = s.least_recent;
+        unlink(s, idx);
+        remove(s, s.entries[idx].hash);
+    }
+
+    Entry &entry = s.entries[idx];
+    entry.hash = hash;
+    entry.length = length;
+    entry.evaluation = evaluation;
+    uint32_t b = bucket(hash);
+    while (s.buckets[b] != NONE)
+        b = (b + 1) & bucket_mask_;
+    s.buckets[b] = idx;
+    push_front(s, idx);
+}
+
+long long EvaluationCache::nb_lookups() const {
+    long long nb = 0;
+    for (const auto &shard: shards_) nb += shard.nb_lookups;
+    return nb;
+}
+
+long long EvaluationCache::nb_hits() const {
+    long long nb = 0;
+    for (const auto &shard: shards_) nb += shard.nb_hits;
+    return nb;
+}
+
+int32_t EvaluationCache::lookup(const Shard &shard, uint64_t hash) const {
+    for (uint32_t b = bucket(hash); shard.buckets[b] != NONE; b = (b + 1) & bucket_mask_) {
+        if (shard.entries[shard.buckets[b]].hash == hash)
+            return shard.buckets[b];
+    }
+    return NONE;
+}
+
+/**
+ * The entries after the bucket of hash, up to the next empty bucket, are moved back into the hole when it is between
+ * their first bucket and theirs: each entry stays reachable from its first bucket without a tombstone.
+ */
+void EvaluationCache::remove(Shard &shard, uint64_t hash) const {
+    uint32_t hole = bucket(hash);
+    while (shard.entries[shard.buckets[hole]].hash != hash)
+        hole = (hole + 1) & bucket_mask_;
+
+    for (uint32_t b = (hole + 1) & bucket_mask_; shard.buckets[b] != NONE; b = (b + 1) & bucket_mask_) {
+        uint32_t first = bucket(shard.entries[shard.buckets[b]].hash);
+        if (((b - first) & bucket_mask_) >= ((b - hole) & bucket_mask_)) {
+            shard.buckets[hole] = shard.buckets[b];
+            hole = b;
+        }
+    }
+    shard.buckets[hole] = NONE;
+}
+
+void EvaluationCache::unlink(Shard &shard, int32_t idx) {
+    Entry &entry = shard.entries[idx];
+    if (entry.prev != NONE) shard.entries[entry.prev].next = entry.next;
+    else shard.most_recent = entry.next;
+    if (entry.next != NONE) shard.entries[entry.next].prev = entry.prev;
+    else shard.least_recent = entry.prev;
+}
+
+void EvaluationCache::push_front(Shard &shard, int32_t idx) {
+    Entry &entry = shard.entries[idx];
+    entry.prev = NONE;
+    entry.next = shard.most_recent;
+    if (shard.most_recent != NONE) shard.entries[shard.most_recent].prev = idx;
+    else shard.least_recent = idx;
+    shard.most_recent = idx;
+}
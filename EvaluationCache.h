@@ -0,0 +1,127 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * Evaluations of the genomes evaluated last, by genome (its hash and length, see Dna::hash), so that a mutant whose
+ * genome was already evaluated (after a back mutation, the same switch in several cells...) takes its evaluation
+ * instead of being evaluated again.
+ *
+ * The evaluation of a genome only depends on it (the target is fixed): an organism that takes the evaluation of its
+ * genome from the cache ends with the same fitness and stats as if it were evaluated, whichever thread filled the
+ * cache first, and the trajectory does not depend on the cache. Two genomes of the same length and hash are taken as
+ * the same genome (a collision of the 64-bit hashes is ignored).
+ *
+ * The cache holds at most about `capacity` evaluations, the least recently used ones being evicted. It is split in
+ * shards by hash, each one locked by its own mutex, so that the threads seldom wait for each other. The evaluations
+ * of a shard are stored in a single preallocated vector, linked in their order of use, and found through a
+ * preallocated open-addressing table of their indices: once allocated by the constructor, the cache allocates nothing.
+ */
+class EvaluationCache {
+public:
+    /// Values of an evaluation, those used by the selection and the stats (see Organism::evaluate(const Evaluation&))
+    struct Evaluation {
+        double fitness = 0.0;
+        double metaerror = 0.0;
+        int nb_genes_activ = 0;
+        int nb_genes_inhib = 0;
+        int nb_func_genes = 0;
+        int nb_non_func_genes = 0;
+        int nb_coding_RNAs = 0;
+        int nb_non_coding_RNAs = 0;
+    };
+
+    explicit EvaluationCache(int capacity);
+
+    EvaluationCache(const EvaluationCache &) = delete;
+
+    EvaluationCache &operator=(const EvaluationCache &) = delete;
+
+    /// Copy to evaluation the evaluation of the genome, which becomes the most recently used one, false if none
+    bool find(uint64_t hash, int length, Evaluation &evaluation);
+
+    /// Add the evaluation of a genome (nothing if it is already there), evicting the least recently used one if full
+    void insert(uint64_t hash, int length, const Evaluation &evaluation);
+
+    /// Number of calls to find() so far, and of those that found the genome (while no thread uses the cache)
+    long long nb_lookups() const;
+
+    long long nb_hits() const;
+
+private:
+    // The shard of a genome is given by the top 6 bits of its hash
+    static constexpr int NB_SHARDS = 64;
+    static constexpr int32_t NONE = -1;
+
+    struct Entry {
+        uint64_t hash;
+        int length;
+        Evaluation evaluation;
+        // Previous (more recently used) and next entries of the shard
+        int32_t prev;
+        int32_t next;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Entry> entries;
+        // Index of the entry of each bucket, NONE if empty: an entry is in the first bucket from that of its hash
+        // (see bucket) that is not taken by another one, the table being at most half full
+        std::vector<int32_t> buckets;
+        int32_t most_recent = NONE;
+        int32_t least_recent = NONE;
+        long long nb_lookups = 0;
+        long long nb_hits = 0;
+    };
+
+    Shard &shard(uint64_t hash) { return shards_[hash >> 58]; }
+
+    /// First bucket of the entry of a hash (Fibonacci hashing, all the bits of the hash being mixed in)
+    uint32_t bucket(uint64_t hash) const { return (hash * 0x9E3779B97F4A7C15llu) >> (64 - bucket_bits_); }
+
+    /// Index of the entry of a hash in shard, NONE if none
+    int32_t lookup(const Shard &shard, uint64_t hash) const;
+
+    /// Take the entry of a hash out of the table of shard, moving back the entries after it to fill its bucket
+    void remove(Shard &shard, uint64_t hash) const;
+
+    /// Take the entry of shard out of its list of use
+    static void unlink(Shard &shard, int32_t idx);
+
+    /// Make the entry of shard the most recently used one
+    static void push_front(Shard &shard, int32_t idx);
+
+    Shard shards_[NB_SHARDS];
+    int shard_capacity_;
+    // Each shard has 2^bucket_bits_ buckets
+    int bucket_bits_;
+    uint32_t bucket_mask_;
+};
@@ -26,7 +26,10 @@
 // ***************************************************************************************************************
 
 
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <omp.h>
+#include <sys/stat.h>
 #include <zlib.h>
 
 using namespace std;
@@ -34,10 +37,20 @@ using namespace std;
 #include "ExpManager.h"
 #include "AeTime.h"
 #include "Gaussian.h"
+#include "Numa.h"
 
 // For time tracing
 #include "Timetracer.h"
 
+namespace {
+    /// Prefix of the paths under an output directory: empty for the working directory, else ending with a '/'
+    std::string directory_prefix(const std::string &output_directory) {
+        if (output_directory.empty() || output_directory.back() == '/')
+            return output_directory;
+        return output_directory + "/";
+    }
+}
+
 /**
  * Constructor for initializing a new simulation
  *
@@ -48,10 +61,15 @@ using namespace std;
  * @param init_length_dna : Size of the randomly generated DNA at the initialization of the simulation
  * @param selection_pressure : Selection pressure used during the selection process
  * @param backup_step : How much often checkpoint must be done
+ * @param selection_scheme : How the reproducer of a cell is drawn among its neighbours
+ * @param selection_radius : The neighbourhood of a cell is the square of side 2 * selection_radius + 1 around it
+ * @param output_directory : Directory of the backup and stats directories, the working directory if empty
  */
 ExpManager::ExpManager(int grid_height, int grid_width, int seed, double mutation_rate, int init_length_dna,
-                       int backup_step)
-        : seed_(seed), rng_(new Threefry(grid_width, grid_height, seed)) {
+                       int backup_step, SelectionScheme selection_scheme, int selection_radius,
+                       const std::string &output_directory)
+        : seed_(seed), rng_(new Threefry(grid_width, grid_height, seed)),
+          output_directory_(directory_prefix(output_directory)) {
     // Initializing the data structure
     grid_height_ = grid_height;
     grid_width_ = grid_width;
@@ -60,20 +78,42 @@ ExpManager::ExpManager(int grid_height, int grid_width, int seed, double mutatio
 
     nb_indivs_ = grid_height * grid_width;
 
-    internal_organisms_ = new std::shared_ptr<Organism>[nb_indivs_];
-    prev_internal_organisms_ = new std::shared_ptr<Organism>[nb_indivs_];
+    population_ = std::make_unique<Population>(nb_indivs_);
 
     next_generation_reproducer_ = new int[nb_indivs_]();
-    dna_mutator_array_ = new DnaMutator *[nb_indivs_];
+    set_selection(selection_scheme, selection_radius);
+    dna_mutator_array_ = new DnaMutator[nb_indivs_];
 
     mutation_rate_ = mutation_rate;
 
-    // Building the target environment
+    target_storage_ = environment_target();
+    target = target_storage_.get();
+    double geometric_area = ExpManager::geometric_area(target);
+
+    printf("Initialized environmental target %f\n", geometric_area);
+
+    auto organism = initial_organism(init_length_dna, target, geometric_area, *rng_);
+
+    printf("Populating the environment\n");
+
+    // Create a population of clones based on the randomly generated organism
+    population_->assign_all(*organism);
+
+    // Create backup and stats directory
+    create_directory(output_directory_);
+}
+
+/**
+ * Compute the environmental target, a sum of three gaussians clipped to [Y_MIN, Y_MAX]
+ *
+ * @param target : the FUZZY_SAMPLING values of the target
+ * @return the geometric area of the target
+ */
+double ExpManager::build_target(double *target) {
     auto *g1 = new Gaussian(1.2, 0.52, 0.12);
     auto *g2 = new Gaussian(-1.4, 0.5, 0.07);
     auto *g3 = new Gaussian(0.3, 0.8, 0.03);
 
-    target = new double[FUZZY_SAMPLING];
     for (int i = 0; i < FUZZY_SAMPLING; i++) {
         double pt_i = ((double) i) / (double) FUZZY_SAMPLING;
 
@@ -91,67 +131,122 @@ ExpManager::ExpManager(int grid_height, int grid_width, int seed, double mutatio
     delete g2;
     delete g3;
 
+    return geometric_area(target);
+}
+
+std::shared_ptr<const double> ExpManager::environment_target() {
+    static const std::shared_ptr<const double> target = [] {
+        std::shared_ptr<double> values(new double[FUZZY_SAMPLING], std::default_delete<double[]>());
+        build_target(values.get());
+        return values;
+    }();
+    return target;
+}
+
+double ExpManager::geometric_area(const double *target) {
     double geometric_area = 0;
     for (int i = 0; i < FUZZY_SAMPLING - 1; i++) {
         // Computing a trapezoid area
         geometric_area += ((fabs(target[i]) + fabs(target[i + 1])) / (2 * (double) FUZZY_SAMPLING));
     }
+    return geometric_area;
+}
 
-    printf("Initialized environmental target %f\n", geometric_area);
-
-
-    // Initializing the PRNGs
-    for (int indiv_id = 0; indiv_id < nb_indivs_; ++indiv_id) {
-        dna_mutator_array_[indiv_id] = nullptr;
-    }
-
-    // Generate a random organism that is better than nothing
-    double r_compare = 0;
-
-    while (r_compare >= 0) {
-        auto random_organism = std::make_shared<Organism>(init_length_dna, rng_->gen(0, Threefry::MUTATION));
-        random_organism->locate_promoters();
-        random_organism->evaluate(target);
-        internal_organisms_[0] = random_organism;
-
-        r_compare = round((random_organism->metaerror - geometric_area) * 1E10) / 1E10;
-    }
-
-    printf("Populating the environment\n");
+/**
+ * Generate a random organism that is better than nothing, the first one drawn from the MUTATION stream of cell 0
+ *
+ * Each candidate takes init_length_dna successive counters of the stream (one per base), so candidate k starts
+ * k * init_length_dna counters ahead: the threads evaluate batches of candidates at once from there (see
+ * Threefry::gen_ahead), and the first viable one of a batch is kept, the stream being moved past it. The organism
+ * and the stream are then those of drawing the candidates one after the other.
+ *
+ * @param init_length_dna : Size of its DNA
+ * @param target : Environmental target (see build_target)
+ * @param geometric_area : Geometric area of the target
+ * @param rng : PRNG of the simulation
+ * @return the evaluated organism
+ */
+std::shared_ptr<Organism> ExpManager::initial_organism(int init_length_dna, const double *target,
+                                                       double geometric_area, Threefry &rng) {
+    // Several candidates per thread, so that the threads rarely wait for each other at the end of a batch
+    constexpr int CANDIDATES_PER_THREAD = 4;
+    const int batch_size = CANDIDATES_PER_THREAD * omp_get_max_threads();
+    std::vector<std::shared_ptr<Organism>> candidates(batch_size);
+
+    for (long long first = 0;; first += batch_size) {
+        // Lowest viable candidate of the batch so far, the ones after it are not evaluated
+        std::atomic<int> first_viable(batch_size);
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int i = 0; i < batch_size; i++) {
+            if (i > first_viable) continue;
+
+            auto candidate = std::make_shared<Organism>(
+                    init_length_dna,
+                    rng.gen_ahead(0, Threefry::MUTATION, (Threefry::crt_value_type) (first + i) * init_length_dna));
+            candidate->locate_promoters();
+            candidate->evaluate(target);
+
+            double r_compare = round((candidate->metaerror - geometric_area) * 1E10) / 1E10;
+            if (r_compare < 0) {
+                int viable = first_viable;
+                while (i < viable && !first_viable.compare_exchange_weak(viable, i)) {}
+                candidates[i] = std::move(candidate);
+            }
+        }
 
-    // Create a population of clones based on the randomly generated organism
-    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
-        prev_internal_organisms_[indiv_id] = internal_organisms_[indiv_id] =
-                std::make_shared<Organism>(internal_organisms_[0]);
+        if (first_viable < batch_size) {
+            rng.advance(0, Threefry::MUTATION, (Threefry::crt_value_type) (first + first_viable + 1) * init_length_dna);
+            return std::move(candidates[first_viable]);
+        }
     }
-
-    // Create backup and stats directory
-    create_directory();
 }
 
 /**
  * Constructor to resume/restore a simulation from a given backup/checkpoint file
  *
  * @param time : resume from this generation
+ * @param output_directory : Directory of the backup and stats directories, the working directory if empty
  */
-ExpManager::ExpManager(int time) {
-    target = new double[FUZZY_SAMPLING];
-
+ExpManager::ExpManager(int time, const std::string &output_directory)
+        : output_directory_(directory_prefix(output_directory)) {
     load(time);
 
-    double geometric_area = 0;
-    for (int i = 0; i < FUZZY_SAMPLING - 1; i++) {
-        // Computing a trapezoid area
-        geometric_area += ((fabs(target[i]) + fabs(target[i + 1])) / (2 * (double) FUZZY_SAMPLING));
-    }
+    printf("Initialized environmental target %f\n", geometric_area(target));
 
-    printf("Initialized environmental target %f\n", geometric_area);
+    dna_mutator_array_ = new DnaMutator[nb_indivs_];
 
-    dna_mutator_array_ = new DnaMutator *[nb_indivs_];
-    for (int indiv_id = 0; indiv_id < nb_indivs_; ++indiv_id) {
-        dna_mutator_array_[indiv_id] = nullptr;
-    }
+}
 
+/**
+ * Snapshot of the simulation to write as a checkpoint (see Checkpoint)
+ *
+ * @param t : simulated time of the checkpoint
+ */
+std::unique_ptr<Checkpoint> ExpManager::snapshot(int t) const {
+    auto checkpoint = std::make_unique<Checkpoint>(*rng_);
+    checkpoint->time = t;
+    checkpoint->grid_height = grid_height_;
+    checkpoint->grid_width = grid_width_;
+    checkpoint->backup_step = backup_step_;
+    checkpoint->mutation_rate = mutation_rate_;
+    checkpoint->rearrangement_rate = rearrangement_rate_;
+    checkpoint->target.assign(target, target + FUZZY_SAMPLING);
+    // Copies of the genomes (sharing their chunks), one per organism of the population: the slots are reused
+    checkpoint->organisms.resize(nb_indivs_);
+#pragma omp parallel for
+    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
+        if (population_->slot(indiv_id) == indiv_id)
+            checkpoint->organisms[indiv_id] = std::make_shared<Organism>(new Dna(*(*population_)[indiv_id].dna_));
+    }
+    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
+        if (population_->slot(indiv_id) != indiv_id)
+            checkpoint->organisms[indiv_id] = checkpoint->organisms[population_->slot(indiv_id)];
+    }
+    checkpoint->selection_scheme = selection_scheme_;
+    checkpoint->selection_radius = selection_radius_;
+    checkpoint->format = backup_format_;
+    return checkpoint;
 }
 
 /**
@@ -160,122 +255,123 @@ ExpManager::ExpManager(int time) {
  * @param t : simulated time of the checkpoint
  */
 void ExpManager::save(int t) const {
+    if (!snapshot(t)->write(backup_file_name(t).c_str()))
+        exit(EXIT_FAILURE);
+}
 
+std::string ExpManager::backup_file_name(int t) const {
     char exp_backup_file_name[255];
-
     sprintf(exp_backup_file_name, "backup/backup_%d.zae", t);
+    return output_directory_ + exp_backup_file_name;
+}
 
-    // -------------------------------------------------------------------------
-    // Open backup files
-    // -------------------------------------------------------------------------
-    gzFile exp_backup_file = gzopen(exp_backup_file_name, "w");
-
-
-    // -------------------------------------------------------------------------
-    // Check that files were correctly opened
-    // -------------------------------------------------------------------------
-    if (exp_backup_file == Z_NULL) {
-        printf("Error: could not open backup file %s\n",
-               exp_backup_file_name);
-        exit(EXIT_FAILURE);
+/**
+ * Snapshot to write as the backup of generation t during the evolution: a delta from the previous backup (see
+ * set_delta_backup) when there is one and the chain of deltas since the last full backup is not complete yet.
+ * The backup then becomes the reference of the next one.
+ *
+ * @param t : simulated time of the checkpoint
+ */
+std::unique_ptr<Checkpoint> ExpManager::backup_snapshot(int t) {
+    auto checkpoint = snapshot(t);
+    if (full_backup_period_ <= 1)
+        return checkpoint;
+
+    if (reference_genomes_ && nb_delta_backups_ < full_backup_period_ - 1) {
+        checkpoint->reference_name = reference_name_;
+        checkpoint->reference_genomes = reference_genomes_;
+        checkpoint->reference_ids = backup_ancestor_;
+        // Only the chunked formats hold deltas
+        if (checkpoint->format == Checkpoint::GZIP || checkpoint->format == Checkpoint::MAPPED)
+            checkpoint->format = Checkpoint::CHUNKED_ZLIB;
+        nb_delta_backups_++;
+    } else {
+        nb_delta_backups_ = 0;
     }
 
+    // Copies of the genomes, that share their chunks with the population
+    auto genomes = std::make_shared<std::vector<Dna>>();
+    genomes->reserve(nb_indivs_);
+    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++)
+        genomes->push_back(*(*population_)[indiv_id].dna_);
+    reference_genomes_ = std::move(genomes);
 
-    // -------------------------------------------------------------------------
-    // Write the backup file
-    // -------------------------------------------------------------------------
-    gzwrite(exp_backup_file, &t, sizeof(t));
-
-    gzwrite(exp_backup_file, &grid_height_, sizeof(grid_height_));
-    gzwrite(exp_backup_file, &grid_width_, sizeof(grid_width_));
-
-    gzwrite(exp_backup_file, &backup_step_, sizeof(backup_step_));
-
-    gzwrite(exp_backup_file, &mutation_rate_, sizeof(mutation_rate_));
-
-    for (int i = 0; i < FUZZY_SAMPLING; i++) {
-        double tmp = target[i];
-        gzwrite(exp_backup_file, &tmp, sizeof(tmp));
-    }
+    char reference_name[255];
+    sprintf(reference_name, "backup_%d.zae", t);
+    reference_name_ = reference_name;
 
-    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
-        prev_internal_organisms_[indiv_id]->save(exp_backup_file);
-    }
+    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++)
+        backup_ancestor_[indiv_id] = indiv_id;
 
-    rng_->save(exp_backup_file);
+    return checkpoint;
+}
 
-    if (gzclose(exp_backup_file) != Z_OK) {
-        cerr << "Error while closing backup file" << endl;
+void ExpManager::set_delta_backup(int full_backup_period) {
+    full_backup_period_ = full_backup_period;
+    if (full_backup_period_ > 1) {
+        backup_ancestor_.assign(nb_indivs_, -1);
+        next_backup_ancestor_.assign(nb_indivs_, -1);
+    } else {
+        backup_ancestor_.clear();
+        next_backup_ancestor_.clear();
     }
+    reference_genomes_.reset();
+    nb_delta_backups_ = 0;
 }
 
 /**
  * Loading a simulation from a checkpoint/backup file
  *
+ * The format of the backup (see Checkpoint) is detected from its first bytes.
+ *
  * @param t : resuming the simulation at this generation
  */
 void ExpManager::load(int t) {
+    std::string exp_backup_file_name = backup_file_name(t);
 
-    char exp_backup_file_name[255];
-
-    sprintf(exp_backup_file_name, "backup/backup_%d.zae", t);
-
-    // -------------------------------------------------------------------------
-    // Open backup files
-    // -------------------------------------------------------------------------
-    gzFile exp_backup_file = gzopen(exp_backup_file_name, "r");
-
-
-    // -------------------------------------------------------------------------
-    // Check that files were correctly opened
-    // -------------------------------------------------------------------------
-    if (exp_backup_file == Z_NULL) {
-        printf("Error: could not open backup file %s\n",
-               exp_backup_file_name);
+    auto checkpoint = Checkpoint::read(exp_backup_file_name.c_str());
+    if (!checkpoint)
+        exit(EXIT_FAILURE);
+    if (checkpoint->first_cell >= 0) {
+        fprintf(stderr, "Error: %s is a shard of a distributed simulation\n", exp_backup_file_name.c_str());
         exit(EXIT_FAILURE);
     }
+    restore(*checkpoint);
+}
 
+/**
+ * Restore the simulation from a checkpoint read from a backup
+ *
+ * @param checkpoint : checkpoint, whose organisms become the population
+ */
+void ExpManager::restore(const Checkpoint &checkpoint) {
+    AeTime::set_time(checkpoint.time);
 
-    // -------------------------------------------------------------------------
-    // Write the backup file
-    // -------------------------------------------------------------------------
-    int time;
-    gzread(exp_backup_file, &time, sizeof(time));
-    AeTime::set_time(time);
-
-    gzread(exp_backup_file, &grid_height_, sizeof(grid_height_));
-
-    gzread(exp_backup_file, &grid_width_, sizeof(grid_width_));
-
+    grid_height_ = checkpoint.grid_height;
+    grid_width_ = checkpoint.grid_width;
     nb_indivs_ = grid_height_ * grid_width_;
 
-    internal_organisms_ = new std::shared_ptr<Organism>[nb_indivs_];
-    prev_internal_organisms_ = new std::shared_ptr<Organism>[nb_indivs_];
+    population_ = std::make_unique<Population>(nb_indivs_);
 
     // No need to save/load this field from the backup because it will be set at selection()
     next_generation_reproducer_ = new int[nb_indivs_]();
 
-    gzread(exp_backup_file, &backup_step_, sizeof(backup_step_));
-
-    gzread(exp_backup_file, &mutation_rate_, sizeof(mutation_rate_));
+    backup_step_ = checkpoint.backup_step;
+    mutation_rate_ = checkpoint.mutation_rate;
+    rearrangement_rate_ = checkpoint.rearrangement_rate;
+    // The target of the backup, which may not be that of the new simulations
+    std::shared_ptr<double> restored_target(new double[FUZZY_SAMPLING], std::default_delete<double[]>());
+    std::copy(checkpoint.target.begin(), checkpoint.target.end(), restored_target.get());
+    target_storage_ = std::move(restored_target);
+    target = target_storage_.get();
 
-    for (int i = 0; i < FUZZY_SAMPLING; i++) {
-        double tmp;
-        gzread(exp_backup_file, &tmp, sizeof(tmp));
-        target[i] = tmp;
-    }
+    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++)
+        population_->assign(indiv_id, *checkpoint.organisms[indiv_id]);
 
-    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
-        prev_internal_organisms_[indiv_id] = internal_organisms_[indiv_id] =
-                std::make_shared<Organism>(exp_backup_file);
-    }
-
-    rng_ = std::move(std::make_unique<Threefry>(grid_width_, grid_height_, exp_backup_file));
+    rng_ = std::make_unique<Threefry>(checkpoint.rng);
     seed_ = rng_->get_seed();
 
-    if (gzclose(exp_backup_file) != Z_OK) {
-        cerr << "Error while closing backup file" << endl;
-    }
+    set_selection(checkpoint.selection_scheme, checkpoint.selection_radius);
 }
 
 /**
@@ -287,10 +383,7 @@ ExpManager::~ExpManager() {
 
     delete[] dna_mutator_array_;
 
-    delete[] internal_organisms_;
-    delete[] prev_internal_organisms_;
     delete[] next_generation_reproducer_;
-    delete[] target;
 }
 
 /**
@@ -298,117 +391,294 @@ ExpManager::~ExpManager() {
  *
   * @param indiv_id : Unique identification number of the cell
  */
+template<class Selection>
 void ExpManager::selection(int indiv_id) const {
-    double local_fit_array[NEIGHBORHOOD_SIZE];
-    double probs[NEIGHBORHOOD_SIZE];
-    int count = 0;
-    double sum_local_fit = 0.0;
-
-    int32_t x = indiv_id / grid_height_;
-    int32_t y = indiv_id % grid_height_;
-
-    int cur_x, cur_y;
-
-    for (int8_t i = -1; i < NEIGHBORHOOD_WIDTH - 1; i++) {
-        for (int8_t j = -1; j < NEIGHBORHOOD_HEIGHT - 1; j++) {
-            cur_x = (x + i + grid_width_) % grid_width_;
-            cur_y = (y + j + grid_height_) % grid_height_;
+    auto rng = std::move(rng_->gen(indiv_id, Threefry::REPROD));
+    int found_org = Selection::draw(*selection_engine_, indiv_id, rng);
+    next_generation_reproducer_[indiv_id] = selection_engine_->neighbor(indiv_id, found_org);
+}
 
-            local_fit_array[count] = prev_internal_organisms_[cur_x * grid_width_ + cur_y]->fitness;
-            sum_local_fit += local_fit_array[count];
+/**
+ * Prepare the mutation generation of an organism
+ *
+ * @param indiv_id : Organism unique id
+ */
+void ExpManager::prepare_mutation(int indiv_id) const {
+    auto rng = std::move(rng_->gen(indiv_id, Threefry::MUTATION));
+    const int parent_slot = population_->slot(next_generation_reproducer_[indiv_id]);
+    dna_mutator_array_[indiv_id].generate_mutations(rng, population_->in_slot(parent_slot).length(), mutation_rate_,
+                                                       rearrangement_rate_);
 
-            count++;
-        }
+    if (dna_mutator_array_[indiv_id].hasMutate()) {
+        population_->mutant(indiv_id, parent_slot);
+    } else {
+        // The parent is shared with every other clone of it: its mutation stats were already cleared at the end of
+        // the previous generation (see run_a_step), so nothing is written to it here.
+        population_->clone(indiv_id, parent_slot);
     }
+}
 
-    for (int8_t i = 0; i < NEIGHBORHOOD_SIZE; i++) {
-        probs[i] = local_fit_array[i] / sum_local_fit;
-    }
+void ExpManager::evaluate_mutant(int indiv_id) const {
+    if (evaluate_from_cache(indiv_id))
+        return;
+
+    Organism &mutant = population_->next(indiv_id);
+    if (delta_evaluation_)
+        mutant.evaluate(target, (*population_)[next_generation_reproducer_[indiv_id]]);
+    else
+        mutant.evaluate(target);
+    mutant.compute_protein_stats();
+    cache_evaluation(indiv_id);
+}
 
-    auto rng = std::move(rng_->gen(indiv_id, Threefry::REPROD));
-    int found_org = rng.roulette_random(probs, NEIGHBORHOOD_SIZE);
+bool ExpManager::evaluate_from_cache(int indiv_id) const {
+    if (evaluation_cache_ == nullptr)
+        return false;
 
-    int x_offset = (found_org / NEIGHBORHOOD_WIDTH) - 1;
-    int y_offset = (found_org % NEIGHBORHOOD_HEIGHT) - 1;
+    Organism &mutant = population_->next(indiv_id);
+    EvaluationCache::Evaluation evaluation;
+    if (!evaluation_cache_->find(mutant.dna_->hash(), mutant.length(), evaluation))
+        return false;
+    mutant.evaluate(evaluation);
+    return true;
+}
 
-    next_generation_reproducer_[indiv_id] = ((x + x_offset + grid_width_) % grid_width_) * grid_height_ +
-                                            ((y + y_offset + grid_height_) % grid_height_);
+void ExpManager::cache_evaluation(int indiv_id) const {
+    if (evaluation_cache_ != nullptr) {
+        const Organism &mutant = population_->next(indiv_id);
+        evaluation_cache_->insert(mutant.dna_->hash(), mutant.length(), mutant.evaluation());
+    }
 }
 
 /**
- * Prepare the mutation generation of an organism
+ * Evaluate the mutants of the generation on the threads, the most costly first
  *
- * @param indiv_id : Organism unique id
+ * The cost of a mutant is estimated from its length (the bases its promoters and terminators are searched in) and
+ * the bases transcribed by its parent (those its proteins are searched and translated from). The threads take the
+ * mutants one at a time, in decreasing order of cost: the long evaluations start first and the short ones fill the
+ * gaps at the end, instead of a long one being left last.
  */
-void ExpManager::prepare_mutation(int indiv_id) const {
-    auto *rng = new Threefry::Gen(std::move(rng_->gen(indiv_id, Threefry::MUTATION)));
-    const shared_ptr<Organism> &parent = prev_internal_organisms_[next_generation_reproducer_[indiv_id]];
-    dna_mutator_array_[indiv_id] = new DnaMutator(
-            rng,
-            parent->length(),
-            mutation_rate_);
-    dna_mutator_array_[indiv_id]->generate_mutations();
-
-    if (dna_mutator_array_[indiv_id]->hasMutate()) {
-        internal_organisms_[indiv_id] = std::make_shared<Organism>(parent);
-    } else {
-        int parent_id = next_generation_reproducer_[indiv_id];
+void ExpManager::evaluate_mutants() {
+    mutant_cells_.clear();
+    mutant_costs_.clear();
+    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
+        if (!dna_mutator_array_[indiv_id].hasMutate()) continue;
+
+        const Organism &parent = (*population_)[next_generation_reproducer_[indiv_id]];
+        long long cost = population_->next(indiv_id).length();
+        for (const auto &rna: parent.rnas)
+            cost += rna.length;
+        mutant_cells_.push_back(indiv_id);
+        mutant_costs_.push_back(cost);
+    }
 
-        internal_organisms_[indiv_id] = prev_internal_organisms_[parent_id];
-        internal_organisms_[indiv_id]->reset_mutation_stats();
+    // Decreasing cost, then increasing cell
+    mutant_order_.resize(mutant_cells_.size());
+    for (int i = 0; i < (int) mutant_order_.size(); i++)
+        mutant_order_[i] = i;
+    std::sort(mutant_order_.begin(), mutant_order_.end(), [this](int a, int b) {
+        return mutant_costs_[a] > mutant_costs_[b] || (mutant_costs_[a] == mutant_costs_[b] && a < b);
+    });
+
+    const int nb_mutants = mutant_order_.size();
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < nb_mutants; i++) {
+        int indiv_id = mutant_cells_[mutant_order_[i]];
+        TIMESTAMP_ID(EVALUATION, indiv_id, evaluate_mutant(indiv_id);)
     }
 }
 
+namespace {
+    // Cells of a chunk of the loops over all the cells (but with set_numa): most of their work is a selection and a
+    // copy, the mutants being evaluated apart
+    constexpr int CELL_CHUNK = 16;
+}
+
 /**
  * Execute a generation of the simulation for all the Organisms
  *
+ * Every loop is thread-parallel and gives the same result whatever the number of threads: each cell only draws from
+ * its own PRNG streams (see Threefry::Gen), only writes its own slots of the population arrays, and the search for
+ * the best individual keeps the lowest index on ties, like the serial loop.
+ *
+ * The selection scheme is a template parameter, see set_selection for the instantiated ones.
  */
+template<class Selection>
 void ExpManager::run_a_step() {
 
-    // Running the simulation process for each organism
-    //#pragma omp parallel for
-    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
-        selection(indiv_id);
-        prepare_mutation(indiv_id);
+    // Fitness of the neighbourhoods of every cell, from the previous generation
+    TIMESTAMP(FITNESS_GRID, selection_engine_->prepare(*population_, Selection::NEEDS_PROBABILITIES);)
 
-        if (dna_mutator_array_[indiv_id]->hasMutate()) {
-            auto &mutant = internal_organisms_[indiv_id];
-            mutant->apply_mutations(dna_mutator_array_[indiv_id]->mutation_list_);
-            mutant->evaluate(target);
+    // The reproducer and the mutations of each cell, in chunks of cells (the static blocks of the cells with
+    // set_numa, whose threads then evaluate their mutants right away)
+    const bool evaluate_in_place = numa_;
+#pragma omp parallel for schedule(runtime)
+    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
+        TIMESTAMP_ID(SELECTION, indiv_id, selection<Selection>(indiv_id);)
+        TIMESTAMP_ID(MUTATION, indiv_id, prepare_mutation(indiv_id);)
+
+        if (dna_mutator_array_[indiv_id].hasMutate()) {
+            Organism &mutant = population_->next(indiv_id);
+            TIMESTAMP_ID(MUTATION, indiv_id, mutant.apply_mutations(dna_mutator_array_[indiv_id].mutation_list_);)
+            if (evaluate_in_place)
+                TIMESTAMP_ID(EVALUATION, indiv_id, evaluate_mutant(indiv_id);)
         }
     }
 
+    if (!evaluate_in_place)
+        evaluate_mutants();
+
     // Swap Population
-    //#pragma omp parallel for
-    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
-        prev_internal_organisms_[indiv_id] = internal_organisms_[indiv_id];
-        internal_organisms_[indiv_id] = nullptr;
+    population_->swap();
+
+    // Ancestors in the last backup, for the next delta
+    if (!backup_ancestor_.empty()) {
+#pragma omp parallel for
+        for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++)
+            next_backup_ancestor_[indiv_id] = backup_ancestor_[next_generation_reproducer_[indiv_id]];
+        backup_ancestor_.swap(next_backup_ancestor_);
     }
 
-    // Search for the best
-    double best_fitness = prev_internal_organisms_[0]->fitness;
+    if (lineage_log_ != nullptr &&
+        !lineage_log_->append(AeTime::time(), next_generation_reproducer_, dna_mutator_array_))
+        exit(EXIT_FAILURE);
+
+    const time_tracer::Start stats_start = time_tracer::enabled() ? time_tracer::begin() : time_tracer::Start{};
+
+    // A single pass over the population: search for the best, gather the values of the stats, clear the mutation
+    // stats of the mutants and count the bases
+    const bool with_stats = !benchmark_mode_ && AeTime::time() % stats_step_ == 0;
+    const double first_fitness = (*population_)[0].fitness;
+    double best_fitness = first_fitness;
     int idx_best = 0;
-    for (int indiv_id = 1; indiv_id < nb_indivs_; indiv_id++) {
-        if (prev_internal_organisms_[indiv_id]->fitness > best_fitness) {
-            idx_best = indiv_id;
-            best_fitness = prev_internal_organisms_[indiv_id]->fitness;
+#pragma omp parallel
+    {
+        double local_best_fitness = first_fitness;
+        int local_idx_best = 0;
+        long long local_nb_evaluations = 0;
+        long long local_evaluated_bases = 0;
+        long long local_bases = 0;
+        const bool with_trajectory = trajectory_checker_ != nullptr;
+
+#pragma omp for nowait
+        for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
+            Organism &organism = (*population_)[indiv_id];
+            if (organism.fitness > local_best_fitness) {
+                local_idx_best = indiv_id;
+                local_best_fitness = organism.fitness;
+            }
+
+            if (with_stats)
+                organism_values_[indiv_id] = Stats::OrganismValues(organism);
+
+            // The mutants of this generation become the clones of the next one: clear their mutation stats now,
+            // while each of them is still only held by the cell that created it
+            if (dna_mutator_array_[indiv_id].hasMutate()) {
+                organism.reset_mutation_stats();
+                local_nb_evaluations++;
+                local_evaluated_bases += organism.length();
+            }
+            local_bases += organism.length();
+
+            if (with_trajectory) {
+                next_genome_hashes_[indiv_id] = dna_mutator_array_[indiv_id].hasMutate()
+                                                ? organism.dna_->hash()
+                                                : genome_hashes_[next_generation_reproducer_[indiv_id]];
+                cell_fitness_[indiv_id] = organism.fitness;
+            }
+        }
+
+#pragma omp critical
+        {
+            nb_evaluations_ += local_nb_evaluations;
+            nb_evaluated_bases_ += local_evaluated_bases;
+            nb_population_bases_ += local_bases;
+            if (local_best_fitness > best_fitness ||
+                (local_best_fitness == best_fitness && local_idx_best < idx_best)) {
+                idx_best = local_idx_best;
+                best_fitness = local_best_fitness;
+            }
         }
     }
-    best_indiv = prev_internal_organisms_[idx_best];
+    best_cell_ = idx_best;
 
-    // Stats
-    stats_best->reinit(AeTime::time());
-    stats_mean->reinit(AeTime::time());
+    if (trajectory_checker_ != nullptr) {
+        genome_hashes_.swap(next_genome_hashes_);
+        check_trajectory();
+    }
 
-    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
-        if (dna_mutator_array_[indiv_id]->hasMutate())
-            prev_internal_organisms_[indiv_id]->compute_protein_stats();
+    // Stats, from the values gathered before the mutation stats were cleared
+    if (with_stats) {
+        stats_best->reinit(AeTime::time());
+        stats_mean->reinit(AeTime::time());
+
+        stats_best->compute_best(organism_values_[idx_best]);
+        stats_mean->compute_average(organism_values_.data(), nb_indivs_);
+
+        stats_best->write_best(nullptr);
+        stats_mean->write_average(nullptr, nb_indivs_);
     }
 
-    stats_best->write_best(best_indiv);
-    stats_mean->write_average(prev_internal_organisms_, nb_indivs_);
+    if (time_tracer::enabled())
+        time_tracer::record(time_tracer::STATS, stats_start);
+}
+
+
+/**
+ * Record or verify the current generation (see TrajectoryChecker), from the genome hashes and fitness gathered by the
+ * last step (or the first evaluation)
+ */
+void ExpManager::check_trajectory() {
+    if (!trajectory_checker_->check(AeTime::time(), nb_indivs_, cell_fitness_.data(), genome_hashes_.data()))
+        exit(EXIT_FAILURE);
 }
 
+template<template<int> class Selection>
+ExpManager::StepFunction ExpManager::step_function(int radius) {
+    static_assert(MAX_SELECTION_RADIUS == 3, "Instantiate the step for every radius");
+    switch (radius) {
+        case 1:
+            return &ExpManager::run_a_step<Selection<1>>;
+        case 2:
+            return &ExpManager::run_a_step<Selection<2>>;
+        case 3:
+            return &ExpManager::run_a_step<Selection<3>>;
+        default:
+            return nullptr;
+    }
+}
+
+/**
+ * Select the selection scheme and its neighbourhood, i.e. the instantiation of run_a_step
+ *
+ * @param scheme : How the reproducer of a cell is drawn among its neighbours
+ * @param radius : The neighbourhood of a cell is the square of side 2 * radius + 1 around it
+ */
+void ExpManager::set_selection(SelectionScheme scheme, int radius) {
+    switch (scheme) {
+        case FITNESS_PROPORTIONAL:
+            run_a_step_ = step_function<FitnessProportionalSelection>(radius);
+            break;
+        case TOURNAMENT:
+            run_a_step_ = step_function<TournamentSelection>(radius);
+            break;
+        case RANK:
+            run_a_step_ = step_function<RankSelection>(radius);
+            break;
+        default:
+            run_a_step_ = nullptr;
+    }
+
+    if (run_a_step_ == nullptr) {
+        printf("Error: no selection scheme %d with a radius of %d (the radius must be in [1, %d])\n", scheme, radius,
+               MAX_SELECTION_RADIUS);
+        exit(EXIT_FAILURE);
+    }
+
+    selection_scheme_ = scheme;
+    selection_radius_ = radius;
+    selection_engine_ = std::make_unique<SelectionEngine>(grid_width_, grid_height_, 2 * radius + 1, 2 * radius + 1);
+}
 
 /**
  * Run the evolution for a given number of generation
@@ -416,40 +686,146 @@ void ExpManager::run_a_step() {
  * @param nb_gen : Number of generations to simulate
  */
 void ExpManager::run_evolution(int nb_gen) {
-    INIT_TRACER("trace.csv", {"FirstEvaluation", "STEP"});
+    start_evolution(nb_gen);
+    for (int gen = 0; gen < nb_gen; gen++) {
+        AeTime::plusplus();
+        run_generation();
+    }
+    finish_evolution();
+}
+
+/**
+ * Prepare the population for the generations of run_generation: the first evaluation, and the stats, the trajectory
+ * and the lineage from the current generation
+ *
+ * @param nb_gen : Number of generations that will be run (for the progress messages only)
+ */
+void ExpManager::start_evolution(int nb_gen) {
+    // The loops over the cells of schedule(runtime)
+    if (numa_) {
+        int nb_nodes = numa::pin_threads();
+        if (nb_nodes > 0) printf("NUMA: %d threads pinned on %d nodes\n", omp_get_max_threads(), nb_nodes);
+        else printf("NUMA: the threads could not be pinned, the cells keep a static schedule\n");
+        omp_set_schedule(omp_sched_static, 0);
+
+        // The population on the nodes of the threads of the cells, before its first evaluation: each cell gets its
+        // own copy of its organism
+#pragma omp parallel for schedule(runtime)
+        for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++)
+            population_->mutant(indiv_id, population_->slot(indiv_id)).dna_->own_chunks();
+        population_->swap();
+    } else {
+        omp_set_schedule(omp_sched_dynamic, CELL_CHUNK);
+    }
 
-    TIMESTAMP(0, {
+    TIMESTAMP(FIRST_EVALUATION, {
+        _Pragma("omp parallel for schedule(runtime)")
         for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
-            internal_organisms_[indiv_id]->locate_promoters();
-            prev_internal_organisms_[indiv_id]->evaluate(target);
-            prev_internal_organisms_[indiv_id]->compute_protein_stats();
+            // Once per organism, in the slot of the cell holding it
+            if (population_->slot(indiv_id) != indiv_id) continue;
+            Organism &organism = (*population_)[indiv_id];
+            organism.locate_promoters();
+            organism.evaluate(target);
+            organism.compute_protein_stats();
         }
     });
-    FLUSH_TRACES(0)
+    FLUSH_TRACES(AeTime::time())
+
+    if (trajectory_checker_ != nullptr) {
+        genome_hashes_.resize(nb_indivs_);
+        next_genome_hashes_.resize(nb_indivs_);
+        cell_fitness_.resize(nb_indivs_);
+#pragma omp parallel for
+        for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
+            genome_hashes_[indiv_id] = (*population_)[indiv_id].dna_->hash();
+            cell_fitness_[indiv_id] = (*population_)[indiv_id].fitness;
+        }
+        check_trajectory();
+    }
+
+    // The population the lineage is logged from
+    if (lineage_log_ != nullptr) {
+        struct stat status;
+        if (stat(backup_file_name(AeTime::time()).c_str(), &status) != 0)
+            save(AeTime::time());
+    }
 
     // Stats
-    stats_best = new Stats(AeTime::time(), true);
-    stats_mean = new Stats(AeTime::time(), false);
+    if (!benchmark_mode_) {
+        stats_best = new Stats(AeTime::time(), true, stats_format_, output_directory_);
+        stats_mean = new Stats(AeTime::time(), false, stats_format_, output_directory_);
+        organism_values_.resize(nb_indivs_);
 
-    printf("Running evolution from %d to %d\n", AeTime::time(), AeTime::time() + nb_gen);
+        if (progress_messages_)
+            printf("Running evolution from %d to %d\n", AeTime::time(), AeTime::time() + nb_gen);
+    }
 
-    for (int gen = 0; gen < nb_gen; gen++) {
-        AeTime::plusplus();
+    // Progress messages
+    if (benchmark_mode_ || !progress_messages_) {
+        progress_log_.reset();
+    } else {
+        if (progress_log_ == nullptr)
+            progress_log_.reset(new ProgressLog());
+        progress_log_->start(AeTime::time(), AeTime::time() + nb_gen);
+    }
+}
 
-        TIMESTAMP(1, run_a_step();)
+/**
+ * Run the generation AeTime::time() (already advanced by the caller), then write its backup if it is due
+ */
+void ExpManager::run_generation() {
+    TIMESTAMP(STEP, (this->*run_a_step_)();)
+
+    if (progress_log_ != nullptr)
+        progress_log_->generation(AeTime::time(), best_fitness(), nb_evaluations_);
+
+    if (!benchmark_mode_ && AeTime::time() % backup_step_ == 0) {
+        TIMESTAMP(BACKUP, {
+            std::string exp_backup_file_name = backup_file_name(AeTime::time());
+            auto checkpoint = backup_snapshot(AeTime::time());
+            // A resume from this backup keeps the stats up to this generation
+            stats_best->flush();
+            stats_mean->flush();
+            if (async_backup_) {
+                if (!checkpoint_writer_.submit(std::move(checkpoint), exp_backup_file_name))
+                    exit(EXIT_FAILURE);
+            } else {
+                if (!checkpoint->write(exp_backup_file_name.c_str()))
+                    exit(EXIT_FAILURE);
+                if (progress_log_ != nullptr)
+                    progress_log_->backup(AeTime::time());
+            }
+        })
+    }
 
-        printf("Generation %d : Best individual fitness %e\n", AeTime::time(), best_indiv->fitness);
-        FLUSH_TRACES(gen)
+    FLUSH_TRACES(AeTime::time())
+}
 
-        for (int indiv_id = 0; indiv_id < nb_indivs_; ++indiv_id) {
-            delete dna_mutator_array_[indiv_id];
-            dna_mutator_array_[indiv_id] = nullptr;
-        }
+/// End the generations of run_generation: the lineage is finished and the backup being written is waited for
+void ExpManager::finish_evolution() {
+    // The progress messages before the others
+    if (progress_log_ != nullptr) {
+        progress_log_->finish();
+        progress_log_.reset();
+    }
 
-        if (AeTime::time() % backup_step_ == 0) {
-            save(AeTime::time());
-            cout << "Backup for generation " << AeTime::time() << " done !" << endl;
+    if (evaluation_cache_ != nullptr && !benchmark_mode_) {
+        printf("Evaluation cache: %lld hits out of %lld lookups\n", evaluation_cache_->nb_hits(),
+               evaluation_cache_->nb_lookups());
+    }
+
+    if (lineage_log_ != nullptr) {
+        if (!lineage_log_->finish())
+            exit(EXIT_FAILURE);
+        lineage_log_.reset();
+    }
+
+    if (async_backup_) {
+        if (wait_backup_) {
+            if (!checkpoint_writer_.wait())
+                exit(EXIT_FAILURE);
+        } else {
+            checkpoint_writer_.cancel();
         }
     }
-    STOP_TRACER
 }
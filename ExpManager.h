@@ -27,11 +27,21 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "Abstract_ExpManager.h"
+#include "Checkpoint.h"
+#include "CheckpointWriter.h"
 #include "Threefry.h"
 #include "DnaMutator.h"
+#include "EvaluationCache.h"
+#include "LineageLog.h"
 #include "Organism.h"
+#include "Population.h"
+#include "ProgressLog.h"
+#include "SelectionEngine.h"
+#include "SelectionPolicy.h"
 #include "Stats.h"
 
 /**
@@ -45,9 +55,10 @@ class ExpManager : public Abstract_ExpManager {
 #endif
 public:
     ExpManager(int grid_height, int grid_width, int seed, double mutation_rate, int init_length_dna,
-               int backup_step);
+               int backup_step, SelectionScheme selection_scheme = FITNESS_PROPORTIONAL, int selection_radius = 1,
+               const std::string &output_directory = "");
 
-    explicit ExpManager(int time);
+    explicit ExpManager(int time, const std::string &output_directory = "");
 
     ~ExpManager() override;
 
@@ -57,34 +68,229 @@ public:
 
     void run_evolution(int nb_gen) override;
 
+    /**
+     * The steps of run_evolution, for a driver interleaving the generations of several simulations (see Ensemble):
+     * start_evolution, then run_generation after each AeTime::plusplus(), then finish_evolution
+     */
+    void start_evolution(int nb_gen);
+
+    void run_generation();
+
+    void finish_evolution();
+
+    /// Print the fitness of the best individual at each generation of run_evolution, and the backups done (default)
+    void set_progress_messages(bool progress_messages) { progress_messages_ = progress_messages; }
+
+    /**
+     * Channel of the progress messages of run_evolution (see ProgressLog), for its verbosity, rate and progress file.
+     * A default one (every generation at verbosity 1) is used if log is nullptr.
+     */
+    void set_progress_log(std::unique_ptr<ProgressLog> log) { progress_log_ = std::move(log); }
+
+    /**
+     * Rate per base of the rearrangements (see DnaMutator::generate_rearrangements), 0 (switches only) by default. It
+     * is saved in the backups, and resuming restores it.
+     */
+    void set_rearrangement_rate(double rearrangement_rate) { rearrangement_rate_ = rearrangement_rate; }
+
+    /// Evaluate the mutants from their parent (see Organism::evaluate(const double*, const Organism&)), on by default
+    void set_delta_evaluation(bool delta_evaluation) { delta_evaluation_ = delta_evaluation; }
+
+    /**
+     * Write the backups in a background thread (see CheckpointWriter) while the next generations run, off by default.
+     * At the end of run_evolution, the backup being written is either waited for or abandoned (its file is not
+     * created).
+     */
+    void set_async_backup(bool async_backup, bool wait_at_exit = true) {
+        async_backup_ = async_backup;
+        wait_backup_ = wait_at_exit;
+    }
+
+    /// Format of the backups written from now on (see Checkpoint), GZIP by default. Both formats can be resumed from.
+    void set_backup_format(Checkpoint::Format format) { backup_format_ = format; }
+
+    /**
+     * Write the backups of run_evolution as deltas from the previous one (see Checkpoint), except one in
+     * full_backup_period, which bounds the number of backups read to restore one. The deltas are written in a
+     * chunked format (CHUNKED_ZLIB if the backup format is not a chunked one). The first backup after a resume is a
+     * full one. Off (full backups only) if full_backup_period is at most 1, the default.
+     */
+    void set_delta_backup(int full_backup_period);
+
+    /// Format of the stats files (see Stats), CSV by default
+    void set_stats_format(Stats::Format format) { stats_format_ = format; }
+
+    /// Write the stats of the generations that are multiples of stats_step only, 1 (every generation) by default
+    void set_stats_step(int stats_step) { stats_step_ = stats_step; }
+
+    /// Run without stats, backups nor progress messages, to measure the speed of the simulation alone (off by default)
+    void set_benchmark_mode(bool benchmark_mode) { benchmark_mode_ = benchmark_mode; }
+
+    /**
+     * Take the evaluation of a mutant from the evaluations of the last `capacity` genomes evaluated when its genome
+     * is among them (see EvaluationCache), none (the default) if capacity is 0. The trajectory does not depend on it.
+     */
+    void set_evaluation_cache(int capacity) {
+        evaluation_cache_.reset(capacity > 0 ? new EvaluationCache(capacity) : nullptr);
+    }
+
+    /**
+     * Run with the threads pinned on the NUMA nodes (see numa::pin_threads), off by default. The cells are then
+     * evaluated with a static schedule: each thread always evaluates the same block of cells, the blocks of a node
+     * making a strip of columns of the grid. The organisms of the population are copied by the threads of their cells
+     * at the start of run_evolution, and the mutants are built by them, so that the memory of a cell is on the node
+     * evaluating it (first touch), and the selection only reads other nodes along the borders of the strips.
+     */
+    void set_numa(bool numa) { numa_ = numa; }
+
+    /**
+     * Log the reproducer and the mutations of every cell at each generation of run_evolution (see LineageLog), none
+     * (the default) if log is nullptr. A backup of the generation it starts from is written if there is none, so that
+     * every logged organism can be rebuilt. The log is finished at the end of run_evolution.
+     */
+    void set_lineage_log(std::unique_ptr<LineageLog> log) { lineage_log_ = std::move(log); }
+
+    /// Number of organisms evaluated by the generations of run_evolution so far (the mutants), and of their bases
+    long long nb_evaluations() const { return nb_evaluations_; }
+
+    long long nb_evaluated_bases() const { return nb_evaluated_bases_; }
+
+    /// Sum over the generations of run_evolution so far of the number of bases of the population
+    long long nb_population_bases() const { return nb_population_bases_; }
+
+    int nb_indivs() const { return nb_indivs_; }
+
+    /// Fitness of the best individual of the last generation run
+    double best_fitness() const { return (*population_)[best_cell_].fitness; }
+
+    /// Compute the environmental target (FUZZY_SAMPLING values), return its geometric area
+    static double build_target(double *target);
+
+    /// The target of build_target, computed once and shared (read-only) by all the new simulations of the process
+    static std::shared_ptr<const double> environment_target();
+
+    static double geometric_area(const double *target);
+
+    /// Random organism of init_length_dna bases better than nothing, from which a simulation starts (evaluated)
+    static std::shared_ptr<Organism> initial_organism(int init_length_dna, const double *target,
+                                                      double geometric_area, Threefry &rng);
+
 private:
+    typedef void (ExpManager::*StepFunction)();
+
+    template<class Selection>
     void run_a_step();
 
+    /// run_a_step instantiated for the given scheme and radius (nullptr if not instantiated)
+    template<template<int> class Selection>
+    static StepFunction step_function(int radius);
+
+    /// Select the scheme and radius of the selection (exits on a radius without an instantiated step)
+    void set_selection(SelectionScheme scheme, int radius);
+
     void prepare_mutation(int indiv_id) const;
 
+    /// Evaluate the mutant of a cell on this thread
+    void evaluate_mutant(int indiv_id) const;
+
+    /// Take the evaluation of the mutant of a cell from the evaluation cache, false if its genome is not in it
+    bool evaluate_from_cache(int indiv_id) const;
+
+    /// Add the evaluation of the mutant of a cell to the evaluation cache, if any
+    void cache_evaluation(int indiv_id) const;
+
+    /// Evaluate the mutants of the generation on the threads
+    void evaluate_mutants();
+
+    template<class Selection>
     void selection(int indiv_id) const;
 
-    std::shared_ptr<Organism> *internal_organisms_;
-    std::shared_ptr<Organism> *prev_internal_organisms_;
-    std::shared_ptr<Organism> best_indiv;
+    std::unique_ptr<Checkpoint> snapshot(int t) const;
+
+    std::string backup_file_name(int t) const;
+
+    std::unique_ptr<Checkpoint> backup_snapshot(int t);
+
+    void restore(const Checkpoint &checkpoint);
+
+    /// Check the current generation with the trajectory checker, exit on a divergence
+    void check_trajectory();
+
+    // The current generation, and the next one during run_a_step
+    std::unique_ptr<Population> population_;
+    // Cell of the best individual of the current generation
+    int best_cell_ = 0;
 
     int *next_generation_reproducer_;
-    DnaMutator **dna_mutator_array_;
+    std::unique_ptr<SelectionEngine> selection_engine_;
+    SelectionScheme selection_scheme_ = FITNESS_PROPORTIONAL;
+    int selection_radius_ = 1;
+    StepFunction run_a_step_ = nullptr;
+    // One reusable slot per cell
+    DnaMutator *dna_mutator_array_;
 
     int nb_indivs_;
 
     int seed_;
     std::unique_ptr<Threefry> rng_;
 
-    double *target;
+    // The FUZZY_SAMPLING values of the environmental target, shared with the other simulations of the same environment
+    std::shared_ptr<const double> target_storage_;
+    const double *target;
 
     Stats *stats_best = nullptr;
     Stats *stats_mean = nullptr;
+    Stats::Format stats_format_ = Stats::CSV;
+    int stats_step_ = 1;
+    // Values of each organism for the stats of the current generation
+    std::vector<Stats::OrganismValues> organism_values_;
+
+    // Trajectory: the genome hash of each cell (updated for the mutants only), and the fitness of each cell
+    std::vector<uint64_t> genome_hashes_;
+    std::vector<uint64_t> next_genome_hashes_;
+    std::vector<double> cell_fitness_;
+
+    bool benchmark_mode_ = false;
+    bool progress_messages_ = true;
+    // Prefix of the backup and stats directories (empty, or ending with a '/')
+    std::string output_directory_;
+    long long nb_evaluations_ = 0;
+    long long nb_evaluated_bases_ = 0;
+    long long nb_population_bases_ = 0;
 
     int grid_height_;
     int grid_width_;
 
     double mutation_rate_;
+    double rearrangement_rate_ = 0.0;
 
     int backup_step_;
+
+    bool delta_evaluation_ = true;
+    bool numa_ = false;
+
+    // The cells of the mutants of the current generation, the estimated cost of the evaluation of each one, and the
+    // order in which they are evaluated (see evaluate_mutants), as indices in mutant_cells_
+    std::vector<int> mutant_cells_;
+    std::vector<long long> mutant_costs_;
+    std::vector<int> mutant_order_;
+
+    std::unique_ptr<EvaluationCache> evaluation_cache_;
+    std::unique_ptr<LineageLog> lineage_log_;
+    // Only during run_evolution, when the progress messages are on
+    std::unique_ptr<ProgressLog> progress_log_;
+
+    bool async_backup_ = false;
+    bool wait_backup_ = true;
+    Checkpoint::Format backup_format_ = Checkpoint::GZIP;
+    CheckpointWriter checkpoint_writer_;
+
+    // Delta backups: the genomes of the last backup and its file name, and for each cell the index in it of the
+    // ancestor of its organism (only tracked when the deltas are on)
+    int full_backup_period_ = 0;
+    int nb_delta_backups_ = 0;
+    std::shared_ptr<const std::vector<Dna>> reference_genomes_;
+    std::string reference_name_;
+    std::vector<int32_t> backup_ancestor_;
+    std::vector<int32_t> next_backup_ancestor_;
 };
@@ -0,0 +1,399 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "LineageLog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+namespace {
+    constexpr int BLOCK_HEADER_SIZE = 4;
+
+    void put(std::vector<char> &buffer, int32_t value) {
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+    }
+
+    /// Sequential reader of the records of an uncompressed block, which checks that they fit in it
+    class RecordCursor {
+    public:
+        RecordCursor(const char *data, size_t size) : data_(data), size_(size) {}
+
+        bool get(int32_t &value) {
+            if (pos_ + sizeof(value) > size_) return false;
+            memcpy(&value, data_ + pos_, sizeof(value));
+            pos_ += sizeof(value);
+            return true;
+        }
+
+        bool skip(size_t nb_values) {
+            if (pos_ + nb_values * sizeof(int32_t) > size_) return false;
+            pos_ += nb_values * sizeof(int32_t);
+            return true;
+        }
+
+        size_t pos() const { return pos_; }
+
+        void seek(size_t pos) { pos_ = pos; }
+
+    private:
+        const char *data_;
+        size_t size_;
+        size_t pos_ = 0;
+    };
+
+    /// Number of int32 fields following the type of a mutation
+    int nb_fields(int32_t type) {
+        switch (type) {
+            case DO_SWITCH:
+                return 1;
+            case SMALL_INSERTION:
+                return 3;
+            case DELETION:
+                return 2;
+            case DUPLICATION:
+            case TRANSLOCATION:
+                return 3;
+            default:
+                return -1;
+        }
+    }
+
+    /**
+     * Read the record of a generation of nb_indivs cells, into record when it is not nullptr (else only skip it)
+     *
+     * @return false if the record does not fit in the block or holds an unknown mutation
+     */
+    bool read_record(RecordCursor &cursor, int nb_indivs, int32_t &generation, LineageReader::Generation *record) {
+        if (!cursor.get(generation))
+            return false;
+
+        if (record == nullptr) {
+            // Skip the reproducers, then the mutations from their counts
+            std::vector<int32_t> counts(nb_indivs);
+            if (!cursor.skip(nb_indivs)) return false;
+            for (auto &count: counts)
+                if (!cursor.get(count)) return false;
+            for (int32_t count: counts) {
+                for (int i = 0; i < count; i++) {
+                    int32_t type;
+                    if (!cursor.get(type) || nb_fields(type) < 0 || !cursor.skip(nb_fields(type))) return false;
+                }
+            }
+            return true;
+        }
+
+        record->reproducers.resize(nb_indivs);
+        record->mutations.resize(nb_indivs);
+        for (auto &reproducer: record->reproducers)
+            if (!cursor.get(reproducer)) return false;
+
+        std::vector<int32_t> counts(nb_indivs);
+        for (auto &count: counts)
+            if (!cursor.get(count)) return false;
+
+        for (int indiv_id = 0; indiv_id < nb_indivs; indiv_id++) {
+            auto &mutations = record->mutations[indiv_id];
+            mutations.resize(counts[indiv_id]);
+            for (auto &mutation: mutations) {
+                int32_t type, fields[3];
+                if (!cursor.get(type) || nb_fields(type) < 0) return false;
+                for (int i = 0; i < nb_fields(type); i++)
+                    if (!cursor.get(fields[i])) return false;
+
+                switch (type) {
+                    case DO_SWITCH:
+                        mutation.switch_pos(fields[0]);
+                        break;
+                    case SMALL_INSERTION:
+                        mutation.small_insertion(fields[0], fields[1], (uint32_t) fields[2]);
+                        break;
+                    case DELETION:
+                        mutation.deletion(fields[0], fields[1]);
+                        break;
+                    case DUPLICATION:
+                        mutation.duplication(fields[0], fields[1], fields[2]);
+                        break;
+                    case TRANSLOCATION:
+                        mutation.translocation(fields[0], fields[1], fields[2]);
+                        break;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+std::unique_ptr<LineageLog> LineageLog::create(const char *file_name, int nb_indivs, int first_generation) {
+    std::unique_ptr<LineageLog> log(new LineageLog(file_name, nb_indivs));
+    log->file_ = fopen(file_name, "wb");
+    if (log->file_ == nullptr) {
+        fprintf(stderr, "Error: could not create lineage file %s\n", file_name);
+        return nullptr;
+    }
+
+    int32_t header[4] = {LINEAGE_MAGIC, LINEAGE_VERSION, nb_indivs, first_generation};
+    if (fwrite(header, sizeof(header), 1, log->file_) != 1) {
+        fprintf(stderr, "Error while writing the lineage file %s\n", file_name);
+        return nullptr;
+    }
+    log->first_generation_ = log->last_generation_ = first_generation;
+    return log;
+}
+
+LineageLog::~LineageLog() {
+    if (file_ != nullptr) finish();
+}
+
+bool LineageLog::append(int generation, const int *reproducers, const DnaMutator *mutators) {
+    if (block_size_ == 0) block_generation_ = generation;
+
+    put(block_, generation);
+    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++)
+        put(block_, reproducers[indiv_id]);
+    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++)
+        put(block_, mutators[indiv_id].hasMutate() ? (int32_t) mutators[indiv_id].mutation_list_.size() : 0);
+
+    for (int indiv_id = 0; indiv_id < nb_indivs_; indiv_id++) {
+        if (!mutators[indiv_id].hasMutate()) continue;
+        for (const auto &mutation: mutators[indiv_id].mutation_list_) {
+            put(block_, mutation.type());
+            switch (mutation.type()) {
+                case DO_SWITCH:
+                    put(block_, mutation.pos_1());
+                    break;
+                case SMALL_INSERTION:
+                    put(block_, mutation.pos_1());
+                    put(block_, mutation.nb_bases());
+                    put(block_, (int32_t) mutation.bases());
+                    break;
+                case DELETION:
+                    put(block_, mutation.pos_1());
+                    put(block_, mutation.pos_2());
+                    break;
+                default:
+                    put(block_, mutation.pos_1());
+                    put(block_, mutation.pos_2());
+                    put(block_, mutation.pos_3());
+            }
+        }
+    }
+
+    last_generation_ = generation;
+    if (++block_size_ == GENERATIONS_PER_BLOCK)
+        return submit_block();
+    return true;
+}
+
+bool LineageLog::submit_block() {
+    bool previous_success = wait();
+
+    written_block_.swap(block_);
+    block_.clear();
+    int32_t first_generation = block_generation_;
+    int32_t nb_generations = block_size_;
+    block_size_ = 0;
+
+    thread_ = std::thread([this, first_generation, nb_generations]() {
+        uLongf compressed_size = compressBound(written_block_.size());
+        std::vector<Bytef> compressed(compressed_size);
+        success_ = compress2(compressed.data(), &compressed_size, (const Bytef *) written_block_.data(),
+                             written_block_.size(), Z_DEFAULT_COMPRESSION) == Z_OK;
+        if (!success_) return;
+
+        int32_t header[BLOCK_HEADER_SIZE] = {first_generation, nb_generations, (int32_t) written_block_.size(),
+                                             (int32_t) compressed_size};
+        success_ = fwrite(header, sizeof(header), 1, file_) == 1 &&
+                   fwrite(compressed.data(), compressed_size, 1, file_) == 1;
+    });
+
+    return previous_success;
+}
+
+bool LineageLog::wait() {
+    if (thread_.joinable()) {
+        thread_.join();
+        if (!success_)
+            fprintf(stderr, "Error while writing the lineage file %s\n", file_name_.c_str());
+    }
+    return success_;
+}
+
+bool LineageLog::finish() {
+    bool ok = block_size_ == 0 || submit_block();
+    ok = wait() && ok;
+    ok = fclose(file_) == 0 && ok;
+    file_ = nullptr;
+    if (!ok) {
+        fprintf(stderr, "Error while writing the lineage file %s\n", file_name_.c_str());
+        return false;
+    }
+    printf("Lineage of generations %d to %d logged to %s\n", first_generation_ + 1, last_generation_,
+           file_name_.c_str());
+    return true;
+}
+
+std::unique_ptr<LineageReader> LineageReader::open(const char *file_name) {
+    std::unique_ptr<LineageReader> reader(new LineageReader(file_name));
+    reader->file_ = fopen(file_name, "rb");
+    if (reader->file_ == nullptr) {
+        fprintf(stderr, "Error: could not open lineage file %s\n", file_name);
+        return nullptr;
+    }
+
+    int32_t header[4];
+    if (fread(header, sizeof(header), 1, reader->file_) != 1 || header[0] != LINEAGE_MAGIC ||
+        header[1] != LINEAGE_VERSION || header[2] <= 0) {
+        fprintf(stderr, "Error: %s is not a lineage file\n", file_name);
+        return nullptr;
+    }
+    reader->nb_indivs_ = header[2];
+    reader->first_generation_ = header[3];
+
+    fseek(reader->file_, 0, SEEK_END);
+    long file_size = ftell(reader->file_);
+    long offset = sizeof(header);
+
+    // The headers of the blocks, up to the first incomplete one (the log of an interrupted run)
+    while (true) {
+        int32_t block_header[BLOCK_HEADER_SIZE];
+        if (fseek(reader->file_, offset, SEEK_SET) != 0 ||
+            fread(block_header, sizeof(block_header), 1, reader->file_) != 1)
+            break;
+
+        Block block{block_header[0], block_header[1], (uint32_t) block_header[2], (uint32_t) block_header[3],
+                    offset + (long) sizeof(block_header)};
+        if (block.offset + (long) block.compressed_size > file_size || block.nb_generations <= 0)
+            break;
+        reader->blocks_.push_back(block);
+        offset = block.offset + block.compressed_size;
+    }
+    return reader;
+}
+
+LineageReader::~LineageReader() {
+    if (file_ != nullptr) fclose(file_);
+}
+
+int LineageReader::last_generation() const {
+    if (blocks_.empty()) return first_generation_;
+    return blocks_.back().first_generation + blocks_.back().nb_generations - 1;
+}
+
+bool LineageReader::load_block(int block_idx) {
+    if (block_idx == loaded_block_)
+        return true;
+
+    const Block &block = blocks_[block_idx];
+    std::vector<Bytef> compressed(block.compressed_size);
+    block_.resize(block.raw_size);
+    uLongf raw_size = block.raw_size;
+    if (fseek(file_, block.offset, SEEK_SET) != 0 ||
+        fread(compressed.data(), compressed.size(), 1, file_) != 1 ||
+        uncompress((Bytef *) block_.data(), &raw_size, compressed.data(), compressed.size()) != Z_OK ||
+        raw_size != block.raw_size) {
+        fprintf(stderr, "Error: the block of generation %d of %s is corrupted\n", block.first_generation,
+                file_name_.c_str());
+        loaded_block_ = -1;
+        return false;
+    }
+
+    // Where the record of each generation starts
+    record_offsets_.clear();
+    RecordCursor cursor(block_.data(), block_.size());
+    for (int i = 0; i < block.nb_generations; i++) {
+        record_offsets_.push_back(cursor.pos());
+        int32_t record_generation;
+        if (!read_record(cursor, nb_indivs_, record_generation, nullptr) ||
+            record_generation != block.first_generation + i) {
+            fprintf(stderr, "Error: the block of generation %d of %s is corrupted\n", block.first_generation,
+                    file_name_.c_str());
+            loaded_block_ = -1;
+            return false;
+        }
+    }
+    loaded_block_ = block_idx;
+    return true;
+}
+
+bool LineageReader::read(int generation, Generation &record) {
+    // First block starting after the generation
+    auto next = std::upper_bound(blocks_.begin(), blocks_.end(), generation,
+                                 [](int generation, const Block &block) {
+                                     return generation < block.first_generation;
+                                 });
+    if (next == blocks_.begin() || generation >= (next - 1)->first_generation + (next - 1)->nb_generations) {
+        fprintf(stderr, "Error: generation %d is not in the lineage file %s\n", generation, file_name_.c_str());
+        return false;
+    }
+    int block_idx = (int) (next - blocks_.begin()) - 1;
+    if (!load_block(block_idx))
+        return false;
+
+    // The records were checked by load_block
+    RecordCursor cursor(block_.data(), block_.size());
+    cursor.seek(record_offsets_[generation - blocks_[block_idx].first_generation]);
+    int32_t record_generation;
+    return read_record(cursor, nb_indivs_, record_generation, &record);
+}
+
+std::shared_ptr<Organism> LineageReader::rebuild(const Checkpoint &checkpoint, int generation, int indiv_id) {
+    if ((int) checkpoint.organisms.size() != nb_indivs_ || checkpoint.first_cell >= 0) {
+        fprintf(stderr, "Error: the backup is not one of the %d cells of the lineage\n", nb_indivs_);
+        return nullptr;
+    }
+    if (checkpoint.time < first_generation_ || checkpoint.time > generation) {
+        fprintf(stderr, "Error: the backup of generation %d is not between the generations %d and %d\n",
+                checkpoint.time, first_generation_, generation);
+        return nullptr;
+    }
+    if (indiv_id < 0 || indiv_id >= nb_indivs_) {
+        fprintf(stderr, "Error: there is no cell %d\n", indiv_id);
+        return nullptr;
+    }
+
+    // The cell of the ancestor at each generation since the backup, and the mutations of its mutant
+    int nb_generations = generation - checkpoint.time;
+    std::vector<int> cells(nb_generations + 1);
+    std::vector<std::vector<MutationEvent>> mutations(nb_generations + 1);
+    cells[nb_generations] = indiv_id;
+    Generation record;
+    for (int i = nb_generations; i > 0; i--) {
+        if (!read(checkpoint.time + i, record))
+            return nullptr;
+        mutations[i] = std::move(record.mutations[cells[i]]);
+        cells[i - 1] = record.reproducers[cells[i]];
+    }
+
+    auto organism = std::make_shared<Organism>(new Dna(*checkpoint.organisms[cells[0]]->dna_));
+    organism->locate_promoters();
+    for (int i = 1; i <= nb_generations; i++) {
+        if (!mutations[i].empty())
+            organism->apply_mutations(mutations[i]);
+    }
+    return organism;
+}
@@ -0,0 +1,181 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Checkpoint.h"
+#include "DnaMutator.h"
+#include "MutationEvent.h"
+#include "Organism.h"
+
+/**
+ * Streaming log of the genealogy of a simulation: for each generation, the reproducer of every cell (the cell of the
+ * previous generation it descends from) and the mutations of its mutant (see DnaMutator). With a backup of an earlier
+ * generation, it is enough to rebuild the genome of any organism (see LineageReader::rebuild).
+ *
+ * A lineage file is a header {LINEAGE_MAGIC, LINEAGE_VERSION, number of cells, first generation} followed by blocks
+ * of (at most) GENERATIONS_PER_BLOCK generations, each compressed with zlib: {int32 first generation, int32 number of
+ * generations, uint32 uncompressed size, uint32 compressed size} then the compressed records. The record of a
+ * generation is {int32 generation, then for each cell its int32 reproducer, then for each cell its int32 number of
+ * mutations, then the mutations of each cell in order}. A mutation is its int32 type followed by its int32 fields:
+ * the position of a switch, the position, number of bases and bases of a small insertion, the 2 positions of a
+ * deletion, or the 3 positions of a duplication or a translocation.
+ *
+ * The generations are appended by the simulation thread into an uncompressed block, which is compressed and written
+ * by a background thread once full, while the next one fills. One block is written at a time: submitting the next
+ * one first waits for the previous one.
+ */
+class LineageLog {
+public:
+    static constexpr int GENERATIONS_PER_BLOCK = 64;
+
+    /**
+     * Log to file_name the generations following first_generation of a grid of nb_indivs cells, nullptr (after
+     * printing the cause) if the file cannot be created
+     */
+    static std::unique_ptr<LineageLog> create(const char *file_name, int nb_indivs, int first_generation);
+
+    LineageLog(const LineageLog &) = delete;
+
+    LineageLog &operator=(const LineageLog &) = delete;
+
+    /// Writes the generations not written yet (see finish)
+    ~LineageLog();
+
+    /**
+     * Append a generation: the reproducer of each cell and the mutations of each mutator (none when it did not mutate)
+     *
+     * @return false, after printing the cause, if a previous block could not be written
+     */
+    bool append(int generation, const int *reproducers, const DnaMutator *mutators);
+
+    /// Write the last block and close the file, false (after printing the cause) if the log could not be written
+    bool finish();
+
+private:
+    LineageLog(std::string file_name, int nb_indivs) : file_name_(std::move(file_name)), nb_indivs_(nb_indivs) {}
+
+    /// Start writing the current block in the background, once the previous one is written
+    bool submit_block();
+
+    /// Wait for the block being written, false if it could not be written
+    bool wait();
+
+    std::string file_name_;
+    int nb_indivs_;
+    FILE *file_ = nullptr;
+
+    // Block being filled: its first generation, its number of generations and its uncompressed records
+    int block_generation_ = 0;
+    int block_size_ = 0;
+    std::vector<char> block_;
+
+    // Block being written by the thread, and whether it could be written (read once the thread is joined)
+    std::thread thread_;
+    std::vector<char> written_block_;
+    bool success_ = true;
+
+    int first_generation_ = -1;
+    int last_generation_ = -1;
+};
+
+/**
+ * Reader of a lineage file (see LineageLog), with random access by generation: the headers of the blocks are read
+ * when the file is opened, then only the block holding a generation is read and decompressed.
+ */
+class LineageReader {
+public:
+    /// Records of a generation (see LineageLog)
+    struct Generation {
+        std::vector<int32_t> reproducers;
+        std::vector<std::vector<MutationEvent>> mutations;
+    };
+
+    /// Open a lineage file, nullptr (after printing the cause) if it cannot be read
+    static std::unique_ptr<LineageReader> open(const char *file_name);
+
+    LineageReader(const LineageReader &) = delete;
+
+    LineageReader &operator=(const LineageReader &) = delete;
+
+    ~LineageReader();
+
+    int nb_indivs() const { return nb_indivs_; }
+
+    /// Generation whose population the first logged generation descends from
+    int first_generation() const { return first_generation_; }
+
+    /// Last logged generation (first_generation() if none)
+    int last_generation() const;
+
+    /// Read the records of a logged generation, false (after printing the cause) if it cannot be read
+    bool read(int generation, Generation &record);
+
+    /**
+     * Rebuild the organism of a cell at a logged generation: its ancestor in checkpoint, found by going up the
+     * reproducers, with the mutations of every generation since applied
+     *
+     * @param checkpoint : backup of a generation in [first_generation(), generation] of the same simulation
+     * @return the organism (not evaluated), nullptr (after printing the cause) if it cannot be rebuilt
+     */
+    std::shared_ptr<Organism> rebuild(const Checkpoint &checkpoint, int generation, int indiv_id);
+
+private:
+    struct Block {
+        int first_generation;
+        int nb_generations;
+        uint32_t raw_size;
+        uint32_t compressed_size;
+        long offset;
+    };
+
+    explicit LineageReader(std::string file_name) : file_name_(std::move(file_name)) {}
+
+    /// Decompress a block into block_ and find its records, false (after printing the cause) if it cannot be read
+    bool load_block(int block_idx);
+
+    std::string file_name_;
+    FILE *file_ = nullptr;
+    int nb_indivs_ = 0;
+    int first_generation_ = 0;
+    std::vector<Block> blocks_;
+
+    // Last block read, uncompressed, and the offset in it of the record of each of its generations
+    int loaded_block_ = -1;
+    std::vector<char> block_;
+    std::vector<size_t> record_offsets_;
+};
+
+// "AEVL": start of a lineage file
+constexpr int32_t LINEAGE_MAGIC = 0x4c564541;
+constexpr int32_t LINEAGE_VERSION = 1;
@@ -0,0 +1,786 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "MpiExpManager.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "AeTime.h"
+#include "ExpManager.h"
+#include "Timetracer.h"
+
+namespace {
+    /// Tags of the messages of a generation (those between neighbours are tagged by their direction)
+    enum Tag : int {
+        HALO_TO_LEFT = 1, HALO_TO_RIGHT, REQUESTS_TO_LEFT, REQUESTS_TO_RIGHT, GENOMES_TO_LEFT, GENOMES_TO_RIGHT,
+        BEST_VALUES, AVERAGE_SUMS
+    };
+
+    /// Directions of the neighbouring ranks, for the arrays indexed by them
+    enum Side {
+        LEFT = 0, RIGHT = 1
+    };
+
+    /// a modulo b, in [0, b[ whatever the sign of a
+    inline int wrap(int a, int b) {
+        return (a % b + b) % b;
+    }
+
+    /// First column of the strip of rank among nb_ranks (nb_ranks is the end of the last strip)
+    int first_column(int rank, int nb_ranks, int grid_width) {
+        return rank * (grid_width / nb_ranks) + std::min(rank, grid_width % nb_ranks);
+    }
+
+    /// Marker of a list of switched positions among the genomes sent (a packed genome starts with its negative length)
+    constexpr int32_t SWITCH_LIST_RECORD = 0;
+
+    template<typename T>
+    void append(std::vector<char> &buffer, const T *values, size_t nb) {
+        const char *bytes = reinterpret_cast<const char *>(values);
+        buffer.insert(buffer.end(), bytes, bytes + nb * sizeof(T));
+    }
+
+    /// Receive a message whose size is not known in advance
+    template<typename T>
+    void receive(std::vector<T> &buffer, MPI_Datatype type, int source, int tag) {
+        MPI_Status status;
+        MPI_Probe(source, tag, MPI_COMM_WORLD, &status);
+        int count;
+        MPI_Get_count(&status, type, &count);
+        buffer.resize(count);
+        MPI_Recv(buffer.data(), count, type, source, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    }
+}
+
+/**
+ * Constructor for initializing a new simulation (collective), see ExpManager
+ *
+ * Every rank draws the same initial organism, and only creates the clones of its strip.
+ */
+MpiExpManager::MpiExpManager(int grid_height, int grid_width, int seed, double mutation_rate, int init_length_dna,
+                             int backup_step, SelectionScheme selection_scheme, int selection_radius)
+        : grid_height_(grid_height), grid_width_(grid_width), nb_indivs_(grid_height * grid_width),
+          rng_(new Threefry(grid_width, grid_height, seed)), target_(FUZZY_SAMPLING),
+          mutation_rate_(mutation_rate), backup_step_(backup_step) {
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+    MPI_Comm_size(MPI_COMM_WORLD, &nb_ranks_);
+
+    split_grid(selection_radius);
+    set_selection(selection_scheme, selection_radius);
+
+    double geometric_area = ExpManager::build_target(target_.data());
+    if (rank_ == 0)
+        printf("Initialized environmental target %f\n", geometric_area);
+
+    auto initial_organism = ExpManager::initial_organism(init_length_dna, target_.data(), geometric_area, *rng_);
+
+    if (rank_ == 0)
+        printf("Populating the environment on %d ranks\n", nb_ranks_);
+
+    population_->assign_all(*initial_organism);
+
+    create_directory();
+}
+
+/**
+ * Constructor to resume a simulation from the shards of a backup (collective), by as many ranks as wrote them
+ *
+ * @param time : resume from this generation
+ */
+MpiExpManager::MpiExpManager(int time) : target_(FUZZY_SAMPLING) {
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+    MPI_Comm_size(MPI_COMM_WORLD, &nb_ranks_);
+
+    load(time);
+
+    if (rank_ == 0)
+        printf("Initialized environmental target %f\n", ExpManager::geometric_area(target_.data()));
+}
+
+MpiExpManager::~MpiExpManager() = default;
+
+void MpiExpManager::shard_name(char *file_name, int t, int rank) {
+    sprintf(file_name, "backup/backup_%d.rank_%d.zae", t, rank);
+}
+
+void MpiExpManager::set_backup_format(Checkpoint::Format format) {
+    // A shard holds a part of the grid, which only the chunked formats describe
+    backup_format_ = format == Checkpoint::GZIP || format == Checkpoint::MAPPED ? Checkpoint::CHUNKED_ZLIB : format;
+}
+
+/**
+ * Split the columns of the grid between the ranks (the first grid_width % nb_ranks strips have one more column), and
+ * allocate the arrays of the strip of this rank
+ *
+ * @param radius : selection radius, the number of border columns exchanged with each neighbour
+ */
+void MpiExpManager::split_grid(int radius) {
+    if (grid_width_ / nb_ranks_ < radius) {
+        if (rank_ == 0)
+            fprintf(stderr, "Error: a grid of width %d can not be split between %d ranks with a selection radius of %d "
+                            "(each rank needs %d columns at least)\n", grid_width_, nb_ranks_, radius, radius);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    left_rank_ = (rank_ + nb_ranks_ - 1) % nb_ranks_;
+    right_rank_ = (rank_ + 1) % nb_ranks_;
+
+    first_column_ = first_column(rank_, nb_ranks_, grid_width_);
+    nb_columns_ = first_column(rank_ + 1, nb_ranks_, grid_width_) - first_column_;
+    first_cell_ = first_column_ * grid_height_;
+    nb_local_ = nb_columns_ * grid_height_;
+
+    interior_begin_ = std::min(radius, nb_columns_);
+    interior_end_ = std::max(interior_begin_, nb_columns_ - radius);
+    border_cells_.clear();
+    for (int local_id = 0; local_id < interior_begin_ * grid_height_; local_id++)
+        border_cells_.push_back(local_id);
+    for (int local_id = interior_end_ * grid_height_; local_id < nb_local_; local_id++)
+        border_cells_.push_back(local_id);
+
+    population_ = std::make_unique<Population>(nb_local_, 2 * radius * grid_height_);
+    reproducers_.assign(nb_local_, 0);
+    previous_reproducers_.assign(nb_local_, -1);
+    dna_mutators_ = std::vector<DnaMutator>(nb_local_);
+
+    halo_to_left_.resize(radius * grid_height_);
+    halo_to_right_.resize(radius * grid_height_);
+    halo_from_left_.resize(radius * grid_height_);
+    halo_from_right_.resize(radius * grid_height_);
+}
+
+std::unique_ptr<Checkpoint> MpiExpManager::snapshot(int t) const {
+    auto checkpoint = std::make_unique<Checkpoint>(*rng_);
+    checkpoint->time = t;
+    checkpoint->grid_height = grid_height_;
+    checkpoint->grid_width = grid_width_;
+    checkpoint->backup_step = backup_step_;
+    checkpoint->mutation_rate = mutation_rate_;
+    checkpoint->target = target_;
+    // Copies of the genomes, one per organism of the strip (see ExpManager::snapshot)
+    checkpoint->organisms.resize(nb_local_);
+#pragma omp parallel for
+    for (int local_id = 0; local_id < nb_local_; local_id++) {
+        if (population_->slot(local_id) == local_id)
+            checkpoint->organisms[local_id] = std::make_shared<Organism>(new Dna(*(*population_)[local_id].dna_));
+    }
+    for (int local_id = 0; local_id < nb_local_; local_id++) {
+        if (population_->slot(local_id) != local_id)
+            checkpoint->organisms[local_id] = checkpoint->organisms[population_->slot(local_id)];
+    }
+    checkpoint->selection_scheme = selection_scheme_;
+    checkpoint->selection_radius = selection_radius_;
+    checkpoint->format = backup_format_;
+    checkpoint->first_cell = first_cell_;
+    return checkpoint;
+}
+
+/**
+ * Write the shard of this rank of the backup of generation t
+ *
+ * @param t : simulated time of the checkpoint
+ */
+void MpiExpManager::save(int t) const {
+    char shard_file_name[255];
+    shard_name(shard_file_name, t, rank_);
+
+    if (!snapshot(t)->write(shard_file_name))
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+}
+
+/**
+ * Load the shard of this rank of the backup of generation t, which must have been written by the same rank of the same
+ * number of ranks
+ *
+ * @param t : resuming the simulation at this generation
+ */
+void MpiExpManager::load(int t) {
+    char shard_file_name[255];
+    shard_name(shard_file_name, t, rank_);
+
+    auto checkpoint = Checkpoint::read(shard_file_name);
+    if (!checkpoint)
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+
+    restore(*checkpoint);
+
+    if (checkpoint->first_cell != first_cell_ || (int) checkpoint->organisms.size() != nb_local_) {
+        fprintf(stderr, "Error: %s is not the shard of rank %d of %d ranks\n", shard_file_name, rank_, nb_ranks_);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int local_id = 0; local_id < nb_local_; local_id++)
+        population_->assign(local_id, *checkpoint->organisms[local_id]);
+}
+
+/**
+ * Restore the simulation from a shard, except its organisms (see load)
+ */
+void MpiExpManager::restore(const Checkpoint &checkpoint) {
+    AeTime::set_time(checkpoint.time);
+
+    grid_height_ = checkpoint.grid_height;
+    grid_width_ = checkpoint.grid_width;
+    nb_indivs_ = grid_height_ * grid_width_;
+
+    backup_step_ = checkpoint.backup_step;
+    mutation_rate_ = checkpoint.mutation_rate;
+    std::copy(checkpoint.target.begin(), checkpoint.target.end(), target_.begin());
+
+    rng_ = std::make_unique<Threefry>(checkpoint.rng);
+
+    split_grid(checkpoint.selection_radius);
+    set_selection(checkpoint.selection_scheme, checkpoint.selection_radius);
+}
+
+/**
+ * Selection process of a cell of the strip (see ExpManager::selection)
+ *
+ * @param local_id : index of the cell in the strip
+ */
+template<class Selection>
+void MpiExpManager::selection(int local_id) {
+    auto rng = std::move(rng_->gen(first_cell_ + local_id, Threefry::REPROD));
+    int found_org = Selection::draw(*selection_engine_, local_id, rng);
+
+    int x = first_column_ + local_id / grid_height_ + found_org / Selection::WIDTH - selection_radius_;
+    int y = local_id % grid_height_ + found_org % Selection::WIDTH - selection_radius_;
+    reproducers_[local_id] = wrap(x, grid_width_) * grid_height_ + wrap(y, grid_height_);
+}
+
+/**
+ * Create the organism of a cell of the strip for the next generation: its reproducer, or a mutant of it which is
+ * evaluated (see ExpManager::prepare_mutation and ExpManager::run_a_step)
+ *
+ * @param local_id : index of the cell in the strip
+ * @param parent_slot : slot of the reproducer of the cell in the population
+ */
+void MpiExpManager::reproduce(int local_id, int parent_slot) {
+    const int indiv_id = first_cell_ + local_id;
+    DnaMutator &dna_mutator = dna_mutators_[local_id];
+    const Organism &parent = population_->in_slot(parent_slot);
+
+    TIMESTAMP_ID(MUTATION, indiv_id, {
+        auto rng = std::move(rng_->gen(indiv_id, Threefry::MUTATION));
+        dna_mutator.generate_mutations(rng, parent.length(), mutation_rate_);
+        if (dna_mutator.hasMutate())
+            population_->mutant(local_id, parent_slot);
+        else
+            population_->clone(local_id, parent_slot);
+    })
+
+    if (!dna_mutator.hasMutate()) return;
+
+    Organism &mutant = population_->next(local_id);
+    TIMESTAMP_ID(MUTATION, indiv_id, mutant.apply_mutations(dna_mutator.mutation_list_);)
+    TIMESTAMP_ID(EVALUATION, indiv_id, {
+        if (delta_evaluation_)
+            mutant.evaluate(target_.data(), parent);
+        else
+            mutant.evaluate(target_.data());
+        mutant.compute_protein_stats();
+    })
+}
+
+void MpiExpManager::send_genome(int side, int indiv_id, std::vector<char> &buffer) {
+    const Dna &dna = *(*population_)[indiv_id - first_cell_].dna_;
+    auto &sent = sent_genomes_[side];
+    const size_t start = buffer.size();
+
+    // The genome sent for the cell, or for the cell of the reproducer of its organism, is often a recent ancestor
+    const int candidates[] = {indiv_id, previous_reproducers_[indiv_id - first_cell_]};
+    int base_cell = -1;
+    std::vector<int32_t> positions;
+    std::vector<int32_t> base_positions;
+    for (int candidate: candidates) {
+        auto found = sent.find(candidate);
+        if (found == sent.end() || (base_cell >= 0 && base_positions.empty())) continue;
+        // Not larger than the packed genome, as the delta records of the backups
+        int max_positions = base_cell < 0 ? dna.length() / 32 - 2 : (int) base_positions.size() - 1;
+        if (dna.differences(found->second, max_positions, positions)) {
+            base_cell = candidate;
+            base_positions.swap(positions);
+        }
+    }
+
+    if (base_cell >= 0) {
+        const int32_t record[] = {SWITCH_LIST_RECORD, base_cell, (int32_t) base_positions.size()};
+        append(buffer, record, 3);
+        append(buffer, base_positions.data(), base_positions.size());
+        nb_switch_lists_sent_++;
+    } else {
+        dna.save(buffer);
+        nb_genomes_sent_++;
+    }
+    nb_bytes_sent_ += buffer.size() - start;
+
+    // Shares the chunks of the genome
+    sent[indiv_id] = dna;
+}
+
+Dna *MpiExpManager::receive_genome(int side, int indiv_id, const char *&data, const char *end) {
+    auto &received = received_genomes_[side];
+    std::unique_ptr<Dna> dna;
+
+    int32_t record[3];
+    if (end - data >= (ptrdiff_t) sizeof(int32_t) && memcmp(data, &SWITCH_LIST_RECORD, sizeof(int32_t)) == 0) {
+        if (end - data < (ptrdiff_t) sizeof(record)) return nullptr;
+        memcpy(record, data, sizeof(record));
+        data += sizeof(record);
+
+        auto base = received.find(record[1]);
+        if (base == received.end() || record[2] < 0 ||
+            (end - data) / (ptrdiff_t) sizeof(int32_t) < record[2])
+            return nullptr;
+
+        dna.reset(new Dna(base->second));
+        for (int32_t i = 0; i < record[2]; i++) {
+            int32_t pos;
+            memcpy(&pos, data, sizeof(pos));
+            data += sizeof(pos);
+            if (pos < 0 || pos >= dna->length()) return nullptr;
+            dna->do_switch(pos);
+        }
+    } else {
+        dna.reset(new Dna());
+        if (!dna->load(data, end)) return nullptr;
+    }
+
+    received[indiv_id] = *dna;
+    return dna.release();
+}
+
+/**
+ * Execute a generation of the simulation on the strip of this rank (collective), see the class comment
+ */
+template<class Selection>
+void MpiExpManager::run_a_step() {
+    const int border_size = selection_radius_ * grid_height_;
+
+    // The reproducers of the organisms, before those of their offspring are drawn
+    reproducers_.swap(previous_reproducers_);
+
+    // Send the fitness of the border columns to the neighbours, and receive theirs
+    MPI_Request halo_requests[4];
+    TIMESTAMP(HALO_EXCHANGE, {
+        for (int i = 0; i < border_size; i++) {
+            halo_to_left_[i] = (*population_)[i].fitness;
+            halo_to_right_[i] = (*population_)[nb_local_ - border_size + i].fitness;
+        }
+        MPI_Irecv(halo_from_left_.data(), border_size, MPI_DOUBLE, left_rank_, HALO_TO_RIGHT, MPI_COMM_WORLD,
+                  &halo_requests[0]);
+        MPI_Irecv(halo_from_right_.data(), border_size, MPI_DOUBLE, right_rank_, HALO_TO_LEFT, MPI_COMM_WORLD,
+                  &halo_requests[1]);
+        MPI_Isend(halo_to_left_.data(), border_size, MPI_DOUBLE, left_rank_, HALO_TO_LEFT, MPI_COMM_WORLD,
+                  &halo_requests[2]);
+        MPI_Isend(halo_to_right_.data(), border_size, MPI_DOUBLE, right_rank_, HALO_TO_RIGHT, MPI_COMM_WORLD,
+                  &halo_requests[3]);
+    })
+
+    // The interior cells only need the fitness of the strip: they are done while the borders are in flight
+    TIMESTAMP(FITNESS_GRID, {
+        selection_engine_->gather_tile(*population_);
+        if (Selection::NEEDS_PROBABILITIES)
+            selection_engine_->compute_probabilities(interior_begin_, interior_end_);
+    })
+
+#pragma omp parallel for schedule(dynamic)
+    for (int local_id = interior_begin_ * grid_height_; local_id < interior_end_ * grid_height_; local_id++) {
+        TIMESTAMP_ID(SELECTION, first_cell_ + local_id, selection<Selection>(local_id);)
+        reproduce(local_id, population_->slot(reproducers_[local_id] - first_cell_));
+    }
+
+    // Selection of the border cells
+    TIMESTAMP(HALO_EXCHANGE, MPI_Waitall(4, halo_requests, MPI_STATUSES_IGNORE);)
+    TIMESTAMP(FITNESS_GRID, {
+        selection_engine_->set_borders(halo_from_left_.data(), halo_from_right_.data());
+        if (Selection::NEEDS_PROBABILITIES) {
+            selection_engine_->compute_probabilities(0, interior_begin_);
+            selection_engine_->compute_probabilities(interior_end_, nb_columns_);
+        }
+    })
+
+#pragma omp parallel for
+    for (int i = 0; i < (int) border_cells_.size(); i++) {
+        TIMESTAMP_ID(SELECTION, first_cell_ + border_cells_[i], selection<Selection>(border_cells_[i]);)
+    }
+
+    // Cells whose reproducer is owned by a neighbour, and the reproducers asked to each of them
+    std::vector<int> remote_cells[2];
+    std::vector<int32_t> requests[2];
+    for (int local_id: border_cells_) {
+        const int reproducer = reproducers_[local_id];
+        if (is_local(reproducer)) continue;
+        // The reproducer is at most selection_radius_ columns away from the strip
+        const int offset = wrap(reproducer / grid_height_ - first_column_, grid_width_);
+        const Side side = offset >= grid_width_ - selection_radius_ ? LEFT : RIGHT;
+        remote_cells[side].push_back(local_id);
+        requests[side].push_back(reproducer);
+    }
+    // A reproducer is asked for once, whatever the number of cells it reproduces in
+    for (auto &request: requests) {
+        std::sort(request.begin(), request.end());
+        request.erase(std::unique(request.begin(), request.end()), request.end());
+    }
+
+    // Exchange the requests, and send the genomes asked for
+    MPI_Request send_requests[4];
+    std::vector<char> genomes_to[2];
+    TIMESTAMP(HALO_EXCHANGE, {
+        MPI_Isend(requests[LEFT].data(), requests[LEFT].size(), MPI_INT32_T, left_rank_, REQUESTS_TO_LEFT,
+                  MPI_COMM_WORLD, &send_requests[0]);
+        MPI_Isend(requests[RIGHT].data(), requests[RIGHT].size(), MPI_INT32_T, right_rank_, REQUESTS_TO_RIGHT,
+                  MPI_COMM_WORLD, &send_requests[1]);
+
+        std::vector<int32_t> asked[2];
+        receive(asked[LEFT], MPI_INT32_T, left_rank_, REQUESTS_TO_RIGHT);
+        receive(asked[RIGHT], MPI_INT32_T, right_rank_, REQUESTS_TO_LEFT);
+        for (int side = LEFT; side <= RIGHT; side++) {
+            for (int32_t indiv_id: asked[side]) {
+                if (!is_local(indiv_id)) {
+                    fprintf(stderr, "Error: rank %d was asked for the organism of cell %d, not in its strip\n", rank_,
+                            indiv_id);
+                    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+                }
+                send_genome(side, indiv_id, genomes_to[side]);
+            }
+        }
+
+        MPI_Isend(genomes_to[LEFT].data(), genomes_to[LEFT].size(), MPI_CHAR, left_rank_, GENOMES_TO_LEFT,
+                  MPI_COMM_WORLD, &send_requests[2]);
+        MPI_Isend(genomes_to[RIGHT].data(), genomes_to[RIGHT].size(), MPI_CHAR, right_rank_, GENOMES_TO_RIGHT,
+                  MPI_COMM_WORLD, &send_requests[3]);
+    })
+
+    // The border cells whose reproducer is local are done while the genomes are in flight
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int) border_cells_.size(); i++) {
+        const int local_id = border_cells_[i];
+        if (is_local(reproducers_[local_id]))
+            reproduce(local_id, population_->slot(reproducers_[local_id] - first_cell_));
+    }
+
+    // Rebuild the reproducers received, in the order of the requests, in the extra slots of their side
+    const int remote_slots[2] = {nb_local_, nb_local_ + border_size};
+    TIMESTAMP(HALO_EXCHANGE, {
+        for (int side = LEFT; side <= RIGHT; side++) {
+            std::vector<char> genomes;
+            receive(genomes, MPI_CHAR, side == LEFT ? left_rank_ : right_rank_,
+                    side == LEFT ? GENOMES_TO_RIGHT : GENOMES_TO_LEFT);
+
+            const char *data = genomes.data();
+            const char *end = data + genomes.size();
+            for (int i = 0; i < (int) requests[side].size(); i++) {
+                Dna *dna = receive_genome(side, requests[side][i], data, end);
+                if (dna == nullptr) {
+                    fprintf(stderr, "Error: rank %d received a corrupted genome\n", rank_);
+                    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+                }
+                population_->adopt(remote_slots[side] + i, std::unique_ptr<Organism>(new Organism(dna)));
+            }
+        }
+    })
+
+    for (int side = LEFT; side <= RIGHT; side++) {
+        // Only the genome is sent: the reproducer is evaluated again, which gives the same organism
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < (int) requests[side].size(); i++) {
+            TIMESTAMP_ID(EVALUATION, requests[side][i], {
+                Organism &parent = population_->in_slot(remote_slots[side] + i);
+                parent.locate_promoters();
+                parent.evaluate(target_.data());
+                parent.compute_protein_stats();
+            })
+        }
+
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < (int) remote_cells[side].size(); i++) {
+            const int local_id = remote_cells[side][i];
+            auto parent = std::lower_bound(requests[side].begin(), requests[side].end(), reproducers_[local_id]);
+            reproduce(local_id, remote_slots[side] + (int) (parent - requests[side].begin()));
+        }
+    }
+
+    TIMESTAMP(HALO_EXCHANGE, MPI_Waitall(4, send_requests, MPI_STATUSES_IGNORE);)
+
+    // Swap Population
+    population_->swap();
+
+    TIMESTAMP(STATS, gather_stats(!(AeTime::time() % stats_step_));)
+}
+
+/**
+ * Search for the best individual, gather the values of the stats, clear the mutation stats of the mutants and update
+ * the trajectory (in a single pass over the strip, see ExpManager::run_a_step), then write the stats on rank 0
+ *
+ * @param with_stats : whether the stats of the generation are written
+ */
+void MpiExpManager::gather_stats(bool with_stats) {
+    const double first_fitness = (*population_)[0].fitness;
+    double best_fitness = first_fitness;
+    int idx_best = 0;
+#pragma omp parallel
+    {
+        double local_best_fitness = first_fitness;
+        int local_idx_best = 0;
+
+#pragma omp for nowait
+        for (int local_id = 0; local_id < nb_local_; local_id++) {
+            Organism &organism = (*population_)[local_id];
+            if (organism.fitness > local_best_fitness) {
+                local_idx_best = local_id;
+                local_best_fitness = organism.fitness;
+            }
+
+            if (with_stats)
+                organism_values_[local_id] = Stats::OrganismValues(organism);
+
+            if (dna_mutators_[local_id].hasMutate())
+                organism.reset_mutation_stats();
+
+            if (with_trajectory_) {
+                const int reproducer = reproducers_[local_id];
+                // The hash of a reproducer of another strip is not known here
+                next_genome_hashes_[local_id] = !dna_mutators_[local_id].hasMutate() && is_local(reproducer)
+                                                ? genome_hashes_[reproducer - first_cell_]
+                                                : organism.dna_->hash();
+                cell_fitness_[local_id] = organism.fitness;
+            }
+        }
+
+#pragma omp critical
+        {
+            if (local_best_fitness > best_fitness ||
+                (local_best_fitness == best_fitness && local_idx_best < idx_best)) {
+                idx_best = local_idx_best;
+                best_fitness = local_best_fitness;
+            }
+        }
+    }
+
+    // The fittest cell of the grid, of lowest index on ties (like MPI_MAXLOC)
+    struct {
+        double fitness;
+        int indiv_id;
+    } local_best = {best_fitness, first_cell_ + idx_best}, best;
+    MPI_Allreduce(&local_best, &best, 1, MPI_DOUBLE_INT, MPI_MAXLOC, MPI_COMM_WORLD);
+    best_fitness_ = best.fitness;
+
+    if (with_trajectory_) {
+        genome_hashes_.swap(next_genome_hashes_);
+        check_trajectory();
+    }
+
+    if (!with_stats) return;
+
+    // The values of the best individual, sent to rank 0 by its owner
+    Stats::OrganismValues best_values;
+    if (is_local(best.indiv_id)) {
+        best_values = organism_values_[best.indiv_id - first_cell_];
+        if (rank_ != 0)
+            MPI_Send(&best_values, sizeof(best_values), MPI_BYTE, 0, BEST_VALUES, MPI_COMM_WORLD);
+    } else if (rank_ == 0) {
+        MPI_Recv(&best_values, sizeof(best_values), MPI_BYTE, MPI_ANY_SOURCE, BEST_VALUES, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+    }
+
+    // The sums of the means are done in the order of the cells, thus of the ranks: each rank adds its strip to the
+    // sums of the previous ones, and the last rank sends them back to rank 0
+    Stats::Sums sums;
+    if (rank_ > 0)
+        MPI_Recv(&sums, sizeof(sums), MPI_BYTE, rank_ - 1, AVERAGE_SUMS, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    sums.add(organism_values_.data(), nb_local_);
+    if (rank_ + 1 < nb_ranks_)
+        MPI_Send(&sums, sizeof(sums), MPI_BYTE, rank_ + 1, AVERAGE_SUMS, MPI_COMM_WORLD);
+    else if (rank_ > 0)
+        MPI_Send(&sums, sizeof(sums), MPI_BYTE, 0, AVERAGE_SUMS, MPI_COMM_WORLD);
+
+    if (rank_ != 0) return;
+    if (nb_ranks_ > 1)
+        MPI_Recv(&sums, sizeof(sums), MPI_BYTE, nb_ranks_ - 1, AVERAGE_SUMS, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+    stats_best_->reinit(AeTime::time());
+    stats_mean_->reinit(AeTime::time());
+
+    stats_best_->compute_best(best_values);
+    stats_mean_->compute_average(sums, nb_indivs_);
+
+    // Computed above, the organisms are not read
+    stats_best_->write_best(nullptr);
+    stats_mean_->write_average(nullptr, nb_indivs_);
+}
+
+/**
+ * Record or verify the current generation (collective): rank 0 gathers the genome hashes and the fitness of every
+ * cell, in the order of the cells
+ */
+void MpiExpManager::check_trajectory() {
+    std::vector<int> counts(nb_ranks_);
+    std::vector<int> displacements(nb_ranks_);
+    for (int rank = 0; rank < nb_ranks_; rank++) {
+        displacements[rank] = first_column(rank, nb_ranks_, grid_width_) * grid_height_;
+        counts[rank] = first_column(rank + 1, nb_ranks_, grid_width_) * grid_height_ - displacements[rank];
+    }
+
+    std::vector<double> fitness(rank_ == 0 ? nb_indivs_ : 0);
+    std::vector<uint64_t> hashes(rank_ == 0 ? nb_indivs_ : 0);
+    MPI_Gatherv(cell_fitness_.data(), nb_local_, MPI_DOUBLE, fitness.data(), counts.data(), displacements.data(),
+                MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(genome_hashes_.data(), nb_local_, MPI_UINT64_T, hashes.data(), counts.data(), displacements.data(),
+                MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    if (rank_ == 0 && !trajectory_checker_->check(AeTime::time(), nb_indivs_, fitness.data(), hashes.data()))
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+}
+
+template<template<int> class Selection>
+MpiExpManager::StepFunction MpiExpManager::step_function(int radius) {
+    static_assert(MAX_SELECTION_RADIUS == 3, "Instantiate the step for every radius");
+    switch (radius) {
+        case 1:
+            return &MpiExpManager::run_a_step<Selection<1>>;
+        case 2:
+            return &MpiExpManager::run_a_step<Selection<2>>;
+        case 3:
+            return &MpiExpManager::run_a_step<Selection<3>>;
+        default:
+            return nullptr;
+    }
+}
+
+/**
+ * Select the selection scheme and its neighbourhood (see ExpManager::set_selection), once the grid is split
+ */
+void MpiExpManager::set_selection(SelectionScheme scheme, int radius) {
+    switch (scheme) {
+        case FITNESS_PROPORTIONAL:
+            run_a_step_ = step_function<FitnessProportionalSelection>(radius);
+            break;
+        case TOURNAMENT:
+            run_a_step_ = step_function<TournamentSelection>(radius);
+            break;
+        case RANK:
+            run_a_step_ = step_function<RankSelection>(radius);
+            break;
+        default:
+            run_a_step_ = nullptr;
+    }
+
+    if (run_a_step_ == nullptr) {
+        if (rank_ == 0)
+            fprintf(stderr, "Error: no selection scheme %d with a radius of %d (the radius must be in [1, %d])\n",
+                    scheme, radius, MAX_SELECTION_RADIUS);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    selection_scheme_ = scheme;
+    selection_radius_ = radius;
+    selection_engine_ = std::make_unique<SelectionEngine>(nb_columns_, grid_height_, 2 * radius + 1, 2 * radius + 1);
+}
+
+/**
+ * Run the evolution for a given number of generation (collective)
+ *
+ * @param nb_gen : Number of generations to simulate
+ */
+void MpiExpManager::run_evolution(int nb_gen) {
+    TIMESTAMP(FIRST_EVALUATION, {
+        _Pragma("omp parallel for schedule(dynamic)")
+        for (int local_id = 0; local_id < nb_local_; local_id++) {
+            // Once per organism, in the slot of the cell holding it
+            if (population_->slot(local_id) != local_id) continue;
+            Organism &organism = (*population_)[local_id];
+            organism.locate_promoters();
+            organism.evaluate(target_.data());
+            organism.compute_protein_stats();
+        }
+    });
+    FLUSH_TRACES(AeTime::time())
+
+    // Only rank 0 has the checker
+    int with_trajectory = trajectory_checker_ != nullptr;
+    MPI_Bcast(&with_trajectory, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    with_trajectory_ = with_trajectory;
+    if (with_trajectory_) {
+        genome_hashes_.resize(nb_local_);
+        next_genome_hashes_.resize(nb_local_);
+        cell_fitness_.resize(nb_local_);
+#pragma omp parallel for
+        for (int local_id = 0; local_id < nb_local_; local_id++) {
+            genome_hashes_[local_id] = (*population_)[local_id].dna_->hash();
+            cell_fitness_[local_id] = (*population_)[local_id].fitness;
+        }
+        check_trajectory();
+    }
+
+    // Stats
+    organism_values_.resize(nb_local_);
+    if (rank_ == 0) {
+        stats_best_ = std::make_unique<Stats>(AeTime::time(), true, stats_format_);
+        stats_mean_ = std::make_unique<Stats>(AeTime::time(), false, stats_format_);
+
+        printf("Running evolution from %d to %d\n", AeTime::time(), AeTime::time() + nb_gen);
+    }
+
+    for (int gen = 0; gen < nb_gen; gen++) {
+        AeTime::plusplus();
+
+        TIMESTAMP(STEP, (this->*run_a_step_)();)
+
+        if (rank_ == 0)
+            printf("Generation %d : Best individual fitness %e\n", AeTime::time(), best_fitness_);
+
+        if (AeTime::time() % backup_step_ == 0) {
+            TIMESTAMP(BACKUP, {
+                // A resume from this backup keeps the stats up to this generation
+                if (rank_ == 0) {
+                    stats_best_->flush();
+                    stats_mean_->flush();
+                }
+
+                char shard_file_name[255];
+                shard_name(shard_file_name, AeTime::time(), rank_);
+                int written = snapshot(AeTime::time())->write(shard_file_name);
+                int all_written;
+                MPI_Allreduce(&written, &all_written, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+                if (!all_written)
+                    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+                if (rank_ == 0)
+                    printf("Backup for generation %d done !\n", AeTime::time());
+            })
+        }
+
+        FLUSH_TRACES(AeTime::time())
+    }
+
+    long long transfers[] = {nb_genomes_sent_, nb_switch_lists_sent_, nb_bytes_sent_};
+    long long total_transfers[3];
+    MPI_Reduce(transfers, total_transfers, 3, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (rank_ == 0)
+        printf("Reproducers sent between the ranks: %lld genomes and %lld lists of switches, %lld bytes\n",
+               total_transfers[0], total_transfers[1], total_transfers[2]);
+}
@@ -0,0 +1,213 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <memory>
+#include <mpi.h>
+#include <unordered_map>
+#include <vector>
+
+#include "Abstract_ExpManager.h"
+#include "Checkpoint.h"
+#include "DnaMutator.h"
+#include "Organism.h"
+#include "Population.h"
+#include "SelectionEngine.h"
+#include "SelectionPolicy.h"
+#include "Stats.h"
+#include "Threefry.h"
+
+/**
+ * Simulation distributed over the ranks of MPI_COMM_WORLD, for populations that do not fit on one node
+ *
+ * The torus is split along x into strips of whole columns, one per rank (the columns of a cell x * grid_height + y are
+ * contiguous, so a rank owns a contiguous range of cells). Each generation, a rank:
+ *  - sends the fitness of its radius border columns to its neighbouring ranks, and meanwhile selects, mutates and
+ *    evaluates its interior cells, whose neighbourhood is in its strip,
+ *  - then selects the reproducers of its border cells, asks its neighbours for the genomes of the reproducers they
+ *    own (once per reproducer, whatever the number of cells it reproduces in), and sends them those they ask for,
+ *  - meanwhile mutates and evaluates the border cells whose reproducer it owns, then rebuilds the reproducers
+ *    received (which are evaluated again) and mutates and evaluates their offspring.
+ *
+ * The communication thus follows the reproductions across the strips. Both sides of a transfer also keep the genome
+ * last sent for each cell: when the genome asked for has few differences with the one sent for its cell or for the
+ * cell of its own reproducer, only the switched positions are sent.
+ *
+ * The trajectory is the one of ExpManager, whatever the number of ranks and threads: each cell draws from the streams
+ * of its global index (every rank holds the PRNG counters of the whole grid and only uses those of its cells), the best
+ * individual is the fittest cell of lowest index, and the sums of the mean stats are done in the order of the cells
+ * by passing them from a rank to the next.
+ *
+ * Rank 0 writes the stats and prints the progress. Each rank writes its own shard of the backups,
+ * backup/backup_GENERATION.rank_RANK.zae (see Checkpoint::first_cell), always in a chunked format: a simulation is
+ * resumed from its shards by the same number of ranks.
+ */
+class MpiExpManager : public Abstract_ExpManager {
+public:
+    MpiExpManager(int grid_height, int grid_width, int seed, double mutation_rate, int init_length_dna,
+                  int backup_step, SelectionScheme selection_scheme = FITNESS_PROPORTIONAL, int selection_radius = 1);
+
+    explicit MpiExpManager(int time);
+
+    ~MpiExpManager() override;
+
+    void save(int t) const final;
+
+    void load(int t) final;
+
+    void run_evolution(int nb_gen) override;
+
+    /// See ExpManager::set_delta_evaluation
+    void set_delta_evaluation(bool delta_evaluation) { delta_evaluation_ = delta_evaluation; }
+
+    /// Format of the shards written from now on, CHUNKED_ZLIB by default (and instead of GZIP and MAPPED)
+    void set_backup_format(Checkpoint::Format format);
+
+    /// See ExpManager::set_stats_format
+    void set_stats_format(Stats::Format format) { stats_format_ = format; }
+
+    /// See ExpManager::set_stats_step
+    void set_stats_step(int stats_step) { stats_step_ = stats_step; }
+
+    /// Path of the shard of generation t written by rank (at most 255 chars)
+    static void shard_name(char *file_name, int t, int rank);
+
+private:
+    typedef void (MpiExpManager::*StepFunction)();
+
+    template<class Selection>
+    void run_a_step();
+
+    /// run_a_step instantiated for the given scheme and radius (nullptr if not instantiated)
+    template<template<int> class Selection>
+    static StepFunction step_function(int radius);
+
+    /// Split the grid between the ranks and allocate the strip of this rank (aborts if a strip would be narrower than
+    /// the selection radius)
+    void split_grid(int radius);
+
+    void set_selection(SelectionScheme scheme, int radius);
+
+    /// Draw the reproducer of a local cell, the global index of a cell of the strip or of a neighbouring one
+    template<class Selection>
+    void selection(int local_id);
+
+    /// Create the organism of a local cell from its reproducer (in parent_slot of the population), and evaluate it if
+    /// it is a mutant
+    void reproduce(int local_id, int parent_slot);
+
+    /**
+     * Append the genome of the organism of the local cell indiv_id to buffer, for the neighbour on side: as the
+     * positions switched from a genome it holds when there are few, packed otherwise (see Checkpoint::write_chunked)
+     */
+    void send_genome(int side, int indiv_id, std::vector<char> &buffer);
+
+    /// Read the genome of the cell indiv_id sent by send_genome from the neighbour on side, nullptr if corrupted
+    Dna *receive_genome(int side, int indiv_id, const char *&data, const char *end);
+
+    /// Whether a global cell is in the strip of this rank
+    bool is_local(int indiv_id) const {
+        return indiv_id >= first_cell_ && indiv_id < first_cell_ + nb_local_;
+    }
+
+    /// Find the best individual and write the stats of the generation (collective)
+    void gather_stats(bool with_stats);
+
+    /// Check the current generation with the trajectory checker of rank 0 (collective), abort on a divergence
+    void check_trajectory();
+
+    std::unique_ptr<Checkpoint> snapshot(int t) const;
+
+    void restore(const Checkpoint &checkpoint);
+
+    int rank_ = 0;
+    int nb_ranks_ = 1;
+    int left_rank_ = 0;
+    int right_rank_ = 0;
+
+    int grid_height_ = 0;
+    int grid_width_ = 0;
+    int nb_indivs_ = 0;
+
+    // Strip of this rank: columns [first_column_, first_column_ + nb_columns_[, i.e. cells
+    // [first_cell_, first_cell_ + nb_local_[
+    int first_column_ = 0;
+    int nb_columns_ = 0;
+    int first_cell_ = 0;
+    int nb_local_ = 0;
+    // Interior columns of the strip [interior_begin_, interior_end_[, the others are its border columns
+    int interior_begin_ = 0;
+    int interior_end_ = 0;
+    std::vector<int> border_cells_;
+
+    // Organisms of the strip (a local cell is indiv_id - first_cell_), and those being created. Its extra slots hold
+    // the reproducers received from the neighbours, selection_radius_ * grid_height_ for each side.
+    std::unique_ptr<Population> population_;
+    // Global index of the reproducer of each local cell, and that of the organism of the cell (-1 if not known)
+    std::vector<int> reproducers_;
+    std::vector<int> previous_reproducers_;
+    std::vector<DnaMutator> dna_mutators_;
+
+    // Selection on the strip and the border columns of its neighbours
+    std::unique_ptr<SelectionEngine> selection_engine_;
+    SelectionScheme selection_scheme_ = FITNESS_PROPORTIONAL;
+    int selection_radius_ = 1;
+    StepFunction run_a_step_ = nullptr;
+    // Fitness of the border columns: sent to the left and right ranks, received from them
+    std::vector<double> halo_to_left_;
+    std::vector<double> halo_to_right_;
+    std::vector<double> halo_from_left_;
+    std::vector<double> halo_from_right_;
+    // Genomes last sent to the left and right neighbours, and received from them, by cell
+    std::unordered_map<int, Dna> sent_genomes_[2];
+    std::unordered_map<int, Dna> received_genomes_[2];
+    long long nb_genomes_sent_ = 0;
+    long long nb_switch_lists_sent_ = 0;
+    long long nb_bytes_sent_ = 0;
+
+    std::unique_ptr<Threefry> rng_;
+    std::vector<double> target_;
+    double mutation_rate_ = 0.0;
+    int backup_step_ = 0;
+    bool delta_evaluation_ = true;
+    Checkpoint::Format backup_format_ = Checkpoint::CHUNKED_ZLIB;
+
+    double best_fitness_ = 0.0;
+
+    // Stats, written by rank 0 from the values of every rank
+    std::unique_ptr<Stats> stats_best_;
+    std::unique_ptr<Stats> stats_mean_;
+    Stats::Format stats_format_ = Stats::CSV;
+    int stats_step_ = 1;
+    std::vector<Stats::OrganismValues> organism_values_;
+
+    // Trajectory (see ExpManager): genome hash and fitness of each local cell, gathered by rank 0
+    bool with_trajectory_ = false;
+    std::vector<uint64_t> genome_hashes_;
+    std::vector<uint64_t> next_genome_hashes_;
+    std::vector<double> cell_fitness_;
+};
@@ -33,3 +33,30 @@ void MutationEvent::switch_pos(int32_t pos) {
     pos_1_ = pos;
 }
 
+
+void MutationEvent::small_insertion(int32_t pos, int32_t nb_bases, uint32_t bases) {
+    type_ = MutationEventType::SMALL_INSERTION;
+    pos_1_ = pos;
+    nb_bases_ = nb_bases;
+    bases_ = bases;
+}
+
+void MutationEvent::deletion(int32_t pos_1, int32_t pos_2) {
+    type_ = MutationEventType::DELETION;
+    pos_1_ = pos_1;
+    pos_2_ = pos_2;
+}
+
+void MutationEvent::duplication(int32_t pos_1, int32_t pos_2, int32_t pos_3) {
+    type_ = MutationEventType::DUPLICATION;
+    pos_1_ = pos_1;
+    pos_2_ = pos_2;
+    pos_3_ = pos_3;
+}
+
+void MutationEvent::translocation(int32_t pos_1, int32_t pos_2, int32_t pos_3) {
+    type_ = MutationEventType::TRANSLOCATION;
+    pos_1_ = pos_1;
+    pos_2_ = pos_2;
+    pos_3_ = pos_3;
+}
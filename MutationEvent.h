@@ -30,6 +30,10 @@
 
 enum MutationEventType {
     DO_SWITCH = 0,
+    SMALL_INSERTION,
+    DELETION,
+    DUPLICATION,
+    TRANSLOCATION,
     NONE
 };
 
@@ -46,12 +50,38 @@ public:
 
     void switch_pos(int32_t pos);
 
+    /// Insert nb_bases bases (bit k of bases being the k-th one) before pos
+    void small_insertion(int32_t pos, int32_t nb_bases, uint32_t bases);
+
+    /// Remove the segment [pos_1, pos_2[ (see Dna::do_duplication for the segments)
+    void deletion(int32_t pos_1, int32_t pos_2);
+
+    /// Insert a copy of the segment [pos_1, pos_2[ before pos_3
+    void duplication(int32_t pos_1, int32_t pos_2, int32_t pos_3);
+
+    /// Move the segment [pos_1, pos_2[ before pos_3 of the genome without it
+    void translocation(int32_t pos_1, int32_t pos_2, int32_t pos_3);
+
     int32_t type() const { return type_; };
 
     int32_t pos_1() const { return pos_1_; }
 
+    int32_t pos_2() const { return pos_2_; }
+
+    int32_t pos_3() const { return pos_3_; }
+
+    int32_t nb_bases() const { return nb_bases_; }
+
+    uint32_t bases() const { return bases_; }
+
 private:
     int32_t type_;
 
     int32_t pos_1_;
+    int32_t pos_2_;
+    int32_t pos_3_;
+
+    // Small insertions only
+    int32_t nb_bases_;
+    uint32_t bases_;
 };
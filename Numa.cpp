@@ -0,0 +1,100 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "Numa.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <omp.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace numa {
+    std::vector<std::vector<int>> nodes() {
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string list;
+        if (!online || !std::getline(online, list)) return {};
+
+        std::vector<std::vector<int>> nodes;
+        for (int node: parse_list(list)) {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string cpu_list;
+            if (!file || !std::getline(file, cpu_list)) continue;
+            // A node may have memory only
+            std::vector<int> cpus = parse_list(cpu_list);
+            if (!cpus.empty()) nodes.push_back(std::move(cpus));
+        }
+        return nodes;
+    }
+
+    std::vector<int> parse_list(const std::string &list) {
+        std::vector<int> numbers;
+        const char *p = list.c_str();
+        while (*p != '\0' && *p != '\n') {
+            char *end;
+            long first = strtol(p, &end, 10);
+            if (end == p || first < 0) return {};
+            long last = first;
+            p = end;
+            if (*p == '-') {
+                last = strtol(p + 1, &end, 10);
+                if (end == p + 1 || last < first) return {};
+                p = end;
+            }
+            for (long number = first; number <= last; number++)
+                numbers.push_back(number);
+            if (*p == ',') p++;
+            else if (*p != '\0' && *p != '\n') return {};
+        }
+        return numbers;
+    }
+
+    int pin_threads() {
+#ifdef __linux__
+        const auto node_cpus = nodes();
+        if (node_cpus.empty()) return 0;
+
+        const int nb_nodes = node_cpus.size();
+        const int nb_threads = omp_get_max_threads();
+        bool pinned = true;
+#pragma omp parallel num_threads(nb_threads) reduction(&&: pinned)
+        {
+            const auto &cpus = node_cpus[(long) omp_get_thread_num() * nb_nodes / nb_threads];
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu: cpus)
+                if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+            // 0: the calling thread
+            pinned = sched_setaffinity(0, sizeof(set), &set) == 0;
+        }
+        return pinned ? std::min(nb_nodes, nb_threads) : 0;
+#else
+        return 0;
+#endif
+    }
+}
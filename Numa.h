@@ -0,0 +1,54 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * Placement of the OpenMP threads on the NUMA nodes of the machine (see ExpManager::set_numa)
+ *
+ * The topology is read from /sys/devices/system/node (Linux), without libnuma. The threads are bound to the CPUs of a
+ * node, not to a single CPU: the memory they allocate is then placed on that node by the first-touch policy of the
+ * kernel.
+ */
+namespace numa {
+    /// CPUs of each node with CPUs, in the order of the nodes (empty if the topology is unknown)
+    std::vector<std::vector<int>> nodes();
+
+    /// Numbers of a list of /sys, such as a cpulist ("0-3,8,10-11"), empty if it can not be parsed
+    std::vector<int> parse_list(const std::string &list);
+
+    /**
+     * Pin the threads of the OpenMP team of the next parallel regions (as long as their number does not change) in
+     * contiguous blocks over the nodes: thread t of nb on node t * nb_nodes / nb, so that each block of the static
+     * schedule of a loop is computed on a single node.
+     *
+     * @return the number of nodes the threads are spread over, 0 if they could not be pinned
+     */
+    int pin_threads();
+}
@@ -26,19 +26,24 @@
 
 
 
+#include <algorithm>
 #include <cmath>
 #include "Organism.h"
+#include "DnaRope.h"
+#include "Timetracer.h"
 
 using namespace std;
 
+Organism::Organism() {
+    dna_ = new Dna();
+}
+
 /**
  * Constructor to generate a random organism (i.e. an organism with a random DNA)
  *
  * @param length : Length of the generated random DNA
  */
 Organism::Organism(int length, Threefry::Gen &&rng) {
-    rna_count_ = 0;
-
     dna_ = new Dna(length, std::move(rng));
 }
 
@@ -48,38 +53,31 @@ Organism::Organism(int length, Threefry::Gen &&rng) {
  * @param clone : The organism to clone
  */
 Organism::Organism(const std::shared_ptr<Organism> &clone) {
-    rna_count_ = 0;
     dna_ = new Dna(*(clone->dna_));
     promoters_ = clone->promoters_;
 }
 
+void Organism::assign_clone(const Organism &clone) {
+    *dna_ = *clone.dna_;
+    promoters_ = clone.promoters_;
+    reset_mutation_stats();
+}
+
 /**
  * Create an Organism from a backup/checkpointing file
  *
  * @param backup_file : gzFile to read from
  */
 Organism::Organism(gzFile backup_file) {
-    rna_count_ = 0;
-
     load(backup_file);
 }
 
+Organism::Organism(Dna *dna) : dna_(dna) {}
+
 /**
  * Destructor of an organism
  */
 Organism::~Organism() {
-    for (auto rna : rnas) {
-        delete (rna);
-    }
-    rnas.clear();
-
-    for (auto prot : proteins) {
-        delete (prot);
-    }
-    proteins.clear();
-
-    terminators.clear();
-
     delete dna_;
 }
 
@@ -118,27 +116,23 @@ void Organism::compute_protein_stats() {
     nb_coding_RNAs = 0;
     nb_non_coding_RNAs = 0;
 
-    for (int i = 0; i < rna_count_; i++) {
-        if (rnas[i] != nullptr) {
-            if (rnas[i]->is_coding_)
-                nb_coding_RNAs++;
-            else
-                nb_non_coding_RNAs++;
-        }
+    for (const auto &rna: rnas) {
+        if (rna.is_coding_)
+            nb_coding_RNAs++;
+        else
+            nb_non_coding_RNAs++;
     }
 
-    for (int i = 0; i < protein_count_; i++) {
-        if (rnas[i] != nullptr) {
-            if (proteins[i]->is_functional) {
-                nb_func_genes++;
-            } else {
-                nb_non_func_genes++;
-            }
-            if (proteins[i]->h > 0) {
-                nb_genes_activ++;
-            } else {
-                nb_genes_inhib++;
-            }
+    for (int protein_idx = 0; protein_idx < proteins.size(); protein_idx++) {
+        if (proteins.is_functional[protein_idx]) {
+            nb_func_genes++;
+        } else {
+            nb_non_func_genes++;
+        }
+        if (proteins.h[protein_idx] > 0) {
+            nb_genes_activ++;
+        } else {
+            nb_genes_inhib++;
         }
     }
 }
@@ -151,368 +145,686 @@ void Organism::locate_promoters() {
 /**
  * Apply all the mutation events of the organism on its DNA
  */
-void Organism::apply_mutations(const list<MutationEvent *> &mutation_list) {
-    for (const auto *mutation: mutation_list) {
-        switch (mutation->type()) {
+void Organism::apply_mutations(const vector<MutationEvent> &mutation_list) {
+    switched_positions_.clear();
+    rearranged_ = false;
+    // From the first rearrangement on, the mutations are applied to a rope, packed into the genome at the end. The
+    // promoters move with the bases, and those over the junctions left by the rearrangements are searched again in
+    // the genome written.
+    std::unique_ptr<DnaRope> rope;
+    junctions_.clear();
+    std::vector<PromoterMap::value_type> segment_promoters;
+    std::vector<int32_t> segment_junctions;
+    // Set if the genome gets too short for the promoters to be moved
+    bool relocate = false;
+
+    for (const auto &mutation: mutation_list) {
+        if (mutation.type() != DO_SWITCH && !rope)
+            rope.reset(new DnaRope(*dna_));
+
+        int length = rope ? rope->length() : dna_->length();
+        int seg_length = segment_length(mutation.pos_1(), mutation.pos_2(), length);
+        switch (mutation.type()) {
             case DO_SWITCH:
-                do_switch(mutation->pos_1());
+                if (rope) {
+                    rope->do_switch(mutation.pos_1());
+                    if (length < PROM_SIZE) {
+                        relocate = true;
+                    } else if (!relocate) {
+                        remove_promoters_starting_between(mod(mutation.pos_1() - PROM_SIZE + 1, length),
+                                                          mod(mutation.pos_1() + 1, length));
+                        junctions_.push_back(mutation.pos_1());
+                        junctions_.push_back(mod(mutation.pos_1() + 1, length));
+                    }
+                } else {
+                    do_switch(mutation.pos_1());
+                    switched_positions_.push_back(mutation.pos_1());
+                }
                 nb_swi_++;
                 nb_mut_++;
                 break;
+            case SMALL_INSERTION:
+                if (length < PROM_SIZE) relocate = true;
+                if (!relocate) {
+                    segment_promoters.clear();
+                    segment_junctions.clear();
+                    // The promoters found in the inserted bases are those over the junctions
+                    for (int offset = PROM_SIZE - 1; offset < mutation.nb_bases(); offset += PROM_SIZE - 1)
+                        segment_junctions.push_back(offset);
+                    insert_segment_promoters(mutation.pos_1(), mutation.nb_bases(), length, segment_promoters,
+                                             segment_junctions);
+                }
+                rope->insert(mutation.pos_1(), mutation.bases(), mutation.nb_bases());
+                nb_mut_++;
+                break;
+            case DELETION:
+                if (length - seg_length < PROM_SIZE) relocate = true;
+                if (!relocate)
+                    remove_segment_promoters(mutation.pos_1(), mutation.pos_2(), length);
+                rope->remove(mutation.pos_1(), mutation.pos_2());
+                nb_mut_++;
+                break;
+            case DUPLICATION:
+                if (length < PROM_SIZE) relocate = true;
+                if (!relocate) {
+                    copy_segment_promoters(mutation.pos_1(), mutation.pos_2(), length, segment_promoters,
+                                           segment_junctions);
+                    insert_segment_promoters(mutation.pos_3(), seg_length, length, segment_promoters,
+                                             segment_junctions);
+                }
+                rope->duplicate(mutation.pos_1(), mutation.pos_2(), mutation.pos_3());
+                nb_mut_++;
+                break;
+            case TRANSLOCATION:
+                if (length - seg_length < PROM_SIZE) relocate = true;
+                if (!relocate) {
+                    copy_segment_promoters(mutation.pos_1(), mutation.pos_2(), length, segment_promoters,
+                                           segment_junctions);
+                    remove_segment_promoters(mutation.pos_1(), mutation.pos_2(), length);
+                    insert_segment_promoters(mutation.pos_3(), seg_length, length - seg_length, segment_promoters,
+                                             segment_junctions);
+                }
+                rope->translocate(mutation.pos_1(), mutation.pos_2(), mutation.pos_3());
+                nb_mut_++;
+                break;
         }
     }
+
+    if (rope) {
+        rope->write(*dna_);
+        if (relocate) {
+            remove_all_promoters();
+            locate_promoters();
+        } else {
+            promoters_.flush();
+            std::sort(junctions_.begin(), junctions_.end());
+            junctions_.erase(std::unique(junctions_.begin(), junctions_.end()), junctions_.end());
+            for (int pos: junctions_)
+                look_for_new_promoters_around(pos);
+        }
+        switched_positions_.clear();
+        rearranged_ = true;
+    }
 }
 
-void Organism::evaluate(const double *target) {
-    compute_RNA();
-    search_start_protein();
-    compute_protein();
-    translate_protein();
-    compute_phenotype();
-    compute_fitness(target);
+/**
+ * Remove the promoters of the segment [pos_1, pos_2[ (see DnaRope) of the rearranged genome of `length` bases, and
+ * those over the junction its removal leaves, and move the others to their positions once it is removed.
+ */
+void Organism::remove_segment_promoters(int32_t pos_1, int32_t pos_2, int32_t length) {
+    remove_promoters_starting_between(mod(pos_1 - PROM_SIZE + 1, length), pos_2);
+
+    int new_length = length - segment_length(pos_1, pos_2, length);
+    if (pos_1 < pos_2) {
+        promoters_.shift(pos_2, pos_1 - pos_2);
+        for (int &junction: junctions_) {
+            if (junction >= pos_2) junction -= pos_2 - pos_1;
+            else if (junction > pos_1) junction = pos_1;
+        }
+        junctions_.push_back(mod(pos_1, new_length));
+    } else {
+        // The genome is what remains of [pos_2, pos_1[
+        promoters_.shift(pos_2, -pos_2);
+        for (int &junction: junctions_)
+            junction = junction >= pos_2 && junction < pos_1 ? junction - pos_2 : 0;
+        junctions_.push_back(0);
+    }
 }
 
-void Organism::compute_RNA() {
-    proteins.clear();
-    rnas.clear();
-    terminators.clear();
+/**
+ * Insert before pos a segment of nb_bases bases in the rearranged genome of `length` bases: remove the promoters
+ * over the junction at pos, move those after it, and add those of the segment and its junctions (at their offsets
+ * from its start, see copy_segment_promoters).
+ */
+void Organism::insert_segment_promoters(int32_t pos, int32_t nb_bases, int32_t length,
+                                        std::vector<PromoterMap::value_type> &promoters,
+                                        const std::vector<int32_t> &junctions) {
+    int cut = mod(pos, length);
+    remove_promoters_starting_between(mod(cut - PROM_SIZE + 1, length), cut);
+    promoters_.shift(pos, nb_bases);
+
+    for (auto &promoter: promoters)
+        promoter.first += pos;
+    promoters_.insert(promoters);
+
+    int new_length = length + nb_bases;
+    for (int &junction: junctions_)
+        if (junction >= pos) junction += nb_bases;
+    junctions_.push_back(pos);
+    junctions_.push_back(mod(pos + nb_bases, new_length));
+    for (int junction: junctions)
+        junctions_.push_back(pos + junction);
+}
 
-    rnas.resize(promoters_.size());
+/**
+ * The promoters held whole by the segment [pos_1, pos_2[ (see DnaRope) of the rearranged genome of `length` bases,
+ * and the junctions inside it, at their offsets from pos_1
+ */
+void Organism::copy_segment_promoters(int32_t pos_1, int32_t pos_2, int32_t length,
+                                      std::vector<PromoterMap::value_type> &promoters,
+                                      std::vector<int32_t> &junctions) const {
+    int seg_length = segment_length(pos_1, pos_2, length);
+    promoters.clear();
+    junctions.clear();
+
+    // End of the starts of the promoters held whole, from pos_1 and up to length past it
+    int end = pos_1 + seg_length - PROM_SIZE + 1;
+    if (end <= length) {
+        promoters_.copy(pos_1, end, -pos_1, promoters);
+    } else {
+        promoters_.copy(pos_1, length, -pos_1, promoters);
+        promoters_.copy(0, end - length, length - pos_1, promoters);
+    }
 
-    for (const auto &prom_pair: promoters_) {
-        int prom_pos = prom_pair.first;
+    for (int junction: junctions_) {
+        int offset = mod(junction - pos_1, length);
+        if (offset > 0 && offset < seg_length)
+            junctions.push_back(offset);
+    }
+}
 
-        /* Search for terminators */
-        int cur_pos = prom_pos + PROM_SIZE;
-        loop_back(cur_pos);
+void Organism::evaluate(const double *target) {
+    from_cache_ = false;
+    TIMESTAMP(RNA, compute_RNA();)
+    TIMESTAMP(START_PROTEIN, search_start_protein();)
+    TIMESTAMP(PROTEIN, compute_protein();)
+    TIMESTAMP(TRANSLATION, translate_protein();)
+    TIMESTAMP(PHENOTYPE, compute_phenotype(target);)
+}
 
-        int start_pos = cur_pos;
+/**
+ * Evaluate a mutant from its parent, recomputing only the RNAs and proteins that its switches can have changed
+ *
+ * The merge of the proteins, the phenotype and the fitness are computed from scratch, from the proteins in the
+ * same order as evaluate(target): both give exactly the same result. A mutant whose genome was rearranged, or whose
+ * parent took its evaluation from an EvaluationCache, is evaluated from scratch. A neutral mutant (see is_neutral)
+ * takes the evaluation of its parent.
+ *
+ * @param target : the environmental target
+ * @param parent : the evaluated organism whose clone, modified by apply_mutations, this organism is
+ */
+void Organism::evaluate(const double *target, const Organism &parent) {
+    // The RNAs of the parent can not be reused once the positions have moved
+    if (rearranged_ || parent.from_cache_) {
+        evaluate(target);
+        return;
+    }
+    from_cache_ = false;
 
-        bool terminator_found = false;
+    if (is_neutral(parent)) {
+        TIMESTAMP(RNA, copy_evaluation(parent);)
+        return;
+    }
 
-        while (!terminator_found) {
-            int term_dist_leading = dna_->terminator_at(cur_pos);
+    // The RNAs, with the proteins of the new ones
+    TIMESTAMP(RNA, compute_RNA(parent);)
+    TIMESTAMP(PHENOTYPE, {
+        merge_proteins();
+        compute_phenotype(target);
+    })
+}
 
-            if (term_dist_leading == TERM_STEM_SIZE)
-                terminator_found = true;
-            else {
-                cur_pos++;
-                loop_back(cur_pos);
+void Organism::evaluate(const EvaluationCache::Evaluation &evaluation) {
+    from_cache_ = true;
+    // Nothing is left of the evaluation of its parent
+    rnas.clear();
+    start_prot.clear();
+    proteins.clear();
 
-                if (cur_pos == start_pos) {
-                    break;
-                }
-            }
-        }
+    fitness = evaluation.fitness;
+    metaerror = evaluation.metaerror;
+    nb_genes_activ = evaluation.nb_genes_activ;
+    nb_genes_inhib = evaluation.nb_genes_inhib;
+    nb_func_genes = evaluation.nb_func_genes;
+    nb_non_func_genes = evaluation.nb_non_func_genes;
+    nb_coding_RNAs = evaluation.nb_coding_RNAs;
+    nb_non_coding_RNAs = evaluation.nb_non_coding_RNAs;
+}
 
-        if (terminator_found) {
-            int32_t rna_end = cur_pos + TERM_SIZE;
-            loop_back(rna_end);
+EvaluationCache::Evaluation Organism::evaluation() const {
+    EvaluationCache::Evaluation evaluation;
+    evaluation.fitness = fitness;
+    evaluation.metaerror = metaerror;
+    evaluation.nb_genes_activ = nb_genes_activ;
+    evaluation.nb_genes_inhib = nb_genes_inhib;
+    evaluation.nb_func_genes = nb_func_genes;
+    evaluation.nb_non_func_genes = nb_non_func_genes;
+    evaluation.nb_coding_RNAs = nb_coding_RNAs;
+    evaluation.nb_non_coding_RNAs = nb_non_coding_RNAs;
+    return evaluation;
+}
 
-            int32_t rna_length;
+void Organism::compute_RNA() {
+    rnas.clear();
+    start_prot.clear();
+    proteins.clear();
 
-            if (start_pos > rna_end)
-                rna_length = (length() + rna_end) - start_pos;
-            else
-                rna_length = rna_end - start_pos;
+    terminators.reset(length());
+    dna_->terminator_masks(terminators.words());
+    shine_dal_starts.reset(length());
+    dna_->shine_dal_masks(shine_dal_starts.words());
 
-            if (rna_length > 0) {
-                int glob_rna_idx = rna_count_;
-                rna_count_ = rna_count_ + 1;
+    rnas.reserve(promoters_.size());
 
-                rnas[glob_rna_idx] = new RNA(
-                        prom_pos,
-                        rna_end,
-                        1.0 - std::fabs(((float) prom_pair.second)) / 5.0,
-                        rna_length);
-            }
-        }
+    for (const auto &prom_pair: promoters_) {
+        transcribe(prom_pair.first, prom_pair.second);
     }
 }
 
-void Organism::search_start_protein() {
-    for (int rna_idx = 0; rna_idx < rna_count_; rna_idx++) {
-        const auto &rna = rnas[rna_idx];
-        int c_pos = rna->begin;
+/**
+ * Compute the RNAs and proteins of a mutant, reusing those of its parent that no switch can have changed
+ *
+ * The terminators and Shine-Dalgarno starts are patched around the switched bases. The RNAs of the parent that are unchanged (see
+ * contains_switch) are copied with their proteins, already translated. Every other promoter is transcribed and its
+ * proteins are translated. The RNAs and the proteins come in the same order as with compute_RNA.
+ *
+ * @param parent : the organism this one is a mutant of
+ */
+void Organism::compute_RNA(const Organism &parent) {
+    rnas.clear();
+    start_prot.clear();
+    proteins.clear();
 
-        if (rna->length >= PROM_SIZE) {
-            c_pos += PROM_SIZE;
-            loop_back(c_pos);
+    patch_site_indexes(parent);
 
-            while (c_pos != rna->end) {
-                if (dna_->shine_dal_start(c_pos)) {
-                    rna->start_prot.push_back(c_pos);
-                }
+    // Most RNAs come from the parent: the same amount of storage is enough in general
+    rnas.reserve(promoters_.size());
+    start_prot.reserve(parent.start_prot.size());
+    proteins.reserve(parent.proteins.size());
 
-                c_pos++;
-                loop_back(c_pos);
+    // Both the RNAs of the parent and the promoters are sorted by position
+    int parent_idx = 0;
+    int parent_rna_count = parent.rnas.size();
+    for (const auto &prom_pair: promoters_) {
+        while (parent_idx < parent_rna_count && parent.rnas[parent_idx].begin < prom_pair.first)
+            parent_idx++;
+
+        if (parent_idx < parent_rna_count && parent.rnas[parent_idx].begin == prom_pair.first &&
+            !contains_switch(parent.rnas[parent_idx])) {
+            reuse_RNA(parent, parent.rnas[parent_idx]);
+        } else {
+            RNA *rna = transcribe(prom_pair.first, prom_pair.second);
+            if (rna != nullptr) {
+                search_start_protein(rna);
+                compute_protein(rna);
+                for (int protein_idx = rna->first_protein; protein_idx < proteins.size(); protein_idx++)
+                    translate_protein(protein_idx);
             }
         }
     }
 }
 
-void Organism::compute_protein() {
-    int resize_to = 0;
+/**
+ * Whether the switches of this mutant leave unchanged all that the evaluation of its parent read: no switch lies in
+ * an RNA of the parent (see contains_switch), and the promoters are those of the parent, each one with its RNA. A
+ * terminator that a switch creates or removes is then outside the RNAs, and ends none of them.
+ */
+bool Organism::is_neutral(const Organism &parent) const {
+    if ((int) parent.rnas.size() != parent.promoters_.size() || promoters_.size() != parent.promoters_.size())
+        return false;
 
-    for (int rna_idx = 0; rna_idx < rna_count_; rna_idx++) {
-        resize_to += rnas[rna_idx]->start_prot.size();
+    for (const auto &rna: parent.rnas) {
+        if (contains_switch(rna))
+            return false;
     }
+    return true;
+}
 
-    proteins.resize(resize_to);
-
-    for (int rna_idx = 0; rna_idx < rna_count_; rna_idx++) {
-        auto* rna = rnas[rna_idx];
-        int transcribed_start = rna->begin + PROM_SIZE;
-        loop_back(transcribed_start);
-        for (int protein_idx = 0; protein_idx < rna->start_prot.size(); protein_idx++) {
-            int protein_start = rna->start_prot[protein_idx];
-            int current_position = protein_start + SD_TO_START;
-            loop_back(current_position);
-
-            int transcription_length;
-            if (transcribed_start <= protein_start) {
-                transcription_length = protein_start - transcribed_start;
-            } else {
-                transcription_length = length() - transcribed_start + protein_start;
-            }
-            transcription_length += SD_TO_START;
-
-
-            while (rna->length - transcription_length >= CODON_SIZE) {
-                if (dna_->protein_stop(current_position)) {
-                    int prot_length;
-
-                    int protein_end = current_position + CODON_SIZE;
-                    loop_back(protein_end);
-
-                    if (protein_start + SD_TO_START < protein_end) {
-                        prot_length = protein_end - (protein_start + SD_TO_START);
-                    } else {
-                        prot_length = (length() + protein_end) - (protein_start + SD_TO_START);
-                    }
-
-                    if (prot_length > CODON_SIZE) { // it has at least 2 codons, among them a STOP
-                        int glob_prot_idx = protein_count_;
-                        protein_count_ += 1;
+/**
+ * Take the evaluation of the parent, of a neutral mutant (see is_neutral): its RNAs and proteins, as merged, its
+ * phenotype and its fitness. The terminators and Shine-Dalgarno starts are patched around the switched bases, for the
+ * mutants of this organism.
+ */
+void Organism::copy_evaluation(const Organism &parent) {
+    patch_site_indexes(parent);
 
-                        proteins[glob_prot_idx] =
-                                new Protein(protein_start,
-                                            protein_end,
-                                            prot_length,
-                                            rna->e);
+    rnas = parent.rnas;
+    start_prot = parent.start_prot;
+    proteins = parent.proteins;
 
-                        rna->is_coding_ = true;
-                    }
-                    break;
-                }
+    std::copy(parent.phenotype, parent.phenotype + FUZZY_SAMPLING, phenotype);
+    std::copy(parent.delta, parent.delta + FUZZY_SAMPLING, delta);
+    metaerror = parent.metaerror;
+    fitness = parent.fitness;
+}
 
-                current_position += CODON_SIZE;
-                loop_back(current_position);
-                transcription_length += CODON_SIZE;
-            }
+/// The terminators and Shine-Dalgarno starts of the parent, patched around the switched bases
+void Organism::patch_site_indexes(const Organism &parent) {
+    terminators = parent.terminators;
+    shine_dal_starts = parent.shine_dal_starts;
+    for (int pos : switched_positions_) {
+        for (int k = 0; k < TERM_SIZE; k++) {
+            int term_pos = mod(pos - k, length());
+            terminators.assign(term_pos, dna_->terminator_at(term_pos) == TERM_STEM_SIZE);
+        }
+        for (int k = 0; k < SD_TO_START; k++) {
+            int start_pos = mod(pos - k, length());
+            shine_dal_starts.assign(start_pos, dna_->shine_dal_start(start_pos));
         }
     }
 }
 
-void Organism::translate_protein() {
-    for (int protein_idx = 0; protein_idx < protein_count_; protein_idx++) {
-        auto* protein = proteins[protein_idx];
-        if (protein->is_init_) {
-            int c_pos = protein->protein_start;
-            c_pos += SD_TO_START;
-            loop_back(c_pos);
-
-            int nb_codon = (protein->protein_length / 3) - 1; // Do not count the STOP codon
-            // Arbitrary limit to the number of codon in one gene
-            // It has black magic reasons
-            constexpr int FRACTION_SIZE = 52;
-            nb_codon = min(nb_codon, FRACTION_SIZE);
-            int codon_list[FRACTION_SIZE]{};
-
-            for (int codon_idx = 0; codon_idx < nb_codon; ++codon_idx) {
-                codon_list[codon_idx] = dna_->codon_at(c_pos);
-
-                c_pos += 3;
-                loop_back(c_pos);
-            }
+/**
+ * Look for the terminator of the promoter at prom_pos and add the resulting RNA (if any) to rnas
+ *
+ * @return the new RNA (valid until the next one is added), or nullptr
+ */
+RNA *Organism::transcribe(int prom_pos, ErrorType error) {
+    /* Search for terminators */
+    int cur_pos = prom_pos + PROM_SIZE;
+    loop_back(cur_pos);
+
+    int start_pos = cur_pos;
+
+    // Next terminator, looping back to the origin (cur_pos itself included)
+    cur_pos = terminators.next(cur_pos);
+    bool terminator_found = cur_pos != -1;
+
+    if (terminator_found) {
+        int32_t rna_end = cur_pos + TERM_SIZE;
+        loop_back(rna_end);
+
+        int32_t rna_length;
+
+        if (start_pos > rna_end)
+            rna_length = (length() + rna_end) - start_pos;
+        else
+            rna_length = rna_end - start_pos;
+
+        if (rna_length > 0) {
+            rnas.emplace_back(
+                    prom_pos,
+                    rna_end,
+                    expression_level(error),
+                    rna_length);
+            return &rnas.back();
+        }
+    }
+    return nullptr;
+}
 
-/** This part of the code translate a Gray code binary to standard
- * It looks like black magic (again) but the ide of the implementation can be found hear:
- * https://www.elprocus.com/code-converter-binary-to-gray-code-and-gray-code-to-binary-conversion/ **/
-            double M = 0.0;
-            double W = 0.0;
-            double H = 0.0;
+/**
+ * Whether a switched base lies among the bases read to build an RNA of the parent and its proteins: the promoter,
+ * the transcribed sequence up to the end of the terminator, and the Shine-Dalgarno sequences starting before the end.
+ */
+bool Organism::contains_switch(const RNA &rna) const {
+    int term_dist = mod(rna.end - TERM_SIZE - rna.begin - PROM_SIZE, length());
+    int span = PROM_SIZE + term_dist + TERM_SIZE + SD_TO_START - 1;
+    if (span >= length())
+        return true;
+
+    for (int pos : switched_positions_) {
+        if (mod(pos - rna.begin, length()) < span)
+            return true;
+    }
+    return false;
+}
 
-            int nb_m = 0;
-            int nb_w = 0;
-            int nb_h = 0;
+/**
+ * Append a copy of an RNA of the parent and of its (translated) proteins
+ */
+void Organism::reuse_RNA(const Organism &parent, const RNA &parent_rna) {
+    rnas.push_back(parent_rna);
+    RNA &rna = rnas.back();
 
-            bool bin_m = false; // Initializing to false will yield a conservation of the high weight bit
-            bool bin_w = false; // when applying the XOR operator for the Gray to standard conversion
-            bool bin_h = false;
+    rna.first_start_prot = start_prot.size();
+    auto parent_start = parent.start_prot.begin() + parent_rna.first_start_prot;
+    start_prot.insert(start_prot.end(), parent_start, parent_start + parent_rna.nb_start_prot);
 
+    rna.first_protein = proteins.size();
+    proteins.append(parent.proteins, parent_rna.first_protein, parent_rna.nb_proteins);
 
-            for (int i = 0; i < nb_codon; i++) {
-                switch (codon_list[i]) {
-                    case CODON_M0 : {
-                        // M codon found
-                        nb_m++;
+    // Undo the merge of the duplicated proteins done in the parent, it is done again once all proteins are known
+    for (int protein_idx = rna.first_protein; protein_idx < proteins.size(); protein_idx++) {
+        proteins.e[protein_idx] = parent_rna.e;
+        proteins.is_init_[protein_idx] = true;
+    }
+}
 
-                        // Convert Gray code to "standard" binary code
-                        bin_m ^= false; // as bin_m was initialized to false, the XOR will have no effect on the high weight bit
+void Organism::search_start_protein() {
+    for (auto &rna: rnas) {
+        search_start_protein(&rna);
+    }
+}
 
-                        // A lower-than-the-previous-lowest weight bit was found, make a left bitwise shift
-                        //~ M <<= 1;
-                        M *= 2;
+/// Append the Shine-Dalgarno starts of the transcribed sequence of an RNA (after its promoter) to start_prot
+void Organism::search_start_protein(RNA *rna) {
+    rna->first_start_prot = start_prot.size();
 
-                        // Add this nucleotide's contribution to M
-                        if (bin_m) M += 1;
+    if (rna->length >= PROM_SIZE) {
+        int c_pos = rna->begin + PROM_SIZE;
+        loop_back(c_pos);
 
-                        break;
-                    }
-                    case CODON_M1 : {
-                        // M codon found
-                        nb_m++;
+        shine_dal_starts.for_each(c_pos, mod(rna->end - c_pos, length()),
+                                  [this](int pos) { start_prot.push_back(pos); });
+    }
 
-                        // Convert Gray code to "standard" binary code
-                        bin_m ^= true; // as bin_m was initialized to false, the XOR will have no effect on the high weight bit
+    rna->nb_start_prot = start_prot.size() - rna->first_start_prot;
+}
 
-                        // A lower-than-the-previous-lowest bit was found, make a left bitwise shift
-                        //~ M <<= 1;
-                        M *= 2;
+void Organism::compute_protein() {
+    // At most one protein per start
+    proteins.reserve(start_prot.size());
 
-                        // Add this nucleotide's contribution to M
-                        if (bin_m) M += 1;
+    for (auto &rna: rnas) {
+        compute_protein(&rna);
+    }
+}
 
-                        break;
-                    }
-                    case CODON_W0 : {
-                        // W codon found
-                        nb_w++;
+void Organism::compute_protein(RNA *rna) {
+    rna->first_protein = proteins.size();
+
+    int transcribed_start = rna->begin + PROM_SIZE;
+    loop_back(transcribed_start);
+    for (int protein_idx = 0; protein_idx < rna->nb_start_prot; protein_idx++) {
+        int protein_start = start_prot[rna->first_start_prot + protein_idx];
+        int current_position = protein_start + SD_TO_START;
+        loop_back(current_position);
+
+        int transcription_length;
+        if (transcribed_start <= protein_start) {
+            transcription_length = protein_start - transcribed_start;
+        } else {
+            transcription_length = length() - transcribed_start + protein_start;
+        }
+        transcription_length += SD_TO_START;
 
-                        // Convert Gray code to "standard" binary code
-                        bin_w ^= false; // as bin_m was initialized to false, the XOR will have no effect on the high weight bit
 
-                        // A lower-than-the-previous-lowest weight bit was found, make a left bitwise shift
-                        //~ W <<= 1;
-                        W *= 2;
+        while (rna->length - transcription_length >= CODON_SIZE) {
+            if (dna_->protein_stop(current_position)) {
+                int prot_length;
 
-                        // Add this nucleotide's contribution to W
-                        if (bin_w) W += 1;
+                int protein_end = current_position + CODON_SIZE;
+                loop_back(protein_end);
 
-                        break;
-                    }
-                    case CODON_W1 : {
-                        // W codon found
-                        nb_w++;
+                if (protein_start + SD_TO_START < protein_end) {
+                    prot_length = protein_end - (protein_start + SD_TO_START);
+                } else {
+                    prot_length = (length() + protein_end) - (protein_start + SD_TO_START);
+                }
 
-                        // Convert Gray code to "standard" binary code
-                        bin_w ^= true; // as bin_m was initialized to false, the XOR will have no effect on the high weight bit
+                if (prot_length > CODON_SIZE) { // it has at least 2 codons, among them a STOP
+                    proteins.add(protein_start,
+                                 protein_end,
+                                 prot_length,
+                                 rna->e);
 
-                        // A lower-than-the-previous-lowest weight bit was found, make a left bitwise shift
-                        //~ W <<= 1;
-                        W *= 2;
+                    rna->is_coding_ = true;
+                }
+                break;
+            }
 
-                        // Add this nucleotide's contribution to W
-                        if (bin_w) W += 1;
+            current_position += CODON_SIZE;
+            loop_back(current_position);
+            transcription_length += CODON_SIZE;
+        }
+    }
 
-                        break;
-                    }
-                    case CODON_H0 :
-                    case CODON_START : // Start codon codes for the same amino-acid as H0 codon
-                    {
-                        // H codon found
-                        nb_h++;
+    rna->nb_proteins = proteins.size() - rna->first_protein;
+}
 
-                        // Convert Gray code to "standard" binary code
-                        bin_h ^= false; // as bin_m was initialized to false, the XOR will have no effect on the high weight bit
+void Organism::translate_protein() {
+    for (int protein_idx = 0; protein_idx < proteins.size(); protein_idx++) {
+        if (proteins.is_init_[protein_idx]) {
+            translate_protein(protein_idx);
+        }
+    }
 
-                        // A lower-than-the-previous-lowest weight bit was found, make a left bitwise shift
-                        //~ H <<= 1;
-                        H *= 2;
+    merge_proteins();
+}
 
-                        // Add this nucleotide's contribution to H
-                        if (bin_h) H += 1;
+namespace {
+// Amino acid of a codon, as 2 * kind + bit: the kind is 0 for M, 1 for W, 2 for H (the START codon codes for H0) and
+// 3 for STOP (never translated), the bit is that of the Gray code of the kind
+constexpr int8_t amino_acid(int codon) {
+    return codon == CODON_M0 ? 0 : codon == CODON_M1 ? 1 : codon == CODON_W0 ? 2 : codon == CODON_W1 ? 3 :
+           codon == CODON_H0 || codon == CODON_START ? 4 : codon == CODON_H1 ? 5 : 6;
+}
 
-                        break;
-                    }
-                    case CODON_H1 : {
-                        // H codon found
-                        nb_h++;
+// Codon of 3 bases as in a Dna::window (the first base in the low bit, while it is the high bit of the codon)
+constexpr int codon_of_bases(int bases) { return ((bases & 1) << 2) | (bases & 2) | ((bases >> 2) & 1); }
 
-                        // Convert Gray code to "standard" binary code
-                        bin_h ^= true; // as bin_m was initialized to false, the XOR will have no effect on the high weight bit
+constexpr int8_t AMINO_ACIDS[8] = {
+        amino_acid(codon_of_bases(0)), amino_acid(codon_of_bases(1)), amino_acid(codon_of_bases(2)),
+        amino_acid(codon_of_bases(3)), amino_acid(codon_of_bases(4)), amino_acid(codon_of_bases(5)),
+        amino_acid(codon_of_bases(6)), amino_acid(codon_of_bases(7))
+};
 
-                        // A lower-than-the-previous-lowest weight bit was found, make a left bitwise shift
-                        //~ H <<= 1;
-                        H *= 2;
+// Codons read from each window of the genome
+constexpr int CODONS_PER_WINDOW = Dna::WINDOW_SIZE / CODON_SIZE;
 
-                        // Add this nucleotide's contribution to H
-                        if (bin_h) H += 1;
+/// Binary value of a Gray code: each bit is the XOR of the bits of the code from the highest one down to it
+inline uint64_t gray_to_binary(uint64_t code) {
+    for (int shift = 1; shift < 64; shift *= 2)
+        code ^= code >> shift;
+    return code;
+}
+}
 
-                        break;
-                    }
-                }
-            }
-/// End of Black Magic
-
-            protein->protein_length = nb_codon;
-
-
-            //  ----------------------------------------------------------------------------------
-            //  2) Normalize M, W and H values in [0;1] according to number of codons of each kind
-            //  ----------------------------------------------------------------------------------
-            protein->m = nb_m != 0 ? M / (pow(2, nb_m) - 1) : 0.5;
-            protein->w = nb_w != 0 ? W / (pow(2, nb_w) - 1) : 0.0;
-            protein->h = nb_h != 0 ? H / (pow(2, nb_h) - 1) : 0.5;
-
-            //  ------------------------------------------------------------------------------------
-            //  3) Normalize M, W and H values according to the allowed ranges (defined in macros.h)
-            //  ------------------------------------------------------------------------------------
-            // x_min <= M <= x_max
-            // w_min <= W <= w_max
-            // h_min <= H <= h_max
-            protein->m = (X_MAX - X_MIN) * protein->m + X_MIN;
-            protein->w = (W_MAX - W_MIN) * protein->w + W_MIN;
-            protein->h = (H_MAX - H_MIN) * protein->h + H_MIN;
-
-            if (nb_m == 0 || nb_w == 0 || nb_h == 0 ||
-                protein->w == 0.0 ||
-                protein->h == 0.0) {
-                protein->is_functional = false;
-            } else {
-                protein->is_functional = true;
-            }
+/**
+ * Translate the codons of a protein: the Gray codes of its mean, width and height are each gathered as an integer
+ * (a codon appends its bit to the code of its kind), then converted to binary.
+ *
+ * The codons are decoded CODONS_PER_WINDOW at a time from a window of the genome, through AMINO_ACIDS.
+ */
+void Organism::translate_protein(int protein_idx) {
+    int c_pos = proteins.protein_start[protein_idx];
+    c_pos += SD_TO_START;
+    loop_back(c_pos);
+
+    int nb_codon = (proteins.protein_length[protein_idx] / 3) - 1; // Do not count the STOP codon
+    // Arbitrary limit to the number of codon in one gene
+    // It has black magic reasons
+    constexpr int FRACTION_SIZE = 52;
+    nb_codon = min(nb_codon, FRACTION_SIZE);
+
+    // Gray code and number of codons of each kind (see amino_acid)
+    uint64_t codes[4]{};
+    int nb_codons[4]{};
+
+    for (int codon_idx = 0; codon_idx < nb_codon;) {
+        uint64_t bases = dna_->window(c_pos);
+        int nb = min(nb_codon - codon_idx, CODONS_PER_WINDOW);
+        for (int i = 0; i < nb; i++, bases >>= CODON_SIZE) {
+            int acid = AMINO_ACIDS[bases & 7];
+            codes[acid >> 1] = (codes[acid >> 1] << 1) | (acid & 1);
+            nb_codons[acid >> 1]++;
         }
+
+        codon_idx += nb;
+        c_pos += nb * CODON_SIZE;
+        // A window may go around a genome shorter than itself
+        if (c_pos >= length()) c_pos %= length();
     }
 
+    // At most FRACTION_SIZE bits: the codes are exact as doubles
+    set_protein_values(protein_idx, nb_codon, (double) gray_to_binary(codes[0]), (double) gray_to_binary(codes[1]),
+                       (double) gray_to_binary(codes[2]), nb_codons[0], nb_codons[1], nb_codons[2]);
+}
 
-    std::map<int, Protein *> lookup;
+/**
+ * Set the values of a protein of nb_codon codons from the codes of its mean, width and height (M, W and H, converted
+ * from Gray code) and its number of codons of each kind
+ */
+void Organism::set_protein_values(int protein_idx, int nb_codon, double M, double W, double H, int nb_m, int nb_w,
+                                  int nb_h) {
+    proteins.protein_length[protein_idx] = nb_codon;
+
+
+    //  ----------------------------------------------------------------------------------
+    //  2) Normalize M, W and H values in [0;1] according to number of codons of each kind
+    //  ----------------------------------------------------------------------------------
+    // 2^nb - 1, the largest code of nb bits, is exact as a double
+    double m = nb_m != 0 ? M / (double) ((uint64_t{1} << nb_m) - 1) : 0.5;
+    double w = nb_w != 0 ? W / (double) ((uint64_t{1} << nb_w) - 1) : 0.0;
+    double h = nb_h != 0 ? H / (double) ((uint64_t{1} << nb_h) - 1) : 0.5;
+
+    //  ------------------------------------------------------------------------------------
+    //  3) Normalize M, W and H values according to the allowed ranges (defined in macros.h)
+    //  ------------------------------------------------------------------------------------
+    // x_min <= M <= x_max
+    // w_min <= W <= w_max
+    // h_min <= H <= h_max
+    m = (X_MAX - X_MIN) * m + X_MIN;
+    w = (W_MAX - W_MIN) * w + W_MIN;
+    h = (H_MAX - H_MIN) * h + H_MIN;
+
+    proteins.m[protein_idx] = m;
+    proteins.w[protein_idx] = w;
+    proteins.h[protein_idx] = h;
+
+    if (nb_m == 0 || nb_w == 0 || nb_h == 0 ||
+        w == 0.0 ||
+        h == 0.0) {
+        proteins.is_functional[protein_idx] = false;
+    } else {
+        proteins.is_functional[protein_idx] = true;
+    }
+}
 
-    for (int protein_idx = 0; protein_idx < protein_count_; protein_idx++) {
-        auto* protein = proteins[protein_idx];
-        if (protein->is_init_) {
-            if (lookup.find(protein->protein_start) == lookup.end()) {
-                lookup[protein->protein_start] = protein;
-            } else {
-                lookup[protein->protein_start]->e += protein->e;
-                protein->is_init_ = false;
-            }
+/**
+ * Proteins starting at the same position are the same protein: keep the first one, with the sum of their
+ * concentrations
+ */
+void Organism::merge_proteins() {
+    // (start << 32) | index of each protein, sorted: the proteins of a start are together, the first one ahead
+    static thread_local std::vector<uint64_t> keys;
+    keys.clear();
+    for (int protein_idx = 0; protein_idx < proteins.size(); protein_idx++) {
+        if (proteins.is_init_[protein_idx])
+            keys.push_back(((uint64_t) proteins.protein_start[protein_idx] << 32) | (uint32_t) protein_idx);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    int first = -1;
+    for (size_t i = 0; i < keys.size(); i++) {
+        int protein_idx = (int) (uint32_t) keys[i];
+        if (i > 0 && (keys[i] >> 32) == (keys[i - 1] >> 32)) {
+            proteins.e[first] += proteins.e[protein_idx];
+            proteins.is_init_[protein_idx] = false;
+        } else {
+            first = protein_idx;
         }
     }
 }
 
-void Organism::compute_phenotype() {
+/**
+ * Compute the phenotype from the proteins, then the fitness against the target (see compute_fitness)
+ */
+void Organism::compute_phenotype(const double *target) {
     double activ_phenotype[FUZZY_SAMPLING]{};
     double inhib_phenotype[FUZZY_SAMPLING]{};
 
-    for (int protein_idx = 0; protein_idx < protein_count_; protein_idx++) {
-        const auto* protein = proteins[protein_idx];
-        if (protein->is_init_ && protein->is_functional) {
+    for (int protein_idx = 0; protein_idx < proteins.size(); protein_idx++) {
+        if (proteins.is_init_[protein_idx] && proteins.is_functional[protein_idx]) {
+            double m = proteins.m[protein_idx];
+            double w = proteins.w[protein_idx];
+            double h = proteins.h[protein_idx];
+
             // Compute triangle points' coordinates
-            double x0 = protein->m - protein->w;
-            double x1 = protein->m;
-            double x2 = protein->m + protein->w;
+            double x0 = m - w;
+            double x1 = m;
+            double x2 = m + w;
 
             int ix0 = (int) (x0 * FUZZY_SAMPLING);
             int ix1 = (int) (x1 * FUZZY_SAMPLING);
@@ -522,63 +834,86 @@ void Organism::compute_phenotype() {
             if (ix1 < 0) ix1 = 0; else if (ix1 > (FUZZY_SAMPLING - 1)) ix1 = FUZZY_SAMPLING - 1;
             if (ix2 < 0) ix2 = 0; else if (ix2 > (FUZZY_SAMPLING - 1)) ix2 = FUZZY_SAMPLING - 1;
 
+            // Activators and inhibitors are accumulated apart, the loops below are then branchless
+            double *contribution = h > 0 ? activ_phenotype : inhib_phenotype;
+            double height = h * proteins.e[protein_idx];
+
             // Compute the first equation of the triangle
-            double incY = (protein->h * protein->e) / (ix1 - ix0);
-            int count = 1;
+            double incY = height / (ix1 - ix0);
 
             // Updating value between x0 and x1
             for (int i = ix0 + 1; i <= ix1; i++) {
-                if (protein->h > 0)
-                    activ_phenotype[i] += (incY * (count++));
-                else
-                    inhib_phenotype[i] += (incY * (count++));
+                contribution[i] += incY * (i - ix0);
             }
 
             // Compute the second equation of the triangle
-            incY = (protein->h * protein->e) / (ix2 - ix1);
-            count = 1;
+            incY = height / (ix2 - ix1);
 
             // Updating value between x1 and x2
             for (int i = ix1 + 1; i < ix2; i++) {
-                if (protein->h > 0)
-                    activ_phenotype[i] += (protein->h * protein->e) - (incY * count++);
-                else
-                    inhib_phenotype[i] += (protein->h * protein->e) - (incY * count++);
+                contribution[i] += height - incY * (i - ix1);
             }
         }
     }
 
 
-    for (int fuzzy_idx = 0; fuzzy_idx < FUZZY_SAMPLING; fuzzy_idx++) {
-        if (activ_phenotype[fuzzy_idx] > 1)
-            activ_phenotype[fuzzy_idx] = 1;
-        if (inhib_phenotype[fuzzy_idx] < -1)
-            inhib_phenotype[fuzzy_idx] = -1;
-    }
-
-    for (int fuzzy_idx = 0; fuzzy_idx < FUZZY_SAMPLING; fuzzy_idx++) {
-        phenotype[fuzzy_idx] = activ_phenotype[fuzzy_idx] + inhib_phenotype[fuzzy_idx];
-        if (phenotype[fuzzy_idx] < 0)
-            phenotype[fuzzy_idx] = 0;
-        if (phenotype[fuzzy_idx] > 1)
-            phenotype[fuzzy_idx] = 1;
-    }
+    compute_fitness(activ_phenotype, inhib_phenotype, target);
 }
 
-void Organism::compute_fitness(const double *target) {
+/**
+ * Clamp and sum the activation and inhibition phenotypes, compare the result to the target and compute the fitness,
+ * in a single pass over the fuzzy space
+ *
+ * The metaerror is the area between the phenotype and the target, by the trapezoidal rule. By default it is summed
+ * in double precision in the order of the fuzzy space, the same as the separate passes of the original code. With
+ * FAST_FITNESS (CMake option), the sum is a vectorized reduction in single precision: the fitness then differs
+ * slightly, as the terms are added in another order and with another precision.
+ */
+void Organism::compute_fitness(const double *activ_phenotype, const double *inhib_phenotype, const double *target) {
+#ifdef FAST_FITNESS
+    float sum = 0.0f;
+
+#pragma omp simd reduction(+:sum)
     for (int fuzzy_idx = 0; fuzzy_idx < FUZZY_SAMPLING; fuzzy_idx++) {
-        delta[fuzzy_idx] = phenotype[fuzzy_idx] - target[fuzzy_idx];
+        double value = std::min(activ_phenotype[fuzzy_idx], 1.0) + std::max(inhib_phenotype[fuzzy_idx], -1.0);
+        value = std::min(std::max(value, 0.0), 1.0);
+
+        phenotype[fuzzy_idx] = value;
+        delta[fuzzy_idx] = value - target[fuzzy_idx];
+        sum += std::fabs((float) delta[fuzzy_idx]);
     }
 
+    // Every inner point is a side of two trapezoids, the two ends of the fuzzy space of only one
+    float ends = std::fabs((float) delta[0]) + std::fabs((float) delta[FUZZY_SAMPLING - 1]);
+    metaerror = (2.0f * sum - ends) / (2 * (float) FUZZY_SAMPLING);
+#else
     metaerror = 0;
+    double previous_error = 0.0;
 
-    for (int fuzzy_idx = 0; fuzzy_idx < FUZZY_SAMPLING - 1; fuzzy_idx++) {
-        // Computing a trapezoid area (A+B)*h/2 with:
-        //   base A as delta[fuzzy_idx]
-        //   base B as delta[fuzzy_idx + 1]
-        //   height h as 1/FUZZY_SAMPLING
-        metaerror += (std::fabs(delta[fuzzy_idx]) + std::fabs(delta[fuzzy_idx + 1])) / (2 * (double)FUZZY_SAMPLING);
+    for (int fuzzy_idx = 0; fuzzy_idx < FUZZY_SAMPLING; fuzzy_idx++) {
+        double activ = activ_phenotype[fuzzy_idx] > 1 ? 1 : activ_phenotype[fuzzy_idx];
+        double inhib = inhib_phenotype[fuzzy_idx] < -1 ? -1 : inhib_phenotype[fuzzy_idx];
+
+        double value = activ + inhib;
+        if (value < 0)
+            value = 0;
+        if (value > 1)
+            value = 1;
+
+        phenotype[fuzzy_idx] = value;
+        delta[fuzzy_idx] = value - target[fuzzy_idx];
+
+        double error = std::fabs(delta[fuzzy_idx]);
+        if (fuzzy_idx > 0) {
+            // Computing a trapezoid area (A+B)*h/2 with:
+            //   base A as delta[fuzzy_idx - 1]
+            //   base B as delta[fuzzy_idx]
+            //   height h as 1/FUZZY_SAMPLING
+            metaerror += (previous_error + error) / (2 * (double) FUZZY_SAMPLING);
+        }
+        previous_error = error;
     }
+#endif
 
     fitness = exp(-SELECTION_PRESSURE * ((double) metaerror));
 }
@@ -645,7 +980,7 @@ void Organism::remove_promoters_starting_between(int32_t pos_1, int32_t pos_2) {
         remove_promoters_starting_before(pos_2);
     } else {
         // suppression is in [pos1, pos_2[, pos_2 is excluded
-        promoters_.erase(promoters_.lower_bound(pos_1), promoters_.upper_bound(pos_2 - 1));
+        promoters_.erase(promoters_.lower_bound(pos_1), promoters_.lower_bound(pos_2));
     }
 }
 
@@ -655,14 +990,13 @@ void Organism::remove_promoters_starting_after(int32_t pos) {
 
 void Organism::remove_promoters_starting_before(int32_t pos) {
     // suppression is in [0, pos[, pos is excluded
-    promoters_.erase(promoters_.begin(), promoters_.upper_bound(pos - 1));
+    promoters_.erase(promoters_.begin(), promoters_.lower_bound(pos));
 }
 
 void Organism::add_new_promoter(int32_t position, int8_t error) {
     // TODO: Insertion should not always occur, especially if promoter become better or worse ?
     // Promoters are deleted anyway if victim of mutation. the IF stays unnecessary
-    if (promoters_.find(position) == promoters_.end())
-        promoters_[position] = error;
+    promoters_.insert(position, error);
 }
 
 void Organism::look_for_new_promoters_starting_between(int32_t pos_1, int32_t pos_2) {
@@ -675,37 +1009,21 @@ void Organism::look_for_new_promoters_starting_between(int32_t pos_1, int32_t po
         look_for_new_promoters_starting_before(pos_2);
         return;
     }
-    // Hamming distance of the sequence from the promoter consensus
 
-    for (int32_t i = pos_1; i < pos_2; i++) {
-        int8_t dist = dna_->promoter_at(i);
-
-        if (dist <= PROM_MAX_DIFF) { // dist takes the hamming distance of the sequence from the consensus
-            add_new_promoter(i, dist);
-        }
-    }
+    dna_->for_each_promoter(pos_1, pos_2, [this](int i) {
+        // promoter_at() gives the hamming distance of the sequence from the consensus
+        add_new_promoter(i, dna_->promoter_at(i));
+    });
 }
 
 void Organism::look_for_new_promoters_starting_after(int32_t pos) {
-    for (int32_t i = pos; i < dna_->length(); i++) {
-        int dist = dna_->promoter_at(i);
-
-        if (dist <= 4) { // dist takes the hamming distance of the sequence from the consensus
-            add_new_promoter(i, dist);
-        }
-    }
+    dna_->for_each_promoter(pos, dna_->length(), [this](int i) {
+        add_new_promoter(i, dna_->promoter_at(i));
+    });
 }
 
 void Organism::look_for_new_promoters_starting_before(int32_t pos) {
-    // Hamming distance of the sequence from the promoter consensus
-
-    for (int32_t i = 0; i < pos; i++) {
-
-        int dist = dna_->promoter_at(i);
-
-        if (dist <= 4) { // dist takes the hamming distance of the sequence from the consensus
-            add_new_promoter(i, dist);
-        }
-    }
+    dna_->for_each_promoter(0, pos, [this](int i) {
+        add_new_promoter(i, dna_->promoter_at(i));
+    });
 }
-
@@ -26,40 +26,58 @@
 
 #pragma once
 
-#include <map>
 #include <memory>
-#include <set>
 #include <zlib.h>
-#include <list>
 #include <cstdint>
+#include <cmath>
 
 #include "RNA.h"
-#include "Protein.h"
+#include "ProteinTable.h"
 #include "Dna.h"
+#include "EvaluationCache.h"
 #include "MutationEvent.h"
+#include "PositionIndex.h"
+#include "PromoterMap.h"
 #include "aevol_constants.h"
 
 /**
  * Class that implements an organism and its related DNAs, RNAs, Protein and Phenotype
  */
 class Organism {
+    // Micro-benchmarks of the stages of evaluate (see bench.cpp)
+    friend struct OrganismBenchmark;
 
 public:
+    /// Organism of an empty genome, e.g. a slot of a Population that clones are assigned to
+    Organism();
+
     Organism(int length, Threefry::Gen &&rng);
 
     explicit Organism(const std::shared_ptr<Organism> &clone);
 
+    /**
+     * Make this organism a clone of the given one, as the constructor above does, reusing its storage (the genome, the
+     * promoters and the buffers of the evaluations keep their capacity)
+     */
+    void assign_clone(const Organism &clone);
+
     explicit Organism(gzFile backup_file);
 
+    /// Organism of the given genome, which it takes the ownership of
+    explicit Organism(Dna *dna);
+
     ~Organism();
 
     void save(gzFile backup_file) const;
 
+    /// Append the genome to buffer (see Dna::save(std::vector<char>&))
+    void save(std::vector<char> &buffer) const { dna_->save(buffer); }
+
     void load(gzFile backup_file);
 
     int length() const { return dna_->length(); };
 
-    void apply_mutations(const std::list<MutationEvent *> &mutation_list);
+    void apply_mutations(const std::vector<MutationEvent> &mutation_list);
 
     void reset_mutation_stats();
 
@@ -69,14 +87,30 @@ public:
 
     void evaluate(const double* target);
 
+    void evaluate(const double* target, const Organism &parent);
 
-    using ErrorType = int8_t;
+    /**
+     * Take the evaluation of an organism of the same genome (see EvaluationCache): the fitness, the metabolic error
+     * and the stats of compute_protein_stats are set, not the RNAs, the proteins nor the phenotype
+     */
+    void evaluate(const EvaluationCache::Evaluation &evaluation);
+
+    /// Values of the last evaluation and of compute_protein_stats, for an EvaluationCache
+    EvaluationCache::Evaluation evaluation() const;
+
+
+    using ErrorType = PromoterMap::ErrorType;
     // Map position (int) to Promoter
-    std::map<int, ErrorType> promoters_;
+    PromoterMap promoters_;
 
-    std::set<int> terminators;
-    std::vector<RNA *> rnas;
-    std::vector<Protein *> proteins;
+    // Terminators and Shine-Dalgarno starts of the genome, rebuilt (or patched from the parent) by each evaluation
+    PositionIndex terminators;
+    PositionIndex shine_dal_starts;
+    // Built by each evaluation, in the order of the promoters. The start positions of the proteins of each RNA
+    // (see RNA::first_start_prot) and the proteins of each RNA (see RNA::first_protein) are contiguous.
+    std::vector<RNA> rnas;
+    std::vector<int> start_prot;
+    ProteinTable proteins;
 
     double phenotype[FUZZY_SAMPLING]{};
     double delta[FUZZY_SAMPLING]{};
@@ -86,9 +120,6 @@ public:
 
     Dna *dna_ = nullptr;
 
-    int protein_count_ = 0;
-    int rna_count_ = 0;
-
     // Stats
     int nb_genes_activ = 0;
     int nb_genes_inhib = 0;
@@ -101,13 +132,37 @@ public:
     int nb_mut_ = 0;
 
 private:
+    // Positions switched by the last apply_mutations, and whether it also applied rearrangements (the switches are
+    // then not listed)
+    std::vector<int> switched_positions_;
+    bool rearranged_ = false;
+    // Whether the last evaluation was taken from an EvaluationCache, without the RNAs its mutants could reuse
+    bool from_cache_ = false;
+    // Junctions left by the rearrangements of apply_mutations, before which the promoters are searched again
+    std::vector<int32_t> junctions_;
+
     // Evaluation
     void compute_RNA();
+    void compute_RNA(const Organism &parent);
+    RNA *transcribe(int prom_pos, ErrorType error);
+    bool contains_switch(const RNA &rna) const;
+    bool is_neutral(const Organism &parent) const;
+    void copy_evaluation(const Organism &parent);
+    void patch_site_indexes(const Organism &parent);
+    void reuse_RNA(const Organism &parent, const RNA &parent_rna);
     void search_start_protein();
+    void search_start_protein(RNA *rna);
     void compute_protein();
+    void compute_protein(RNA *rna);
     void translate_protein();
-    void compute_phenotype();
-    void compute_fitness(const double* target);
+    void translate_protein(int protein_idx);
+    void set_protein_values(int protein_idx, int nb_codon, double M, double W, double H, int nb_m, int nb_w, int nb_h);
+    void merge_proteins();
+    void compute_phenotype(const double* target);
+    void compute_fitness(const double* activ_phenotype, const double* inhib_phenotype, const double* target);
+
+    /// Concentration of the proteins of an RNA whose promoter has the given number of mismatches
+    static double expression_level(ErrorType error) { return 1.0 - std::fabs(((float) error)) / 5.0; }
 
     // Mutation
     bool do_switch(int pos);
@@ -136,6 +191,22 @@ private:
 
     void add_new_promoter(int32_t position, int8_t error);
 
+    // Promoters of the rearrangements applied to a DnaRope, see apply_mutations
+    void remove_segment_promoters(int32_t pos_1, int32_t pos_2, int32_t length);
+
+    void insert_segment_promoters(int32_t pos, int32_t nb_bases, int32_t length,
+                                  std::vector<PromoterMap::value_type> &promoters,
+                                  const std::vector<int32_t> &junctions);
+
+    void copy_segment_promoters(int32_t pos_1, int32_t pos_2, int32_t length,
+                                std::vector<PromoterMap::value_type> &promoters,
+                                std::vector<int32_t> &junctions) const;
+
+    /// Number of bases of the segment [pos_1, pos_2[ (see DnaRope) of a genome of `length` bases
+    static int32_t segment_length(int32_t pos_1, int32_t pos_2, int32_t length) {
+        return pos_1 < pos_2 ? pos_2 - pos_1 : length - pos_1 + pos_2;
+    }
+
     static inline int32_t mod(int32_t a, int32_t b) {
 
         assert(b > 0);
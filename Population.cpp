@@ -0,0 +1,95 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "Population.h"
+
+#include <utility>
+
+Population::Population(int nb_cells, int nb_extra_slots)
+        : nb_cells_(nb_cells), parent_slots_(nb_cells, -1), first_clones_(nb_cells + nb_extra_slots, -1) {
+    for (int buffer = 0; buffer < 2; buffer++) {
+        slots_[buffer].resize(nb_cells + nb_extra_slots);
+        for (auto &slot: slots_[buffer])
+            slot.reset(new Organism());
+        holders_[buffer].resize(nb_cells);
+        for (int cell = 0; cell < nb_cells; cell++)
+            holders_[buffer][cell] = cell;
+    }
+}
+
+void Population::assign(int cell, const Organism &organism) {
+    slots_[current_][cell]->assign_clone(organism);
+    holders_[current_][cell] = cell;
+}
+
+void Population::assign_all(const Organism &organism) {
+    slots_[current_][0]->assign_clone(organism);
+    for (int cell = 0; cell < nb_cells_; cell++)
+        holders_[current_][cell] = 0;
+}
+
+Organism &Population::mutant(int cell, int parent_slot) {
+    Organism &mutant = *slots_[1 - current_][cell];
+    mutant.assign_clone(*slots_[current_][parent_slot]);
+    parent_slots_[cell] = -1;
+    return mutant;
+}
+
+/**
+ * The first clone (of lowest index) of a parent slot holds its organism in the next generation, the others refer to
+ * it. The first clones are found in a serial pass of integer operations over parent_slots_, the clones of a slot
+ * possibly being anywhere in the grid (see MpiExpManager for the extra slots). Then each cell writes its own holder and
+ * each holder moves the parent slot into its own slot, the organism it had going to the current buffer to be reused
+ * for a later mutant. No cell writes what another cell reads in the same loop, so the parallel loops need no atomics.
+ */
+void Population::swap() {
+    const int next = 1 - current_;
+    std::vector<int> &holders = holders_[next];
+
+    for (int cell = 0; cell < nb_cells_; cell++) {
+        const int parent_slot = parent_slots_[cell];
+        if (parent_slot >= 0 && first_clones_[parent_slot] < 0)
+            first_clones_[parent_slot] = cell;
+    }
+
+#pragma omp parallel for
+    for (int cell = 0; cell < nb_cells_; cell++) {
+        const int parent_slot = parent_slots_[cell];
+        holders[cell] = parent_slot < 0 ? cell : first_clones_[parent_slot];
+        if (holders[cell] == cell && parent_slot >= 0)
+            std::swap(slots_[current_][parent_slot], slots_[next][cell]);
+    }
+
+    // Only the holder of a parent slot resets it, once every cell has read it
+#pragma omp parallel for
+    for (int cell = 0; cell < nb_cells_; cell++) {
+        const int parent_slot = parent_slots_[cell];
+        if (parent_slot >= 0 && holders[cell] == cell)
+            first_clones_[parent_slot] = -1;
+    }
+
+    current_ = next;
+}
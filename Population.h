@@ -0,0 +1,99 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Organism.h"
+
+/**
+ * Organisms of the cells of a simulation, in two generation buffers of organism slots allocated once and reused from
+ * generation to generation
+ *
+ * The slots of a buffer are those of the cells, then nb_extra_slots more (e.g. for the reproducers received from the
+ * other ranks, see MpiExpManager). In the current buffer, the organism of a cell is in the slot of a cell holding it
+ * (see slot): all the clones of an organism hold the same slot. The next generation is built in the other buffer
+ * while the current one is read: a mutant is built in the slot of its cell (see mutant), a clone only records the slot
+ * of its parent (see clone). swap then moves the slot of each parent with clones into the slot of its first clone, an
+ * exchange of pointers instead of a copy, and the buffers exchange their roles.
+ *
+ * No reference is counted: the cells only hold slot indices, and each cell only writes its own slots, so that the
+ * cells can be built by concurrent threads.
+ */
+class Population {
+public:
+    explicit Population(int nb_cells, int nb_extra_slots = 0);
+
+    int size() const { return nb_cells_; }
+
+    /// Organism of a cell in the current generation
+    Organism &operator[](int cell) { return *slots_[current_][holders_[current_][cell]]; }
+
+    const Organism &operator[](int cell) const { return *slots_[current_][holders_[current_][cell]]; }
+
+    /// Slot holding the organism of a cell in the current generation
+    int slot(int cell) const { return holders_[current_][cell]; }
+
+    /// Organism of a slot of the current buffer
+    Organism &in_slot(int slot) { return *slots_[current_][slot]; }
+
+    const Organism &in_slot(int slot) const { return *slots_[current_][slot]; }
+
+    /// Make the organism of a cell in the current generation a copy of organism (see Organism::assign_clone)
+    void assign(int cell, const Organism &organism);
+
+    /// Make every cell of the current generation a clone of organism, held by cell 0
+    void assign_all(const Organism &organism);
+
+    /// Replace the organism of a slot of the current buffer, e.g. an extra slot with a received reproducer
+    void adopt(int slot, std::unique_ptr<Organism> organism) { slots_[current_][slot] = std::move(organism); }
+
+    /// Make the organism of a cell in the next generation a copy of the organism of a slot of the current buffer, to
+    /// be mutated and evaluated (see Organism::assign_clone)
+    Organism &mutant(int cell, int parent_slot);
+
+    /// Make the organism of a cell in the next generation the organism of a slot of the current buffer
+    void clone(int cell, int parent_slot) { parent_slots_[cell] = parent_slot; }
+
+    /// Mutant of a cell in the next generation (see mutant)
+    Organism &next(int cell) { return *slots_[1 - current_][cell]; }
+
+    /// Make the next generation, in which every cell was given a mutant or a clone, the current one
+    void swap();
+
+private:
+    int nb_cells_;
+    int current_ = 0;
+    std::vector<std::unique_ptr<Organism>> slots_[2];
+    // Per cell, the slot holding its organism in each buffer
+    std::vector<int> holders_[2];
+    // Next generation: per cell, the slot of the current buffer it is a clone of, -1 for a mutant
+    std::vector<int> parent_slots_;
+    // Per slot of the current buffer, its first clone in the next generation (-1 outside of swap)
+    std::vector<int> first_clones_;
+};
@@ -0,0 +1,109 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Set of positions of a circular genome, stored as a bitmap (one bit per position)
+ *
+ * Used to find the next site (e.g. terminator) after a given position, or the sites (e.g. Shine-Dalgarno starts) of
+ * a range, with a bit scan instead of a walk along the sequence.
+ */
+class PositionIndex {
+public:
+    /// Empty the index and size it for the positions [0, length[
+    void reset(int length) {
+        length_ = length;
+        words_.assign((length + 63) >> 6, 0);
+    }
+
+    int length() const { return length_; }
+
+    /// The bitmap itself: position pos is bit (pos % 64) of word (pos / 64)
+    uint64_t *words() { return words_.data(); }
+
+    void set(int pos) { words_[pos >> 6] |= uint64_t{1} << (pos & 63); }
+
+    void assign(int pos, bool value) {
+        uint64_t mask = uint64_t{1} << (pos & 63);
+        if (value) words_[pos >> 6] |= mask;
+        else words_[pos >> 6] &= ~mask;
+    }
+
+    bool contains(int pos) const { return (words_[pos >> 6] >> (pos & 63)) & 1; }
+
+    /// First position of the index from pos onward, looping back to 0 after the end; -1 when the index is empty
+    int next(int pos) const {
+        int nb_words = words_.size();
+        int word = pos >> 6;
+        uint64_t bits = words_[word] & (~uint64_t{0} << (pos & 63));
+
+        // Go around once, and check the first word again for the positions before pos
+        for (int i = 0; i <= nb_words; i++) {
+            if (bits)
+                return (word << 6) + __builtin_ctzll(bits);
+            word = word + 1 == nb_words ? 0 : word + 1;
+            bits = words_[word];
+        }
+        return -1;
+    }
+
+    /// Call f(pos) for every position of the index in [pos, pos + count[ (count < length()), in that order, looping
+    /// back to 0 after the end
+    template<typename F>
+    void for_each(int pos, int count, F &&f) const {
+        int end = pos + count;
+        if (end > length_) {
+            for_each_between(pos, length_, f);
+            for_each_between(0, end - length_, f);
+        } else {
+            for_each_between(pos, end, f);
+        }
+    }
+
+private:
+    template<typename F>
+    void for_each_between(int pos_1, int pos_2, F &f) const {
+        if (pos_1 >= pos_2) return;
+
+        int last_word = (pos_2 - 1) >> 6;
+        for (int word = pos_1 >> 6; word <= last_word; word++) {
+            int base = word << 6;
+            uint64_t bits = words_[word];
+            // Keep only the positions of [pos_1, pos_2[
+            if (base < pos_1) bits &= ~uint64_t{0} << (pos_1 - base);
+            if (pos_2 - base < 64) bits &= (uint64_t{1} << (pos_2 - base)) - 1;
+
+            for (; bits; bits &= bits - 1) f(base + __builtin_ctzll(bits));
+        }
+    }
+
+    std::vector<uint64_t> words_;
+    int length_ = 0;
+};
@@ -0,0 +1,172 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "ProgressLog.h"
+
+#include <cstdio>
+#include <utility>
+
+// Delay of the background thread between two drains of the ring
+static constexpr std::chrono::milliseconds POLL_PERIOD(20);
+
+constexpr size_t ProgressLog::CAPACITY;
+constexpr double ProgressLog::PROGRESS_FILE_PERIOD;
+
+ProgressLog::ProgressLog(int verbosity, int generation_step, double min_interval, std::string progress_file_name)
+        : verbosity_(verbosity), generation_step_(generation_step > 0 ? generation_step : 1),
+          min_interval_(min_interval), progress_file_name_(std::move(progress_file_name)) {}
+
+ProgressLog::~ProgressLog() {
+    finish();
+}
+
+void ProgressLog::start(int first_generation, int last_generation) {
+    first_generation_ = first_generation;
+    last_generation_ = last_generation;
+    start_time_ = std::chrono::steady_clock::now();
+    stop_ = false;
+    thread_ = std::thread([this] {
+        while (!stop_.load(std::memory_order_acquire)) {
+            drain();
+            std::this_thread::sleep_for(POLL_PERIOD);
+        }
+        // The records pushed before finish
+        drain();
+    });
+}
+
+void ProgressLog::generation(int generation, double best_fitness, long long nb_evaluations, int replicate) {
+    // Neither printed nor in the progress file
+    if (verbosity_ <= 0 && progress_file_name_.empty())
+        return;
+    if (generation % generation_step_ != 0 && generation != last_generation_)
+        return;
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start_time_;
+    push({GENERATION, generation, best_fitness, nb_evaluations, replicate, seconds.count()}, false);
+}
+
+void ProgressLog::backup(int generation) {
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start_time_;
+    push({BACKUP, generation, 0.0, -1, -1, seconds.count()}, true);
+}
+
+void ProgressLog::finish() {
+    if (!thread_.joinable())
+        return;
+    stop_.store(true, std::memory_order_release);
+    thread_.join();
+    if (nb_dropped_ > 0 && verbosity_ > 0)
+        printf("Progress: %lld generations dropped (the output was too slow)\n", nb_dropped_.load());
+    if (!progress_file_name_.empty())
+        write_progress_file(true);
+    fflush(stdout);
+}
+
+void ProgressLog::push(const Record &record, bool wait_for_room) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    while (head - tail_.load(std::memory_order_acquire) == CAPACITY) {
+        if (!wait_for_room) {
+            nb_dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::this_thread::yield();
+    }
+    records_[head % CAPACITY] = record;
+    head_.store(head + 1, std::memory_order_release);
+}
+
+void ProgressLog::drain() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    if (tail == head)
+        return;
+    for (; tail != head; tail++) {
+        print(records_[tail % CAPACITY]);
+        // The slot can be reused
+        tail_.store(tail + 1, std::memory_order_release);
+    }
+    fflush(stdout);
+
+    if (!progress_file_name_.empty() && has_generation_ &&
+        last_generation_record_.seconds - last_file_write_ >= PROGRESS_FILE_PERIOD) {
+        write_progress_file(false);
+        last_file_write_ = last_generation_record_.seconds;
+    }
+}
+
+void ProgressLog::print(const Record &record) {
+    if (record.kind == BACKUP) {
+        last_backup_ = record.generation;
+        if (verbosity_ > 0)
+            printf("Backup for generation %d done !\n", record.generation);
+        return;
+    }
+
+    last_generation_record_ = record;
+    has_generation_ = true;
+    if (verbosity_ <= 0)
+        return;
+    if (has_printed_ && record.seconds - last_printed_ < min_interval_ && record.generation != last_generation_)
+        return;
+    has_printed_ = true;
+    last_printed_ = record.seconds;
+
+    printf("Generation %d : Best individual fitness %e", record.generation, record.best_fitness);
+    if (record.replicate >= 0)
+        printf(" (replicate %d)", record.replicate);
+    if (verbosity_ >= 2) {
+        double rate = record.seconds > 0 ? (record.generation - first_generation_) / record.seconds : 0.0;
+        printf(", %.1f generations/s", rate);
+        if (record.nb_evaluations >= 0)
+            printf(", %lld evaluations", record.nb_evaluations);
+    }
+    printf("\n");
+}
+
+void ProgressLog::write_progress_file(bool done) {
+    const Record &record = last_generation_record_;
+    int generation = has_generation_ ? record.generation : first_generation_;
+    int nb_done = generation - first_generation_;
+    double rate = has_generation_ && record.seconds > 0 ? nb_done / record.seconds : 0.0;
+    double eta = rate > 0 ? (last_generation_ - generation) / rate : -1.0;
+
+    // Renamed over the progress file once complete, a monitor never reads a partial one
+    std::string temporary_name = progress_file_name_ + ".tmp";
+    FILE *file = fopen(temporary_name.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "Error: cannot write the progress file %s\n", temporary_name.c_str());
+        return;
+    }
+    fprintf(file, "{\"first_generation\": %d, \"last_generation\": %d, \"generation\": %d, ", first_generation_,
+            last_generation_, generation);
+    fprintf(file, "\"best_fitness\": %.17g, \"elapsed_seconds\": %.3f, \"generations_per_second\": %.3f, ",
+            has_generation_ ? record.best_fitness : 0.0, has_generation_ ? record.seconds : 0.0, rate);
+    fprintf(file, "\"eta_seconds\": %.3f, \"last_backup\": %d, \"dropped\": %lld, \"done\": %s}\n", eta, last_backup_,
+            nb_dropped_.load(), done ? "true" : "false");
+    bool written = fclose(file) == 0;
+    if (!written || rename(temporary_name.c_str(), progress_file_name_.c_str()) != 0)
+        fprintf(stderr, "Error: cannot write the progress file %s\n", progress_file_name_.c_str());
+}
@@ -0,0 +1,129 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+/**
+ * Progress messages of a run, printed by a background thread so that the simulation never waits for the output
+ *
+ * The simulation thread pushes a record per generation (and per backup) into a lock-free ring of CAPACITY records,
+ * which the background thread drains every POLL_PERIOD. A generation record is dropped (and counted) if the ring is
+ * full, a backup record waits for room.
+ *
+ * The messages depend on the verbosity: none at 0, the best fitness of the generations and the backups at 1 (the
+ * default, as printed before), with the speed of the run and its number of evaluations at 2. Only the generations that
+ * are multiples of generation_step are printed, at most one every min_interval seconds (0 for no limit), and always
+ * the last one of the run.
+ *
+ * A progress file, for a job monitor, can also be rewritten (to a temporary file renamed over it) at most every
+ * PROGRESS_FILE_PERIOD seconds and at the end, as a JSON object: {"first_generation", "last_generation", "generation",
+ * "best_fitness", "elapsed_seconds", "generations_per_second", "eta_seconds", "last_backup", "dropped", "done"}.
+ */
+class ProgressLog {
+public:
+    static constexpr size_t CAPACITY = 4096;
+    static constexpr double PROGRESS_FILE_PERIOD = 1.0;
+
+    explicit ProgressLog(int verbosity = 1, int generation_step = 1, double min_interval = 0.0,
+                         std::string progress_file_name = "");
+
+    ProgressLog(const ProgressLog &) = delete;
+
+    ProgressLog &operator=(const ProgressLog &) = delete;
+
+    /// Finishes the run (see finish)
+    ~ProgressLog();
+
+    /// Start the background thread, for a run from first_generation to last_generation
+    void start(int first_generation, int last_generation);
+
+    /**
+     * Record a generation: the fitness of its best individual, the number of evaluations of the run so far (-1 if
+     * unknown) and the replicate of the best individual (see Ensemble, -1 for a single simulation)
+     */
+    void generation(int generation, double best_fitness, long long nb_evaluations = -1, int replicate = -1);
+
+    /// Record the end of the backup of a generation
+    void backup(int generation);
+
+    /// Print the records left, stop the background thread and write the last progress file (once)
+    void finish();
+
+private:
+    enum Kind {
+        GENERATION, BACKUP
+    };
+
+    struct Record {
+        Kind kind;
+        int generation;
+        double best_fitness;
+        long long nb_evaluations;
+        int replicate;
+        // Since the start of the run
+        double seconds;
+    };
+
+    void push(const Record &record, bool wait_for_room);
+
+    void drain();
+
+    /// Print a record, or skip it, depending on the verbosity and the rate
+    void print(const Record &record);
+
+    void write_progress_file(bool done);
+
+    const int verbosity_;
+    const int generation_step_;
+    const double min_interval_;
+    const std::string progress_file_name_;
+
+    int first_generation_ = 0;
+    int last_generation_ = 0;
+    std::chrono::steady_clock::time_point start_time_;
+
+    // Single producer (the simulation thread), single consumer (the background thread)
+    Record records_[CAPACITY];
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<bool> stop_{false};
+    std::atomic<long long> nb_dropped_{0};
+    std::thread thread_;
+
+    // Background thread only
+    bool has_printed_ = false;
+    double last_printed_ = 0.0;
+    Record last_generation_record_{};
+    bool has_generation_ = false;
+    int last_backup_ = -1;
+    double last_file_write_ = -PROGRESS_FILE_PERIOD;
+};
@@ -0,0 +1,183 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * Promoters of an Organism: position of the promoter to its error (number of mismatches with the consensus)
+ *
+ * The promoters are stored sorted by position in a flat vector: a copy is a single allocation and memcpy, and the
+ * iteration (in increasing position, like a std::map) is sequential. Insertions and range erasures shift the end of
+ * the vector, which is cheap for the few promoters of a genome.
+ *
+ * The promoters after a rearrangement are moved by shift(), lazily: a shift only records the index of the first
+ * promoter it moves, found by a binary search, and the positions are only updated by flush(). The positions read
+ * through the iterators are those before the pending shifts, which the other functions take into account.
+ */
+class PromoterMap {
+public:
+    using ErrorType = int8_t;
+    using value_type = std::pair<int, ErrorType>;
+    using iterator = std::vector<value_type>::iterator;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
+    iterator begin() { return promoters_.begin(); }
+    iterator end() { return promoters_.end(); }
+    const_iterator begin() const { return promoters_.begin(); }
+    const_iterator end() const { return promoters_.end(); }
+
+    int size() const { return promoters_.size(); }
+
+    void clear() {
+        promoters_.clear();
+        shifts_.clear();
+    }
+
+    /// First promoter at pos or after it
+    iterator lower_bound(int pos) { return promoters_.begin() + index_of(pos); }
+
+    void erase(iterator first, iterator last) {
+        int first_idx = first - promoters_.begin();
+        int last_idx = last - promoters_.begin();
+        if (first_idx == last_idx) return;
+
+        // The shifts of the erased promoters move the next ones
+        for (auto &shift: shifts_)
+            shift.first = shift.first >= last_idx ? shift.first - (last_idx - first_idx) : std::min(shift.first, first_idx);
+        promoters_.erase(first, last);
+    }
+
+    /// Add a promoter at pos, unless there is already one
+    void insert(int pos, ErrorType error) {
+        // Promoters are mostly found in increasing order
+        if (promoters_.empty() || position(size() - 1) < pos) {
+            promoters_.emplace_back(pos - offset(size()), error);
+            return;
+        }
+
+        int idx = index_of(pos);
+        if (position(idx) != pos) {
+            promoters_.emplace(promoters_.begin() + idx, pos - offset(idx), error);
+            moved_from(idx, 1);
+        }
+    }
+
+    /// Add the given promoters, sorted by position, no promoter of the map being between the first and the last ones
+    void insert(const std::vector<value_type> &block) {
+        if (block.empty()) return;
+
+        int idx = index_of(block.front().first);
+        assert(idx == index_of(block.back().first + 1));
+        int idx_offset = offset(idx);
+        auto it = promoters_.insert(promoters_.begin() + idx, block.begin(), block.end());
+        for (auto end = it + block.size(); it != end; ++it)
+            it->first -= idx_offset;
+        moved_from(idx, block.size());
+    }
+
+    /// Append to dest the promoters starting in [pos_1, pos_2[, moved by delta
+    void copy(int pos_1, int pos_2, int delta, std::vector<value_type> &dest) const {
+        for (int idx = index_of(pos_1), last_idx = index_of(pos_2); idx < last_idx; idx++)
+            dest.emplace_back(position(idx) + delta, promoters_[idx].second);
+    }
+
+    /**
+     * Move the promoters at pos or after it by delta. The order of the promoters must not change: when delta < 0,
+     * there must be no promoter in [pos + delta, pos[.
+     *
+     * The shift is pending until flush(): it costs O(log n) whatever the number of promoters that it moves, and each
+     * of the other functions a few more operations per pending shift.
+     */
+    void shift(int pos, int delta) {
+        int first = index_of(pos);
+        if (delta != 0 && first < size())
+            shifts_.push_back({first, delta});
+    }
+
+    /// Apply the pending shifts to the positions, in a single pass
+    void flush() {
+        if (shifts_.empty()) return;
+
+        std::sort(shifts_.begin(), shifts_.end(), [](const Shift &a, const Shift &b) { return a.first < b.first; });
+        int delta = 0;
+        auto shift = shifts_.begin();
+        for (int idx = 0; idx < size(); idx++) {
+            for (; shift != shifts_.end() && shift->first <= idx; ++shift)
+                delta += shift->delta;
+            promoters_[idx].first += delta;
+        }
+        shifts_.clear();
+    }
+
+private:
+    /// The promoters of index first and after are moved by delta
+    struct Shift {
+        int first;
+        int delta;
+    };
+
+    /// Sum of the pending shifts of the promoter of index idx
+    int offset(int idx) const {
+        int delta = 0;
+        for (const auto &shift: shifts_)
+            if (shift.first <= idx) delta += shift.delta;
+        return delta;
+    }
+
+    int position(int idx) const { return promoters_[idx].first + offset(idx); }
+
+    /// Index of the first promoter at pos or after it (the shifts keep the positions sorted)
+    int index_of(int pos) const {
+        if (shifts_.empty()) {
+            return std::lower_bound(promoters_.begin(), promoters_.end(), pos,
+                                    [](const value_type &promoter, int p) { return promoter.first < p; }) -
+                   promoters_.begin();
+        }
+
+        int low = 0, high = size();
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (position(mid) < pos) low = mid + 1;
+            else high = mid;
+        }
+        return low;
+    }
+
+    /// nb promoters were inserted at index idx: the pending shifts of the promoters after them follow them
+    void moved_from(int idx, int nb) {
+        for (auto &shift: shifts_)
+            if (shift.first > idx) shift.first += nb;
+    }
+
+    std::vector<value_type> promoters_;
+    std::vector<Shift> shifts_;
+};
@@ -0,0 +1,109 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Proteins of an Organism, stored as a structure of arrays: protein i is described by the i-th element of each array
+ *
+ * The phenotype computation only reads the contiguous m, w, h, e and flags arrays.
+ */
+class ProteinTable {
+public:
+    int size() const { return protein_start.size(); }
+
+    void clear() {
+        protein_start.clear();
+        protein_end.clear();
+        protein_length.clear();
+        m.clear();
+        w.clear();
+        h.clear();
+        e.clear();
+        is_functional.clear();
+        is_init_.clear();
+    }
+
+    void reserve(int nb) {
+        protein_start.reserve(nb);
+        protein_end.reserve(nb);
+        protein_length.reserve(nb);
+        m.reserve(nb);
+        w.reserve(nb);
+        h.reserve(nb);
+        e.reserve(nb);
+        is_functional.reserve(nb);
+        is_init_.reserve(nb);
+    }
+
+    /// Add a protein, not translated yet
+    void add(int t_protein_start, int t_protein_end, int t_protein_length, double t_e) {
+        protein_start.push_back(t_protein_start);
+        protein_end.push_back(t_protein_end);
+        protein_length.push_back(t_protein_length);
+        m.push_back(0.0);
+        w.push_back(0.0);
+        h.push_back(0.0);
+        e.push_back(t_e);
+        is_functional.push_back(false);
+        is_init_.push_back(true);
+    }
+
+    /// Add a copy of the proteins first to first + nb - 1 of another table
+    void append(const ProteinTable &other, int first, int nb) {
+        append(protein_start, other.protein_start, first, nb);
+        append(protein_end, other.protein_end, first, nb);
+        append(protein_length, other.protein_length, first, nb);
+        append(m, other.m, first, nb);
+        append(w, other.w, first, nb);
+        append(h, other.h, first, nb);
+        append(e, other.e, first, nb);
+        append(is_functional, other.is_functional, first, nb);
+        append(is_init_, other.is_init_, first, nb);
+    }
+
+    std::vector<int> protein_start;
+    std::vector<int> protein_end;
+    std::vector<int> protein_length;
+
+    std::vector<double> m;
+    std::vector<double> w;
+    std::vector<double> h;
+    std::vector<double> e;
+    std::vector<uint8_t> is_functional;
+
+    // Cleared for the duplicates of a protein, once merged into it
+    std::vector<uint8_t> is_init_;
+
+private:
+    template<typename T>
+    static void append(std::vector<T> &to, const std::vector<T> &from, int first, int nb) {
+        to.insert(to.end(), from.begin() + first, from.begin() + first + nb);
+    }
+};
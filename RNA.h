@@ -26,8 +26,6 @@
 
 #pragma once
 
-#include <vector>
-
 /**
  * Class to store a RNA and its related variable
  */
@@ -47,7 +45,15 @@ public:
     int end;
 
     double e;
-    std::vector<int> start_prot;
     int length;
     bool is_coding_;
+
+    // Start positions of its proteins: start_prot[first_start_prot] to start_prot[first_start_prot + nb_start_prot - 1]
+    // of its Organism
+    int first_start_prot = 0;
+    int nb_start_prot = 0;
+
+    // Proteins of this RNA: proteins[first_protein] to proteins[first_protein + nb_proteins - 1] of its Organism
+    int first_protein = 0;
+    int nb_proteins = 0;
 };
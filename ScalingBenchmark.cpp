@@ -0,0 +1,232 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "ScalingBenchmark.h"
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
+#ifdef USE_CUDA
+#include "cuda/cuExpManager.h"
+#endif
+#include "AeTime.h"
+#include "ExpManager.h"
+#include "Timetracer.h"
+
+namespace {
+    /// Whether the bases of a stamp are the evaluated ones
+    bool is_evaluation(time_tracer::Stamp stamp) {
+        return stamp == time_tracer::EVALUATION || stamp == time_tracer::RNA || stamp == time_tracer::START_PROTEIN ||
+               stamp == time_tracer::PROTEIN || stamp == time_tracer::TRANSLATION || stamp == time_tracer::PHENOTYPE;
+    }
+
+    /// Speed of a combination
+    struct Result {
+        int threads;
+        int width;
+        int height;
+        double seconds;
+        long long nb_evaluations;
+        long long nb_evaluated_bases;
+        long long nb_population_bases;
+        time_tracer::Sum phases[time_tracer::NB_STAMPS];
+    };
+}
+
+bool ScalingBenchmark::parse_thread_counts(const char *list, std::vector<int> &thread_counts) {
+    thread_counts.clear();
+    const char *c = list;
+    while (*c != '\0') {
+        char *end;
+        long threads = strtol(c, &end, 10);
+        if (end == c || threads < 1 || threads > INT_MAX || (*end != ',' && *end != '\0')) return false;
+        thread_counts.push_back(threads);
+        c = *end == ',' ? end + 1 : end;
+    }
+    return !thread_counts.empty();
+}
+
+bool ScalingBenchmark::parse_grids(const char *list, std::vector<std::pair<int, int>> &grids) {
+    grids.clear();
+    const char *c = list;
+    while (*c != '\0') {
+        char *end;
+        long width = strtol(c, &end, 10);
+        if (end == c || width < 1 || width > INT_MAX || *end != 'x') return false;
+        c = end + 1;
+        long height = strtol(c, &end, 10);
+        if (end == c || height < 1 || height > INT_MAX || (*end != ',' && *end != '\0')) return false;
+        grids.emplace_back(width, height);
+        c = *end == ',' ? end + 1 : end;
+    }
+    return !grids.empty();
+}
+
+std::vector<int> ScalingBenchmark::default_thread_counts() {
+    int max_threads = 1;
+#ifdef USE_OMP
+    max_threads = omp_get_max_threads();
+#endif
+    std::vector<int> thread_counts;
+    for (int threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+    return thread_counts;
+}
+
+void ScalingBenchmark::reserve_threads() const {
+#ifdef USE_OMP
+    int max_threads = omp_get_max_threads();
+    for (int threads: thread_counts) {
+        if (threads > max_threads) max_threads = threads;
+    }
+    omp_set_num_threads(max_threads);
+#endif
+}
+
+bool ScalingBenchmark::run(const char *report_file_name) const {
+    FILE *report = fopen(report_file_name, "w");
+    if (report == nullptr) {
+        fprintf(stderr, "Error: could not open benchmark report %s\n", report_file_name);
+        return false;
+    }
+    fprintf(report, "Engine,Width,Height,Threads,Generations,Seconds,Generations_per_s,Evaluations_per_s,Cells_per_s,"
+                    "Bases_per_s,Speedup,Efficiency,Phase,Phase_events,Phase_seconds,Phase_share,Phase_bases_per_s\n");
+
+    reserve_threads();
+#ifdef USE_OMP
+    const int default_threads = omp_get_max_threads();
+#endif
+    time_tracer::start_sums();
+
+    for (const auto &grid: grids) {
+        std::vector<Result> results;
+        for (int threads: thread_counts) {
+#ifdef USE_OMP
+            omp_set_num_threads(threads);
+#else
+            if (threads != 1)
+                fprintf(stderr, "Warning: built without OpenMP, running with 1 thread instead of %d\n", threads);
+#endif
+            printf("Benchmark of a %dx%d grid with %d threads\n", grid.first, grid.second, threads);
+
+            AeTime::set_time(0);
+            auto *cpu_exp_manager = new ExpManager(grid.second, grid.first, seed, mutation_rate, genome_size, INT_MAX,
+                                                   selection_scheme, selection_radius);
+            cpu_exp_manager->set_delta_evaluation(delta_evaluation);
+            cpu_exp_manager->set_benchmark_mode(true);
+            time_tracer::reset_sums();
+
+            Result result{};
+            result.threads = threads;
+            result.width = grid.first;
+            result.height = grid.second;
+#ifdef USE_CUDA
+            Abstract_ExpManager *exp_manager = new cuExpManager(cpu_exp_manager);
+            delete cpu_exp_manager;
+            cpu_exp_manager = nullptr;
+#else
+            Abstract_ExpManager *exp_manager = cpu_exp_manager;
+#endif
+
+            auto start = std::chrono::steady_clock::now();
+            exp_manager->run_evolution(nb_gen);
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            for (int stamp = 0; stamp < time_tracer::NB_STAMPS; stamp++)
+                result.phases[stamp] = time_tracer::sum(static_cast<time_tracer::Stamp>(stamp));
+            // The generations only, without the first evaluation
+            if (result.phases[time_tracer::STEP].nb_events > 0)
+                result.seconds = result.phases[time_tracer::STEP].seconds;
+
+            if (cpu_exp_manager != nullptr) {
+                result.nb_evaluations = cpu_exp_manager->nb_evaluations();
+                result.nb_evaluated_bases = cpu_exp_manager->nb_evaluated_bases();
+                result.nb_population_bases = cpu_exp_manager->nb_population_bases();
+            } else {
+                result.nb_evaluations = result.nb_evaluated_bases = result.nb_population_bases = 0;
+            }
+            results.push_back(result);
+
+            delete exp_manager;
+        }
+
+        // Strong scaling, against the fewest threads
+        const Result *reference = &results[0];
+        for (const auto &result: results) {
+            if (result.threads < reference->threads) reference = &result;
+        }
+
+        for (const auto &result: results) {
+            double speedup = reference->seconds / result.seconds;
+            double efficiency = speedup * reference->threads / result.threads;
+            char speed[512];
+            snprintf(speed, sizeof(speed), "%s,%d,%d,%d,%d,%.6f,%.3f,%.1f,%.1f,%.1f,%.3f,%.3f",
+#ifdef USE_CUDA
+                     "gpu",
+#else
+                     "cpu",
+#endif
+                     result.width, result.height, result.threads, nb_gen, result.seconds, nb_gen / result.seconds,
+                     result.nb_evaluations / result.seconds,
+                     (double) result.width * result.height * nb_gen / result.seconds,
+                     result.nb_population_bases / result.seconds, speedup, efficiency);
+
+            bool with_phases = false;
+            for (int stamp = 0; stamp < time_tracer::NB_STAMPS; stamp++) {
+                auto phase = static_cast<time_tracer::Stamp>(stamp);
+                const time_tracer::Sum &sum = result.phases[stamp];
+                if (sum.nb_events == 0 || phase == time_tracer::FIRST_EVALUATION || phase == time_tracer::BACKUP)
+                    continue;
+                long long bases = is_evaluation(phase) ? result.nb_evaluated_bases : result.nb_population_bases;
+                fprintf(report, "%s,%s,%llu,%.6f,%.4f,%.1f\n", speed, time_tracer::name(phase),
+                        (unsigned long long) sum.nb_events, sum.seconds,
+                        sum.seconds / (result.seconds * result.threads), bases / sum.seconds);
+                with_phases = true;
+            }
+            if (!with_phases)
+                fprintf(report, "%s,,,,,\n", speed);
+        }
+        fflush(report);
+    }
+
+#ifdef USE_OMP
+    omp_set_num_threads(default_threads);
+#endif
+
+    if (fclose(report) != 0) {
+        fprintf(stderr, "Error while writing the benchmark report %s\n", report_file_name);
+        return false;
+    }
+    return true;
+}
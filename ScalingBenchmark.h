@@ -0,0 +1,77 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "SelectionPolicy.h"
+
+/**
+ * Scaling benchmark of the whole simulation: runs the same simulation for every combination of a number of threads
+ * and a grid size, without stats nor backups (see ExpManager::set_benchmark_mode), and writes one CSV line per
+ * combination and phase.
+ *
+ * A line gives the speed of the combination (generations, evaluations, cells and bases per second, and the speedup and
+ * efficiency against the fewest threads on the same grid, i.e. the strong scaling; the weak scaling compares the cells
+ * per second of grids growing with the threads), then the number of events of the phase, the time spent in it summed
+ * over the threads, the share of the time of the threads it takes, and the bases it processed per second (the
+ * evaluated bases for the evaluation and its stages, those of the whole population otherwise).
+ *
+ * The GPU engine only reports the speed of each grid size, not the phases.
+ */
+struct ScalingBenchmark {
+    int nb_gen = 100;
+    double mutation_rate = 0.00001;
+    int genome_size = 5000;
+    int seed = 566545665;
+    SelectionScheme selection_scheme = FITNESS_PROPORTIONAL;
+    int selection_radius = 1;
+    bool delta_evaluation = true;
+
+    std::vector<int> thread_counts;
+    // (width, height)
+    std::vector<std::pair<int, int>> grids;
+
+    /// Parse a comma-separated list of numbers of threads, false if it is not one
+    static bool parse_thread_counts(const char *list, std::vector<int> &thread_counts);
+
+    /// Parse a comma-separated list of WIDTHxHEIGHT grid sizes, false if it is not one
+    static bool parse_grids(const char *list, std::vector<std::pair<int, int>> &grids);
+
+    /// 1, 2, 4... up to the number of threads OpenMP uses by default, which is always included
+    static std::vector<int> default_thread_counts();
+
+    /**
+     * Let OpenMP use the largest of the numbers of threads by default, before the tracer is started: it only keeps
+     * the events of as many threads as OpenMP uses when it starts
+     */
+    void reserve_threads() const;
+
+    /// Run the combinations and write the report to report_file_name, false (after printing the cause) on an error
+    bool run(const char *report_file_name) const;
+};
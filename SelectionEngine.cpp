@@ -0,0 +1,153 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "SelectionEngine.h"
+
+namespace {
+    /// a modulo b, in [0, b[ whatever the sign of a
+    inline int wrap(int a, int b) {
+        return (a % b + b) % b;
+    }
+}
+
+/**
+ * @param grid_width : Number of cells along x
+ * @param grid_height : Number of cells along y
+ * @param neighborhood_width : Extent of a neighbourhood along x (the cell itself included)
+ * @param neighborhood_height : Extent of a neighbourhood along y (the cell itself included)
+ */
+SelectionEngine::SelectionEngine(int grid_width, int grid_height, int neighborhood_width, int neighborhood_height)
+        : grid_width_(grid_width), grid_height_(grid_height),
+          neighborhood_width_(neighborhood_width), neighborhood_height_(neighborhood_height),
+          radius_x_((neighborhood_width - 1) / 2), radius_y_((neighborhood_height - 1) / 2),
+          padded_height_(grid_height + neighborhood_height - 1),
+          fitness_((grid_width + neighborhood_width - 1) * padded_height_),
+          sums_(grid_width * grid_height),
+          probs_(grid_width * grid_height * neighborhood_width * neighborhood_height) {
+#ifdef FAST_SELECTION
+    column_sums_.resize((grid_width + neighborhood_width - 1) * grid_height);
+#endif
+}
+
+void SelectionEngine::prepare(const std::shared_ptr<Organism> *population, bool with_probabilities) {
+    // The borders are the wrapped-around cells of the torus
+    gather_columns([population](int cell) { return population[cell]->fitness; }, 0,
+                   grid_width_ + neighborhood_width_ - 1);
+
+    if (with_probabilities)
+        compute_probabilities(0, grid_width_);
+}
+
+void SelectionEngine::prepare(const Population &population, bool with_probabilities) {
+    gather_columns([&population](int cell) { return population[cell].fitness; }, 0,
+                   grid_width_ + neighborhood_width_ - 1);
+
+    if (with_probabilities)
+        compute_probabilities(0, grid_width_);
+}
+
+void SelectionEngine::gather_tile(const Population &population) {
+    gather_columns([&population](int cell) { return population[cell].fitness; }, radius_x_, radius_x_ + grid_width_);
+}
+
+void SelectionEngine::set_borders(const double *left, const double *right) {
+    const int nb_border_columns = neighborhood_width_ - 1 - radius_x_;
+#pragma omp parallel for
+    for (int px = 0; px < radius_x_ + nb_border_columns; px++) {
+        const double *column = px < radius_x_ ? left + px * grid_height_
+                                              : right + (px - radius_x_) * grid_height_;
+        double *fit = fitness_.data() + (px < radius_x_ ? px : px + grid_width_) * padded_height_;
+        for (int py = 0; py < padded_height_; py++) fit[py] = column[wrap(py - radius_y_, grid_height_)];
+    }
+}
+
+template<class Fitness>
+void SelectionEngine::gather_columns(const Fitness &fitness_of, int px_begin, int px_end) {
+#pragma omp parallel for
+    for (int px = px_begin; px < px_end; px++) {
+        const int column = wrap(px - radius_x_, grid_width_) * grid_height_;
+        for (int py = 0; py < padded_height_; py++) {
+            fitness_[px * padded_height_ + py] = fitness_of(column + wrap(py - radius_y_, grid_height_));
+        }
+    }
+}
+
+void SelectionEngine::compute_probabilities(int x_begin, int x_end) {
+    const int nb_neighbors = neighborhood_size();
+
+#ifdef FAST_SELECTION
+    // The padded columns read by the cells of [x_begin, x_end[
+#pragma omp parallel for
+    for (int px = x_begin; px < x_end + neighborhood_width_ - 1; px++) {
+        const double *fit = fitness_.data() + px * padded_height_;
+        double *column_sum = column_sums_.data() + px * grid_height_;
+        for (int y = 0; y < grid_height_; y++) column_sum[y] = 0.0;
+        for (int j = 0; j < neighborhood_height_; j++) {
+#pragma omp simd
+            for (int y = 0; y < grid_height_; y++) column_sum[y] += fit[y + j];
+        }
+    }
+#endif
+
+#pragma omp parallel for
+    for (int x = x_begin; x < x_end; x++) {
+        double *sum = sums_.data() + x * grid_height_;
+        for (int y = 0; y < grid_height_; y++) sum[y] = 0.0;
+
+#ifdef FAST_SELECTION
+        for (int i = 0; i < neighborhood_width_; i++) {
+            const double *column_sum = column_sums_.data() + (x + i) * grid_height_;
+#pragma omp simd
+            for (int y = 0; y < grid_height_; y++) sum[y] += column_sum[y];
+        }
+#else
+        // Same order of additions as a loop over the neighbours of each cell
+        for (int i = 0; i < neighborhood_width_; i++) {
+            for (int j = 0; j < neighborhood_height_; j++) {
+                const double *fit = fitness_.data() + padded_idx(x + i - radius_x_, j - radius_y_);
+#pragma omp simd
+                for (int y = 0; y < grid_height_; y++) sum[y] += fit[y];
+            }
+        }
+#endif
+
+        double *probs = probs_.data() + x * grid_height_ * nb_neighbors;
+        for (int i = 0; i < neighborhood_width_; i++) {
+            for (int j = 0; j < neighborhood_height_; j++) {
+                const double *fit = fitness_.data() + padded_idx(x + i - radius_x_, j - radius_y_);
+                const int k = i * neighborhood_height_ + j;
+#pragma omp simd
+                for (int y = 0; y < grid_height_; y++) probs[y * nb_neighbors + k] = fit[y] / sum[y];
+            }
+        }
+    }
+}
+
+int SelectionEngine::neighbor(int indiv_id, int k) const {
+    int x = indiv_id / grid_height_ + k / neighborhood_height_ - radius_x_;
+    int y = indiv_id % grid_height_ + k % neighborhood_height_ - radius_y_;
+    return wrap(x, grid_width_) * grid_height_ + wrap(y, grid_height_);
+}
@@ -0,0 +1,121 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Organism.h"
+#include "Population.h"
+#include "aevol_constants.h"
+
+/**
+ * Neighbourhoods of the cells on the torus, and their fitness, for the selection of the reproducer of each cell
+ * (see SelectionPolicy.h for the draws themselves)
+ *
+ * A cell is x * grid_height + y, and its neighbourhood is the neighborhood_width x neighborhood_height rectangle
+ * centered on it (wrapping around the edges of the grid). The neighbour k of a cell is at offset
+ * (k / neighborhood_height, k % neighborhood_height) from the corner of that rectangle.
+ *
+ * Once per generation, prepare() gathers the fitness of the population into a contiguous grid padded with the
+ * wrapped-around borders. When asked, it also computes the fitness-proportional selection probabilities of every cell
+ * with loops over the whole grid (vectorized across the cells of a column) instead of a gather through the organisms
+ * for each cell.
+ *
+ * The sum of the fitness of a neighbourhood is computed in the order of the neighbours, so the probabilities are
+ * bit-identical to a cell by cell computation. With FAST_SELECTION, it is computed with a separable stencil (sums
+ * along y, then along x) instead: fewer additions for large neighbourhoods, but not bit-identical.
+ */
+class SelectionEngine {
+public:
+    SelectionEngine(int grid_width, int grid_height, int neighborhood_width = NEIGHBORHOOD_WIDTH,
+                    int neighborhood_height = NEIGHBORHOOD_HEIGHT);
+
+    int neighborhood_size() const { return neighborhood_width_ * neighborhood_height_; }
+
+    /// Gather the fitness of the population, and compute the selection probabilities of every cell if asked
+    void prepare(const std::shared_ptr<Organism> *population, bool with_probabilities);
+
+    void prepare(const Population &population, bool with_probabilities);
+
+    /**
+     * For a tile of a wider torus, split along x between the ranks of a distributed simulation (see MpiExpManager):
+     * the grid is the tile, and the radius_x() columns on each side of it are those of the neighbouring tiles.
+     * gather_tile gathers the fitness of the tile and set_borders that of the neighbouring columns. The probabilities
+     * of the cells whose neighbourhood stays in the tile can be computed before the borders are set.
+     */
+    void gather_tile(const Population &population);
+
+    /// Fitness of the radius_x() columns on the left and on the right of the tile, grid_height per column
+    void set_borders(const double *left, const double *right);
+
+    /// Compute the fitness-proportional selection probabilities of the cells of the columns [x_begin, x_end[
+    void compute_probabilities(int x_begin, int x_end);
+
+    /// Offset along x of the corner of a neighbourhood from its cell
+    int radius_x() const { return radius_x_; }
+
+    /// Fitness of the k-th neighbour of indiv_id
+    double fitness(int indiv_id, int k) const {
+        return fitness_[padded_idx(indiv_id / grid_height_ + k / neighborhood_height_ - radius_x_,
+                                   indiv_id % grid_height_ + k % neighborhood_height_ - radius_y_)];
+    }
+
+    /// The neighborhood_size() fitness-proportional probabilities of the neighbours of indiv_id
+    const double *probabilities(int indiv_id) const { return probs_.data() + indiv_id * neighborhood_size(); }
+
+    /// Cell of the k-th neighbour of indiv_id
+    int neighbor(int indiv_id, int k) const;
+
+private:
+    /// Gather the fitness of the columns [px_begin, px_end[ of the padded grid, wrapping around the grid
+    template<class Fitness>
+    void gather_columns(const Fitness &fitness_of, int px_begin, int px_end);
+
+    /// Index of (x, y) in the padded grid, x in [-radius_x_, grid_width_ + radius_x_[ and likewise for y
+    int padded_idx(int x, int y) const { return (x + radius_x_) * padded_height_ + y + radius_y_; }
+
+    int grid_width_;
+    int grid_height_;
+    int neighborhood_width_;
+    int neighborhood_height_;
+    // Offset of the corner of the neighbourhood from its cell
+    int radius_x_;
+    int radius_y_;
+    int padded_height_;
+
+    // Fitness of the population on the padded grid
+    std::vector<double> fitness_;
+    // Sum of the fitness of the neighbourhood of each cell
+    std::vector<double> sums_;
+    // neighborhood_size() probabilities per cell
+    std::vector<double> probs_;
+#ifdef FAST_SELECTION
+    // Sums along y of the padded grid
+    std::vector<double> column_sums_;
+#endif
+};
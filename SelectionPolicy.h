@@ -0,0 +1,103 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "SelectionEngine.h"
+#include "Threefry.h"
+
+/**
+ * Selection schemes: how the reproducer of a cell is drawn among its (2 * RADIUS + 1)^2 neighbours
+ *
+ * Each policy is a compile-time parameter of the generation step (see ExpManager::run_a_step), so that the draw is
+ * inlined in the loop over the cells. A policy provides:
+ *  - WIDTH, the extent of the (square) neighbourhood,
+ *  - NEEDS_PROBABILITIES, whether SelectionEngine::prepare must compute the fitness-proportional probabilities,
+ *  - draw(engine, indiv_id, rng), the index k of the selected neighbour (see SelectionEngine).
+ */
+enum SelectionScheme : int32_t {
+    FITNESS_PROPORTIONAL = 0, TOURNAMENT = 1, RANK = 2
+};
+
+/// Largest neighbourhood radius the step is instantiated for
+constexpr int MAX_SELECTION_RADIUS = 3;
+
+/// Draw proportional to the fitness (roulette wheel), the scheme of Aevol
+template<int RADIUS>
+struct FitnessProportionalSelection {
+    static constexpr int WIDTH = 2 * RADIUS + 1;
+    static constexpr int SIZE = WIDTH * WIDTH;
+    static constexpr bool NEEDS_PROBABILITIES = true;
+
+    static int draw(const SelectionEngine &engine, int indiv_id, Threefry::Gen &rng) {
+        return rng.roulette_random(engine.probabilities(indiv_id), SIZE);
+    }
+};
+
+/// Binary tournament: two neighbours drawn uniformly, the fitter one wins (the first one on a tie)
+template<int RADIUS>
+struct TournamentSelection {
+    static constexpr int WIDTH = 2 * RADIUS + 1;
+    static constexpr int SIZE = WIDTH * WIDTH;
+    static constexpr bool NEEDS_PROBABILITIES = false;
+
+    static int draw(const SelectionEngine &engine, int indiv_id, Threefry::Gen &rng) {
+        unsigned int contenders[2];
+        rng.fill_random(contenders, 2, SIZE);
+        return engine.fitness(indiv_id, contenders[1]) > engine.fitness(indiv_id, contenders[0]) ? contenders[1]
+                                                                                                 : contenders[0];
+    }
+};
+
+/**
+ * Linear ranking: the neighbours are ranked by increasing fitness (by increasing k on a tie), and the neighbour of
+ * rank r (from 1 to SIZE) is drawn with a probability proportional to r
+ */
+template<int RADIUS>
+struct RankSelection {
+    static constexpr int WIDTH = 2 * RADIUS + 1;
+    static constexpr int SIZE = WIDTH * WIDTH;
+    static constexpr bool NEEDS_PROBABILITIES = false;
+
+    static int draw(const SelectionEngine &engine, int indiv_id, Threefry::Gen &rng) {
+        double fitness[SIZE];
+        int ranked[SIZE];
+        for (int k = 0; k < SIZE; k++) {
+            fitness[k] = engine.fitness(indiv_id, k);
+            ranked[k] = k;
+        }
+        std::stable_sort(ranked, ranked + SIZE, [&fitness](int a, int b) { return fitness[a] < fitness[b]; });
+
+        // Rank r covers [r (r - 1) / 2, r (r + 1) / 2[ of the SIZE (SIZE + 1) / 2 total weight
+        double pick = rng.random() * (SIZE * (SIZE + 1) / 2);
+        int rank = 1;
+        while (rank < SIZE && pick >= rank * (rank + 1) / 2) rank++;
+        return ranked[rank - 1];
+    }
+};
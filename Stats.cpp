@@ -27,13 +27,79 @@
 
 #include "Stats.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+namespace {
+    // "AEVS": start of a binary stats file
+    constexpr int32_t STATS_MAGIC = 0x53564541;
+    constexpr int32_t STATS_VERSION = 1;
+
+    /// Number of counts of a row (amount of DNA, numbers of coding and non coding RNAs, of functional and non
+    /// functional genes, of mutations and of switches)
+    constexpr int NB_COUNTS = 7;
+
+    /// Binary header: magic, version, 1 for the stats of the best organism (0 for the mean), size of a record
+    constexpr long HEADER_SIZE = 4 * sizeof(int32_t);
+
+    /// Binary record: generation, fitness, metabolic error, then the counts (int32 for the best organism, float for
+    /// the mean)
+    constexpr long RECORD_SIZE = sizeof(int32_t) + 2 * sizeof(double) + NB_COUNTS * sizeof(int32_t);
+    static_assert(sizeof(float) == sizeof(int32_t), "The counts of the mean are stored in 4 bytes");
+
+    const char *CSV_HEADER = "Generation,fitness,metabolic_error,amount_of_dna,nb_coding_rnas,nb_non_coding_rnas,"
+                             "nb_functional_genes,nb_non_functional_genes,nb_mut,nb_switch";
+
+    const char *stats_file_name(bool best, Stats::Format format) {
+        if (format == Stats::BINARY)
+            return best ? "stats/stats_simd_best.bin" : "stats/stats_simd_mean.bin";
+        return best ? "stats/stats_simd_best.csv" : "stats/stats_simd_mean.csv";
+    }
+
+    /// Append the CSV line of a binary record
+    void append_csv_row(std::ostream &out, bool best, const char *record) {
+        int32_t generation;
+        double values[2];
+        memcpy(&generation, record, sizeof(generation));
+        memcpy(values, record + sizeof(generation), sizeof(values));
+        const char *counts = record + sizeof(generation) + sizeof(values);
+
+        out << generation << "," << values[0] << "," << values[1];
+        for (int i = 0; i < NB_COUNTS; i++) {
+            if (best) {
+                int32_t count;
+                memcpy(&count, counts + i * sizeof(count), sizeof(count));
+                out << "," << count;
+            } else {
+                float count;
+                memcpy(&count, counts + i * sizeof(count), sizeof(count));
+                out << "," << count;
+            }
+        }
+        out << "\n";
+    }
+
+    void append_header(std::ostream &out, bool best, Stats::Format format) {
+        if (format == Stats::CSV) {
+            out << CSV_HEADER << "\n";
+        } else {
+            const int32_t header[] = {STATS_MAGIC, STATS_VERSION, best, RECORD_SIZE};
+            out.write(reinterpret_cast<const char *>(header), sizeof(header));
+        }
+    }
+}
+
 /**
  * Create the data structure and open the file for the statistics of a simulation
  *
  * @param generation : Create statistics beginning from this generation (or resuming from this generation)
  * @param best_or_not : Statistics for the best organisms or mean of all the organisms
+ * @param format : Format of the stats file
+ * @param prefix : Directory (ending with a '/') of the stats directory, empty for the working directory
  */
-Stats::Stats(int generation, bool best_or_not) {
+Stats::Stats(int generation, bool best_or_not, Format format, const std::string &prefix) : format_(format) {
     is_indiv_ = best_or_not;
     generation_ = generation;
 
@@ -52,107 +118,107 @@ Stats::Stats(int generation, bool best_or_not) {
     nb_mut_ = 0;
     nb_switch_ = 0;
 
+    std::string path = prefix + stats_file_name(is_indiv_, format_);
+    const char *file_name = path.c_str();
     if (generation_ == 0) {
-        if (is_indiv_)
-            statfile_best_.open("stats/stats_simd_best.csv", std::ofstream::trunc);
-        else
-            statfile_mean_.open("stats/stats_simd_mean.csv", std::ofstream::trunc);
-
-        if (is_indiv_) {
-            statfile_best_ << "Generation" << "," << "fitness" << "," << "metabolic_error" << "," <<
-                           "amount_of_dna" << "," << "nb_coding_rnas" << "," << "nb_non_coding_rnas" << "," <<
-                           "nb_functional_genes" << "," << "nb_non_functional_genes" << "," << "nb_mut"
-                           << "," << "nb_switch" << std::endl;
-            statfile_best_.flush();
-        } else {
-            statfile_mean_ << "Generation" << "," << "fitness" << "," << "metabolic_error" << "," <<
-                           "amount_of_dna" << "," << "nb_coding_rnas" << "," << "nb_non_coding_rnas" << "," <<
-                           "nb_functional_genes" << "," << "nb_non_functional_genes" << "," << "nb_mut"
-                           << "," << "nb_switch" << std::endl;
-            statfile_mean_.flush();
-        }
+        statfile_ = fopen(file_name, "wb");
+        append_header(buffer_, is_indiv_, format_);
     } else {
         printf("Resume without rheader\n");
-        std::ifstream tmp_mean;
-        std::ifstream tmp_best;
+        resume(file_name);
+    }
+    if (statfile_ == nullptr)
+        fprintf(stderr, "Error: could not open stats file %s, the stats are not written\n", file_name);
+    flush();
+}
 
-        if (is_indiv_) {
-            tmp_best.open("stats/stats_simd_best.csv", std::ifstream::in);
-            statfile_best_.open("stats/stats_simd_best.csv.tmp", std::ofstream::trunc);
-        } else {
-            tmp_mean.open("stats/stats_simd_mean.csv", std::ifstream::in);
-            statfile_mean_.open("stats/stats_simd_mean.csv.tmp", std::ofstream::trunc);
-        }
+Stats::~Stats() {
+    flush();
+    if (statfile_ != nullptr)
+        fclose(statfile_);
+}
 
-        std::string str;
-        for (int i = 0; i < generation_; i++) {
-            if (is_indiv_) {
-                std::getline(tmp_best, str);
-                statfile_best_ << str << std::endl;
-            } else {
-                std::getline(tmp_mean, str);
-                statfile_mean_ << str << std::endl;
-            }
-        }
+void Stats::resume(const char *file_name) {
+    statfile_ = fopen(file_name, "rb+");
+    if (statfile_ == nullptr) {
+        statfile_ = fopen(file_name, "wb");
+        append_header(buffer_, is_indiv_, format_);
+        return;
+    }
 
-        if (is_indiv_) {
-            statfile_best_.flush();
-            statfile_best_.close();
-        } else {
-            statfile_mean_.flush();
-            statfile_mean_.close();
+    fseek(statfile_, 0, SEEK_END);
+    long size = ftell(statfile_);
+    rewind(statfile_);
+
+    // End of the rows of the generations up to generation_, which are in increasing generations
+    long offset = 0;
+    if (format_ == BINARY) {
+        int32_t header[4] = {};
+        if (fread(header, sizeof(header), 1, statfile_) != 1 || header[0] != STATS_MAGIC ||
+            header[1] != STATS_VERSION || header[2] != is_indiv_ || header[3] != RECORD_SIZE) {
+            fprintf(stderr, "Error: %s is not a binary stats file of this version\n", file_name);
+            exit(EXIT_FAILURE);
         }
-
-        if (is_indiv_) {
-            statfile_best_.open("stats/stats_simd_best.csv", std::ofstream::trunc);
-            tmp_best.close();
-            tmp_best.open("stats/stats_simd_best.csv.tmp", std::ifstream::in);
-            tmp_best.seekg(0, std::ios::beg);
-        } else {
-            statfile_mean_.open("stats/stats_simd_mean.csv", std::ofstream::trunc);
-            tmp_mean.close();
-            tmp_mean.open("stats/stats_simd_mean.csv.tmp", std::ifstream::in);
-            tmp_mean.seekg(0, std::ios::beg);
+        // Binary search of the first record after generation_, among the whole records
+        long first = 0, last = (size - HEADER_SIZE) / RECORD_SIZE;
+        while (first < last) {
+            long middle = (first + last) / 2;
+            int32_t generation = 0;
+            fseek(statfile_, HEADER_SIZE + middle * RECORD_SIZE, SEEK_SET);
+            if (fread(&generation, sizeof(generation), 1, statfile_) != 1 || generation > generation_)
+                last = middle;
+            else
+                first = middle + 1;
         }
-
-        for (int i = 0; i < generation_; i++) {
-            if (is_indiv_) {
-                std::getline(tmp_best, str);
-                statfile_best_ << str << std::endl;
-            } else {
-                std::getline(tmp_mean, str);
-                statfile_mean_ << str << std::endl;
-            }
+        offset = HEADER_SIZE + first * RECORD_SIZE;
+    } else {
+        // The header line, then the lines whose first field (the generation) is at most generation_. A partial last
+        // line is cut.
+        char *line = nullptr;
+        size_t capacity = 0;
+        ssize_t length;
+        for (bool header = true; (length = getline(&line, &capacity, statfile_)) > 0; header = false) {
+            if (line[length - 1] != '\n' || (!header && atol(line) > generation_)) break;
+            offset += length;
         }
-
-        tmp_best.close();
-        tmp_mean.close();
-        is_indiv_
-        ? std::remove("stats/stats_simd_best.csv.tmp")
-        : std::remove("stats/stats_simd_mean.csv.tmp");
+        free(line);
     }
+
+    if (offset < size && ftruncate(fileno(statfile_), offset) != 0)
+        fprintf(stderr, "Error: could not truncate stats file %s\n", file_name);
+    fseek(statfile_, 0, SEEK_END);
 }
 
+Stats::OrganismValues::OrganismValues(const Organism &organism)
+        : fitness(organism.fitness), metabolic_error(organism.metaerror), amount_of_dna(organism.length()),
+          nb_coding_rnas(organism.nb_coding_RNAs), nb_non_coding_rnas(organism.nb_non_coding_RNAs),
+          nb_functional_genes(organism.nb_func_genes), nb_non_functional_genes(organism.nb_non_func_genes),
+          nb_mut(organism.nb_mut_), nb_switch(organism.nb_swi_) {}
+
 /**
  * Compute the statistics for the best organism
  */
 void Stats::compute_best(const std::shared_ptr<Organism> &best) {
+    compute_best(OrganismValues(*best));
+}
+
+void Stats::compute_best(const OrganismValues &best) {
     is_indiv_ = true;
 
-    fitness_ = best->fitness;
-    metabolic_error_ = best->metaerror;
+    fitness_ = best.fitness;
+    metabolic_error_ = best.metabolic_error;
 
-    amount_of_dna_ = best->length();
+    amount_of_dna_ = best.amount_of_dna;
 
-    nb_coding_rnas_ = best->nb_coding_RNAs;
-    nb_non_coding_rnas_ = best->nb_non_coding_RNAs;
+    nb_coding_rnas_ = best.nb_coding_rnas;
+    nb_non_coding_rnas_ = best.nb_non_coding_rnas;
 
-    nb_functional_genes_ = best->nb_func_genes;
-    nb_non_functional_genes_ = best->nb_non_func_genes;
+    nb_functional_genes_ = best.nb_functional_genes;
+    nb_non_functional_genes_ = best.nb_non_functional_genes;
 
 
-    nb_mut_ = best->nb_mut_;
-    nb_switch_ = best->nb_swi_;
+    nb_mut_ = best.nb_mut;
+    nb_switch_ = best.nb_switch;
 
     is_computed_ = true;
 }
@@ -161,52 +227,58 @@ void Stats::compute_best(const std::shared_ptr<Organism> &best) {
  * Compute the statistics of the mean of the whole population
  */
 void Stats::compute_average(const std::shared_ptr<Organism> *population, int population_size) {
-    is_indiv_ = false;
-    pop_size_ = population_size;
+    std::vector<OrganismValues> values(population_size);
+#pragma omp parallel for
+    for (int indiv_id = 0; indiv_id < population_size; indiv_id++)
+        values[indiv_id] = OrganismValues(*population[indiv_id]);
 
-    mean_fitness_ = 0;
-    mean_metabolic_error_ = 0;
-    mean_amount_of_dna_ = 0;
-    mean_nb_coding_rnas_ = 0;
-    mean_nb_non_coding_rnas_ = 0;
-    mean_nb_functional_genes_ = 0;
-    mean_nb_non_functional_genes_ = 0;
+    compute_average(values.data(), population_size);
+}
 
-    mean_nb_mut_ = 0;
-    mean_nb_switch_ = 0;
+/**
+ * The sums are done serially, in the order of the cells, so that the means do not depend on the number of threads
+ */
+void Stats::compute_average(const OrganismValues *population, int population_size) {
+    Sums sums;
+    sums.add(population, population_size);
+    compute_average(sums, population_size);
+}
 
-    for (int indiv_id = 0; indiv_id < pop_size_; indiv_id++) {
-        const auto &organism = population[indiv_id];
-        mean_fitness_ += organism->fitness;
-        mean_metabolic_error_ += organism->metaerror;
+void Stats::Sums::add(const OrganismValues *part, int part_size) {
+    for (int indiv_id = 0; indiv_id < part_size; indiv_id++) {
+        const auto &organism = part[indiv_id];
+        fitness += organism.fitness;
+        metabolic_error += organism.metabolic_error;
 
-        mean_amount_of_dna_ += organism->length();
+        amount_of_dna += organism.amount_of_dna;
 
-        mean_nb_coding_rnas_ += organism->nb_coding_RNAs;
-        mean_nb_non_coding_rnas_ += organism->nb_non_coding_RNAs;
+        nb_coding_rnas += organism.nb_coding_rnas;
+        nb_non_coding_rnas += organism.nb_non_coding_rnas;
 
-        mean_nb_functional_genes_ += organism->nb_func_genes;
-        mean_nb_non_functional_genes_ += organism->nb_non_func_genes;
+        nb_functional_genes += organism.nb_functional_genes;
+        nb_non_functional_genes += organism.nb_non_functional_genes;
 
-        mean_nb_mut_ += organism->nb_mut_;
-        mean_nb_switch_ += organism->nb_swi_;
+        nb_mut += organism.nb_mut;
+        nb_switch += organism.nb_switch;
     }
+}
 
+void Stats::compute_average(const Sums &sums, int population_size) {
+    is_indiv_ = false;
+    pop_size_ = population_size;
 
-    //printf("pop_size : %d \n",pop_size_);
-
-    mean_fitness_ /= pop_size_;
-    mean_metabolic_error_ /= pop_size_;
+    mean_fitness_ = sums.fitness / pop_size_;
+    mean_metabolic_error_ = sums.metabolic_error / pop_size_;
 
-    mean_amount_of_dna_ /= pop_size_;
-    mean_nb_coding_rnas_ /= pop_size_;
-    mean_nb_non_coding_rnas_ /= pop_size_;
+    mean_amount_of_dna_ = sums.amount_of_dna / pop_size_;
+    mean_nb_coding_rnas_ = sums.nb_coding_rnas / pop_size_;
+    mean_nb_non_coding_rnas_ = sums.nb_non_coding_rnas / pop_size_;
 
-    mean_nb_functional_genes_ /= pop_size_;
-    mean_nb_non_functional_genes_ /= pop_size_;
+    mean_nb_functional_genes_ = sums.nb_functional_genes / pop_size_;
+    mean_nb_non_functional_genes_ = sums.nb_non_functional_genes / pop_size_;
 
-    mean_nb_mut_ /= pop_size_;
-    mean_nb_switch_ /= pop_size_;
+    mean_nb_mut_ = sums.nb_mut / pop_size_;
+    mean_nb_switch_ = sums.nb_switch / pop_size_;
 
     is_computed_ = true;
 }
@@ -218,14 +290,8 @@ void Stats::write_best(const std::shared_ptr<Organism> &best) {
     if (is_indiv_ && !is_computed_)
         compute_best(best);
 
-    if (is_indiv_ && is_computed_) {
-        // Write best stats
-        statfile_best_ << generation_ << "," << fitness_ << "," << metabolic_error_ << "," <<
-                       amount_of_dna_ << "," << nb_coding_rnas_ << "," << nb_non_coding_rnas_ << "," <<
-                       nb_functional_genes_ << "," << nb_non_functional_genes_ << "," << nb_mut_
-                       << "," << nb_switch_ << std::endl;
-        statfile_best_.flush();
-    }
+    if (is_indiv_ && is_computed_)
+        write_row();
 }
 
 /**
@@ -235,14 +301,95 @@ void Stats::write_average(const std::shared_ptr<Organism> *population, int popul
     if (!is_indiv_ && !is_computed_)
         compute_average(population, population_size);
 
-    if (!is_indiv_ && is_computed_) {
-        // Write average stats
-        statfile_mean_ << generation_ << "," << mean_fitness_ << "," << mean_metabolic_error_ << "," <<
-                       mean_amount_of_dna_ << "," << mean_nb_coding_rnas_ << "," << mean_nb_non_coding_rnas_ << "," <<
-                       mean_nb_functional_genes_ << "," << mean_nb_non_functional_genes_ << "," << mean_nb_mut_
-                       << "," << mean_nb_switch_ << std::endl;
-        statfile_mean_.flush();
+    if (!is_indiv_ && is_computed_)
+        write_row();
+}
+
+void Stats::write_row() {
+    char record[RECORD_SIZE];
+    int32_t generation = generation_;
+    memcpy(record, &generation, sizeof(generation));
+    char *values = record + sizeof(generation);
+    char *counts = values + 2 * sizeof(double);
+
+    if (is_indiv_) {
+        const double best_values[] = {fitness_, metabolic_error_};
+        const int32_t best_counts[NB_COUNTS] = {amount_of_dna_, nb_coding_rnas_, nb_non_coding_rnas_,
+                                                nb_functional_genes_, nb_non_functional_genes_, nb_mut_,
+                                                nb_switch_};
+        memcpy(values, best_values, sizeof(best_values));
+        memcpy(counts, best_counts, sizeof(best_counts));
+    } else {
+        const double mean_values[] = {mean_fitness_, mean_metabolic_error_};
+        const float mean_counts[NB_COUNTS] = {mean_amount_of_dna_, mean_nb_coding_rnas_, mean_nb_non_coding_rnas_,
+                                              mean_nb_functional_genes_, mean_nb_non_functional_genes_,
+                                              mean_nb_mut_, mean_nb_switch_};
+        memcpy(values, mean_values, sizeof(mean_values));
+        memcpy(counts, mean_counts, sizeof(mean_counts));
+    }
+
+    if (format_ == BINARY)
+        buffer_.write(record, RECORD_SIZE);
+    else
+        append_csv_row(buffer_, is_indiv_, record);
+
+    if (++nb_buffered_rows_ >= FLUSH_STEP)
+        flush();
+}
+
+void Stats::flush() {
+    const std::string rows = buffer_.str();
+    buffer_.str("");
+    nb_buffered_rows_ = 0;
+
+    if (statfile_ == nullptr || rows.empty()) return;
+    if (fwrite(rows.data(), 1, rows.size(), statfile_) != rows.size() || fflush(statfile_) != 0)
+        fprintf(stderr, "Error while writing a stats file\n");
+}
+
+bool Stats::to_csv(const char *binary_file_name, const char *csv_file_name) {
+    FILE *binary_file = fopen(binary_file_name, "rb");
+    if (binary_file == nullptr) {
+        fprintf(stderr, "Error: could not open stats file %s\n", binary_file_name);
+        return false;
+    }
+
+    int32_t header[4] = {};
+    if (fread(header, sizeof(header), 1, binary_file) != 1 || header[0] != STATS_MAGIC ||
+        header[1] != STATS_VERSION || header[3] != RECORD_SIZE) {
+        fprintf(stderr, "Error: %s is not a binary stats file of this version\n", binary_file_name);
+        fclose(binary_file);
+        return false;
+    }
+    const bool best = header[2];
+
+    FILE *csv_file = fopen(csv_file_name, "wb");
+    if (csv_file == nullptr) {
+        fprintf(stderr, "Error: could not open %s\n", csv_file_name);
+        fclose(binary_file);
+        return false;
+    }
+
+    std::ostringstream rows;
+    append_header(rows, best, CSV);
+    bool success = true;
+    char record[RECORD_SIZE];
+    for (long nb = 1; fread(record, RECORD_SIZE, 1, binary_file) == 1; nb++) {
+        append_csv_row(rows, best, record);
+        if (nb % FLUSH_STEP == 0) {
+            const std::string text = rows.str();
+            success = success && fwrite(text.data(), 1, text.size(), csv_file) == text.size();
+            rows.str("");
+        }
     }
+    const std::string text = rows.str();
+    success = success && fwrite(text.data(), 1, text.size(), csv_file) == text.size();
+
+    fclose(binary_file);
+    success = (fclose(csv_file) == 0) && success;
+    if (!success)
+        fprintf(stderr, "Error while writing %s\n", csv_file_name);
+    return success;
 }
 
 /**
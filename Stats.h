@@ -27,39 +27,112 @@
 #pragma once
 
 #include <cstdint>
-#include <fstream>
+#include <cstdio>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include "Organism.h"
 
 /**
  * Class to manage and generate the Stats (and the related file) of a simulation
+ *
+ * The rows are buffered and written every FLUSH_STEP generations (and by flush()), in one of two formats:
+ *  - CSV, stats/stats_simd_{best,mean}.csv, a header line then a line per generation,
+ *  - BINARY, stats/stats_simd_{best,mean}.bin, a header then a fixed size record per generation (see write_row), which
+ *    to_csv converts to the CSV file.
+ * When resuming from generation g, the rows of the generations after g are cut from the file, which is truncated in
+ * place.
  */
 class Stats {
 public:
-    Stats(int generation, bool best_or_not);
-
-    ~Stats() {
-        if (is_indiv_) {
-            statfile_best_.flush();
-            statfile_best_.close();
-        } else {
-            statfile_mean_.flush();
-            statfile_mean_.close();
-        }
-    }
+    enum Format {
+        CSV, BINARY
+    };
+
+    /// Number of generations whose rows are buffered before being written
+    static constexpr int FLUSH_STEP = 256;
+
+    Stats(int generation, bool best_or_not, Format format = CSV, const std::string &prefix = "");
+
+    ~Stats();
+
+    Stats(const Stats &) = delete;
+
+    Stats &operator=(const Stats &) = delete;
+
+    /// Values of an organism used by the stats, which can be gathered for the whole population in a parallel pass
+    struct OrganismValues {
+        OrganismValues() = default;
+
+        explicit OrganismValues(const Organism &organism);
+
+        double fitness = 0;
+        double metabolic_error = 0;
+        int amount_of_dna = 0;
+        int nb_coding_rnas = 0;
+        int nb_non_coding_rnas = 0;
+        int nb_functional_genes = 0;
+        int nb_non_functional_genes = 0;
+        int nb_mut = 0;
+        int nb_switch = 0;
+    };
+
+    /**
+     * Running sums of the values of a population, in the types of the means. A population can be summed in
+     * consecutive parts, in order (e.g. by the ranks of a distributed simulation, see MpiExpManager): the means are
+     * then those of compute_average on the whole population.
+     */
+    struct Sums {
+        double fitness = 0;
+        double metabolic_error = 0;
+        float amount_of_dna = 0;
+        float nb_coding_rnas = 0;
+        float nb_non_coding_rnas = 0;
+        float nb_functional_genes = 0;
+        float nb_non_functional_genes = 0;
+        float nb_mut = 0;
+        float nb_switch = 0;
+
+        /// Add the values of the next part of the population, in the order of the cells
+        void add(const OrganismValues *part, int part_size);
+    };
 
     void compute_best(const std::shared_ptr<Organism> &best);
 
+    void compute_best(const OrganismValues &best);
+
     void compute_average(const std::shared_ptr<Organism> *population, int population_size);
 
+    void compute_average(const OrganismValues *population, int population_size);
+
+    /// Means of a population of population_size organisms whose values sum to sums
+    void compute_average(const Sums &sums, int population_size);
+
     void write_best(const std::shared_ptr<Organism> &best);
 
     void write_average(const std::shared_ptr<Organism> *population, int population_size);
 
     void reinit(int generation);
 
+    /// Write the buffered rows to the file
+    void flush();
+
+    /**
+     * Convert a BINARY stats file to the CSV file the CSV format would have written
+     *
+     * @return false, after printing the cause, if binary_file_name cannot be read or csv_file_name written
+     */
+    static bool to_csv(const char *binary_file_name, const char *csv_file_name);
+
 protected:
+    /// Buffer the row of the current generation (the CSV line, or the binary record)
+    void write_row();
+
+    /// Open the file and cut the rows after that of generation_ (create the file if it does not exist)
+    void resume(const char *file_name);
+
     int generation_;
 
     bool is_indiv_;
@@ -92,6 +165,8 @@ protected:
 
     // Stats
 
-    std::ofstream statfile_best_;
-    std::ofstream statfile_mean_;
+    Format format_;
+    FILE *statfile_ = nullptr;
+    std::ostringstream buffer_;
+    int nb_buffered_rows_ = 0;
 };
@@ -1,7 +1,86 @@
 #include "Threefry.h"
 
+#include <algorithm>
 #include <cmath>
 
+#if defined(__GNUC__) && defined(__x86_64__)
+// The AVX2 and AVX-512 Threefry kernels are compiled for their own target and picked at runtime
+#define THREEFRY_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace {
+    typedef Threefry::crt_value_type word_t;
+
+    // Threefry2x64-20, as in Random123/threefry.h: rotation of each round (modulo 8), and a key injection every
+    // 4 rounds
+    constexpr int NB_ROUNDS = 20;
+    constexpr int ROTATIONS[8] = {16, 42, 12, 31, 16, 32, 24, 21};
+    constexpr word_t KS_PARITY = 0x1BD11BDAA9FC1A22;
+
+    /// Uniform in [0, 1[ from 48 bits of a raw output, as Gen::random()
+    inline double to_uniform(word_t raw) {
+        return (raw & ((1llu << 48) - 1)) / double(1llu << 48);
+    }
+
+#ifdef THREEFRY_X86_SIMD
+    /// Cipher the 4 counters {cell, ctr + k} (k in [0, 4[), out gets the first lane of their outputs
+    __attribute__((target("avx2")))
+    void threefry_avx2(word_t cell, word_t ctr, const word_t *ks, word_t *out) {
+        __m256i x0 = _mm256_set1_epi64x(cell + ks[0]);
+        __m256i x1 = _mm256_add_epi64(_mm256_set1_epi64x(ctr + ks[1]), _mm256_set_epi64x(3, 2, 1, 0));
+
+        for (int r = 0; r < NB_ROUNDS; r++) {
+            int rot = ROTATIONS[r % 8];
+            x0 = _mm256_add_epi64(x0, x1);
+            x1 = _mm256_or_si256(_mm256_sll_epi64(x1, _mm_cvtsi32_si128(rot)),
+                                 _mm256_srl_epi64(x1, _mm_cvtsi32_si128(64 - rot)));
+            x1 = _mm256_xor_si256(x1, x0);
+            if (r % 4 == 3) {
+                int i = (r + 1) / 4;
+                x0 = _mm256_add_epi64(x0, _mm256_set1_epi64x(ks[i % 3]));
+                x1 = _mm256_add_epi64(x1, _mm256_set1_epi64x(ks[(i + 1) % 3] + i));
+            }
+        }
+        _mm256_storeu_si256((__m256i *) out, x0);
+    }
+
+    /// Cipher the 8 counters {cell, ctr + k} (k in [0, 8[), out gets the first lane of their outputs
+    __attribute__((target("avx512f")))
+    void threefry_avx512(word_t cell, word_t ctr, const word_t *ks, word_t *out) {
+        __m512i x0 = _mm512_set1_epi64(cell + ks[0]);
+        __m512i x1 = _mm512_add_epi64(_mm512_set1_epi64(ctr + ks[1]), _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0));
+
+        for (int r = 0; r < NB_ROUNDS; r++) {
+            x0 = _mm512_add_epi64(x0, x1);
+            // The masked form, all lanes set, as _mm512_rolv_epi64 merges into an undefined vector that GCC warns of
+            x1 = _mm512_mask_rolv_epi64(x1, 0xFF, x1, _mm512_set1_epi64(ROTATIONS[r % 8]));
+            x1 = _mm512_xor_si512(x1, x0);
+            if (r % 4 == 3) {
+                int i = (r + 1) / 4;
+                x0 = _mm512_add_epi64(x0, _mm512_set1_epi64(ks[i % 3]));
+                x1 = _mm512_add_epi64(x1, _mm512_set1_epi64(ks[(i + 1) % 3] + i));
+            }
+        }
+        _mm512_storeu_si512(out, x0);
+    }
+
+    enum SimdLevel {
+        SCALAR, AVX2, AVX512
+    };
+
+    SimdLevel cpu_simd_level() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return AVX512;
+        if (__builtin_cpu_supports("avx2")) return AVX2;
+        return SCALAR;
+    }
+#endif
+
+    /// Number of values drawn by each batch of the fill functions
+    constexpr int BATCH_SIZE = 64;
+}
+
 void Threefry::save(gzFile backup_file) const {
   Threefry123::key_type::value_type seed = seed_[1];
   gzwrite(backup_file, &seed, sizeof(seed));
@@ -16,13 +95,60 @@ Threefry::Threefry(int X, int Y, gzFile backup_file)
   seed_[0] = 0;
   seed_[1] = seed;
 
-  crt_value_type tmp_counters[counters_.size()];
-  gzread(backup_file, tmp_counters, counters_.size() * sizeof(tmp_counters[0]));
+  // Read in place: a stack copy of the counters overflows with large grids
+  gzread(backup_file, counters_.data(), counters_.size() * sizeof(counters_[0]));
+}
+
+void Threefry::Gen::peek_raw(int n, crt_value_type *out) const {
+#ifdef THREEFRY_X86_SIMD
+  static const SimdLevel simd_level = cpu_simd_level();
+#endif
+
+  int i = 0;
+#ifdef THREEFRY_X86_SIMD
+  if (simd_level >= AVX2) {
+    const Threefry123::key_type &key = parent_->seed_;
+    word_t ks[3] = {key[0], key[1], KS_PARITY ^ key[0] ^ key[1]};
+
+    if (simd_level >= AVX512)
+      for (; i + 8 <= n; i += 8)
+        threefry_avx512(state_[0], state_[1] + i + 1, ks, out + i);
+    for (; i + 4 <= n; i += 4)
+      threefry_avx2(state_[0], state_[1] + i + 1, ks, out + i);
+  }
+#endif
+
+  Threefry123 gen;
+  Threefry123::ctr_type ctr = state_;
+  for (; i < n; i++) {
+    ctr[1] = state_[1] + i + 1;
+    Threefry123::ctr_type raw = gen(ctr, parent_->seed_);
+    out[i] = raw[0];
+  }
+}
 
-  counters_ = std::vector<crt_value_type>(tmp_counters, tmp_counters + counters_.size());
+void Threefry::Gen::fill_random(double *out, int n) {
+  word_t raw[BATCH_SIZE];
+  for (int i = 0; i < n; i += BATCH_SIZE) {
+    int nb = std::min(BATCH_SIZE, n - i);
+    peek_raw(nb, raw);
+    skip(nb);
+    for (int k = 0; k < nb; k++)
+      out[i + k] = to_uniform(raw[k]);
+  }
 }
 
-int32_t Threefry::Gen::roulette_random(double* probs, int32_t nb_elts, bool verbose )
+void Threefry::Gen::fill_random(unsigned int *out, int n, unsigned int max) {
+  double uniforms[BATCH_SIZE];
+  for (int i = 0; i < n; i += BATCH_SIZE) {
+    int nb = std::min(BATCH_SIZE, n - i);
+    fill_random(uniforms, nb);
+    for (int k = 0; k < nb; k++)
+      out[i + k] = uniforms[k] * max;
+  }
+}
+
+int32_t Threefry::Gen::roulette_random(const double* probs, int32_t nb_elts, bool verbose )
 {
     //cloned_probs.resize(nb_elts);
     //for (int i = 0; i < nb_elts; i++) cloned_probs[i] = probs[i];
@@ -101,10 +227,13 @@ int32_t Threefry::Gen::binomial_random(int32_t nb_drawings, double prob)
   // Use the direct method while NbTrials is not too large.
   // This can require up to 25 calls to the uniform random.
   {
+    double uniforms[25];
+    fill_random(uniforms, nb_drawings);
+
     nb_success = 0;
-    for (int32_t j = 1 ; j <= nb_drawings ; j++)
+    for (int32_t j = 0 ; j < nb_drawings ; j++)
     {
-      if (random() < p) nb_success++;
+      nb_success += uniforms[j] < p;
     }
   }
   else if (mean < 1.0)
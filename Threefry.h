@@ -25,6 +25,7 @@ public:
     Threefry(int X, int Y, gzFile backup_file);
 
     std::vector<crt_value_type> &counters() { return counters_; }
+    const std::vector<crt_value_type> &counters() const { return counters_; }
     int get_seed() const { return seed_[1]; }
 
     class Gen {
@@ -32,6 +33,7 @@ public:
         Threefry123 gen_;
 
         Threefry *parent_;
+        bool detached_ = false;
 
         Gen(Threefry *parent, size_t idx, Phase phase)
                 : parent_(parent) {
@@ -42,6 +44,13 @@ public:
         Gen(Threefry *parent, int x, int y, Phase phase)
                 : Gen(parent, y * parent_->X_ + x, phase) {}
 
+        // Detached from the counter of its slot (see Threefry::gen_ahead)
+        Gen(Threefry *parent, size_t idx, Phase phase, crt_value_type ahead)
+                : Gen(parent, idx, phase) {
+            state_[1] += ahead;
+            detached_ = true;
+        }
+
         friend class Threefry;
 
     public:
@@ -54,17 +63,21 @@ public:
             parent_ = other.parent_;
             other.parent_ = nullptr;
             state_ = other.state_;
+            detached_ = other.detached_;
         }
 
         Gen &operator=(Gen &&other) {
             parent_ = other.parent_;
             other.parent_ = nullptr;
             state_ = other.state_;
+            detached_ = other.detached_;
             return *this;
         }
 
+        // Each (cell, phase) pair owns its own counter slot, so generators of different cells can be used and
+        // destroyed concurrently: the writeback never touches a slot shared with another thread.
         ~Gen() {
-            if (parent_)
+            if (parent_ && !detached_)
                 parent_->counters_[state_[0]] = state_[1];
         }
 
@@ -81,9 +94,30 @@ public:
             return random() * max;
         }
 
-        int32_t roulette_random(double *probs, int32_t nb_elts, bool verbose = false);
+        /**
+         * Batch draws: out[i] is the value the i-th of n successive random() (resp. random(max)) calls would return,
+         * and the same n counters are consumed.
+         *
+         * The counters are ciphered several at a time (8 with AVX-512, 4 with AVX2) when the CPU supports it.
+         *
+         * Like random(), a draw takes the first output lane of one counter, the second lane being dropped: taking
+         * both would halve the counters ciphered, but would change the values of every draw of more than one value
+         * (e.g. the mutation positions), and the trajectories of the simulations with them, such as the one of
+         * simulation-test.
+         */
+        void fill_random(double *out, int n);
+
+        void fill_random(unsigned int *out, int n, unsigned int max);
+
+        int32_t roulette_random(const double *probs, int32_t nb_elts, bool verbose = false);
 
         int32_t binomial_random(int32_t nb, double prob); // Binomial drawing of parameters (nb, prob)
+
+    private:
+        /// Raw outputs (first lane) of the next n counters without consuming them
+        void peek_raw(int n, crt_value_type *out) const;
+
+        void skip(int n) { state_[1] += n; }
     };
 
     Gen gen(unsigned int x, unsigned int y, Phase phase) {
@@ -94,6 +128,18 @@ public:
         return std::move(Gen(this, idx, phase));
     }
 
+    /**
+     * Generator of the stream of a cell and phase starting `ahead` counters after the current one, which leaves the
+     * counter of the stream unchanged: several of them can draw at once (e.g. speculatively), then advance() moves
+     * the stream past the draws kept.
+     */
+    Gen gen_ahead(size_t idx, Phase phase, crt_value_type ahead) {
+        return std::move(Gen(this, idx, phase, ahead));
+    }
+
+    /// Move the counter of the stream of a cell and phase n counters ahead
+    void advance(size_t idx, Phase phase, crt_value_type n) { counters_[idx + N_ * phase] += n; }
+
     void save(gzFile backup_file) const;
 
     class Device;
@@ -0,0 +1,437 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "Timetracer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRACER_TSC
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+#ifdef __linux__
+#define TRACER_PERF
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace time_tracer {
+    namespace detail {
+        bool enabled = false;
+    }
+
+    namespace {
+        const char *STAMP_NAMES[NB_STAMPS] = {"FirstEvaluation", "Step", "FitnessGrid", "Selection", "Mutation",
+                                              "Evaluation", "RNA", "StartProtein", "Protein", "Translation",
+                                              "Phenotype", "Stats", "Backup", "HaloExchange"};
+
+        const char *COUNTER_NAMES[NB_COUNTERS] = {"cpu_time_ns", "cycles", "instructions", "llc_misses",
+                                                  "branch_misses"};
+
+        struct Event {
+            uint64_t start;
+            uint64_t end;
+            int32_t stamp;
+            int32_t indiv_id;
+        };
+
+        /// Sums of the counters of the events of a stamp
+        struct Totals {
+            uint64_t nb_events = 0;
+            uint64_t counters[NB_COUNTERS] = {};
+        };
+
+        /**
+         * Data of a thread: its ring of events (event i is at i % capacity, the events before flushed are written),
+         * its perf group (the file descriptor of its leader, the CPU time), the sums of its counters per stamp, and
+         * the number and duration of its events per stamp
+         */
+        struct alignas(64) ThreadData {
+            std::vector<Event> events;
+            uint64_t head = 0;
+            uint64_t flushed = 0;
+
+            int perf_fd = -1;
+            bool perf_opened = false;
+            Totals totals[NB_STAMPS];
+
+            uint64_t sum_events[NB_STAMPS] = {};
+            uint64_t sum_ticks[NB_STAMPS] = {};
+        };
+
+        std::vector<ThreadData> threads;
+        // Threads get their data at their first stamp
+        std::atomic<int> nb_threads{0};
+        thread_local int thread_id = -1;
+
+        bool tracing = false;
+        FILE *trace_file = nullptr;
+        uint64_t capacity = 0;
+        uint64_t dropped = 0;
+        bool first_event = true;
+
+        bool counting = false;
+        FILE *counters_file = nullptr;
+        // Which counters are available, and their index in the values of the perf group
+        bool counter_available[NB_COUNTERS] = {};
+        int counter_index[NB_COUNTERS] = {};
+
+        bool summing = false;
+
+        bool calibrated = false;
+        bool use_tsc = false;
+        uint64_t origin = 0;
+        double ns_per_tick = 1.0;
+
+        uint64_t steady_ns() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        uint64_t now() {
+#ifdef TRACER_TSC
+            if (use_tsc) return __rdtsc();
+#endif
+            return steady_ns();
+        }
+
+#ifdef TRACER_TSC
+        bool invariant_tsc() {
+            unsigned int eax, ebx, ecx, edx;
+            if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) return false;
+            __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+            return edx & (1u << 8);
+        }
+#endif
+
+        /// Choose the clock, and measure the length of a TSC tick
+        void calibrate() {
+            use_tsc = false;
+            ns_per_tick = 1.0;
+#ifdef TRACER_TSC
+            if (invariant_tsc()) {
+                uint64_t ns_0 = steady_ns();
+                uint64_t tsc_0 = __rdtsc();
+                uint64_t ns_1;
+                do ns_1 = steady_ns(); while (ns_1 - ns_0 < 5000000);
+                uint64_t tsc_1 = __rdtsc();
+                if (tsc_1 > tsc_0) {
+                    use_tsc = true;
+                    ns_per_tick = double(ns_1 - ns_0) / double(tsc_1 - tsc_0);
+                }
+            }
+#endif
+            origin = now();
+            calibrated = true;
+        }
+
+        /// Allocate the data of the threads, once
+        void allocate_threads() {
+            if (!threads.empty()) return;
+            int nb = 1;
+#ifdef USE_OMP
+            nb = omp_get_max_threads();
+#endif
+            threads = std::vector<ThreadData>(nb);
+        }
+
+        /// Data of the calling thread, nullptr if there are more threads than data
+        ThreadData *thread_data() {
+            if (thread_id < 0) thread_id = nb_threads++;
+            return thread_id < (int) threads.size() ? &threads[thread_id] : nullptr;
+        }
+
+#ifdef TRACER_PERF
+        int perf_event_open(uint32_t type, uint64_t config, int group_fd) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+        }
+
+        const uint32_t COUNTER_TYPES[NB_COUNTERS] = {PERF_TYPE_SOFTWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                     PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+        const uint64_t COUNTER_CONFIGS[NB_COUNTERS] = {PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_HW_CPU_CYCLES,
+                                                       PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+                                                       PERF_COUNT_HW_BRANCH_MISSES};
+
+        /**
+         * Open the perf group of the calling thread: the CPU time leads it (it is always there), the hardware
+         * counters join it when available. The first group opened decides which counters are available.
+         */
+        void open_perf_group(ThreadData &data, bool first) {
+            data.perf_opened = true;
+            data.perf_fd = perf_event_open(COUNTER_TYPES[0], COUNTER_CONFIGS[0], -1);
+            if (data.perf_fd == -1) return;
+            if (first) counter_available[0] = true;
+
+            int nb = 1;
+            for (int counter = 1; counter < NB_COUNTERS; counter++) {
+                if (!first && !counter_available[counter]) continue;
+                int fd = perf_event_open(COUNTER_TYPES[counter], COUNTER_CONFIGS[counter], data.perf_fd);
+                if (first) {
+                    counter_available[counter] = fd != -1;
+                    counter_index[counter] = nb;
+                }
+                if (fd != -1) nb++;
+                // The group is read, and closed, through its leader
+            }
+        }
+#endif
+
+        /// Read the counters of the calling thread in counters (zeros if its group could not be opened)
+        void read_counters(ThreadData &data, uint64_t *counters) {
+            memset(counters, 0, NB_COUNTERS * sizeof(counters[0]));
+#ifdef TRACER_PERF
+            if (!data.perf_opened) open_perf_group(data, false);
+            if (data.perf_fd == -1) return;
+
+            // nr, then the values in the order the counters were opened
+            uint64_t values[1 + NB_COUNTERS];
+            if (read(data.perf_fd, values, sizeof(values)) < (ssize_t) (2 * sizeof(uint64_t))) return;
+            for (int counter = 0; counter < NB_COUNTERS; counter++) {
+                if (counter_available[counter] && counter_index[counter] < (int) values[0])
+                    counters[counter] = values[1 + counter_index[counter]];
+            }
+#endif
+        }
+
+        void write_counters(int generation) {
+            for (int stamp = 0; stamp < NB_STAMPS; stamp++) {
+                Totals sum;
+                for (auto &data: threads) {
+                    sum.nb_events += data.totals[stamp].nb_events;
+                    for (int counter = 0; counter < NB_COUNTERS; counter++)
+                        sum.counters[counter] += data.totals[stamp].counters[counter];
+                    data.totals[stamp] = Totals();
+                }
+                if (sum.nb_events == 0) continue;
+
+                fprintf(counters_file, "%d,%s,%llu", generation, STAMP_NAMES[stamp],
+                        (unsigned long long) sum.nb_events);
+                for (int counter = 0; counter < NB_COUNTERS; counter++) {
+                    if (counter_available[counter])
+                        fprintf(counters_file, ",%llu", (unsigned long long) sum.counters[counter]);
+                    else
+                        fprintf(counters_file, ",");
+                }
+                fprintf(counters_file, "\n");
+            }
+        }
+
+        void write_events(int generation) {
+            for (size_t tid = 0; tid < threads.size(); tid++) {
+                ThreadData &data = threads[tid];
+                if (data.head - data.flushed > capacity) {
+                    dropped += data.head - data.flushed - capacity;
+                    data.flushed = data.head - capacity;
+                }
+                for (; data.flushed < data.head; data.flushed++) {
+                    const Event &event = data.events[data.flushed % capacity];
+                    // In microseconds since the start of the trace
+                    double ts = double(event.start - origin) * ns_per_tick / 1000.0;
+                    double duration = double(event.end - event.start) * ns_per_tick / 1000.0;
+                    fprintf(trace_file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%.3f,"
+                                        "\"dur\":%.3f,\"args\":{\"generation\":%d,\"indiv\":%d}}",
+                            first_event ? "" : ",", STAMP_NAMES[event.stamp], tid, ts, duration, generation,
+                            event.indiv_id);
+                    first_event = false;
+                }
+            }
+        }
+    }
+
+    bool start(const char *trace_file_name, int nb_events) {
+        trace_file = fopen(trace_file_name, "w");
+        if (trace_file == nullptr) {
+            fprintf(stderr, "Error: could not open trace file %s\n", trace_file_name);
+            return false;
+        }
+        fprintf(trace_file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+        first_event = true;
+
+        allocate_threads();
+        capacity = nb_events > 0 ? nb_events : DEFAULT_CAPACITY;
+        for (auto &data: threads) {
+            data.events.resize(capacity);
+            data.head = data.flushed = 0;
+        }
+        dropped = 0;
+
+        calibrate();
+        tracing = true;
+        detail::enabled = true;
+        return true;
+    }
+
+    bool start_counters(const char *counters_file_name) {
+#ifdef TRACER_PERF
+        allocate_threads();
+        ThreadData *data = thread_data();
+        if (data == nullptr || (open_perf_group(*data, true), data->perf_fd == -1)) {
+            fprintf(stderr, "Error: the performance counters are not available (perf_event_open: %s)\n",
+                    strerror(errno));
+            return false;
+        }
+
+        counters_file = fopen(counters_file_name, "w");
+        if (counters_file == nullptr) {
+            fprintf(stderr, "Error: could not open counters file %s\n", counters_file_name);
+            return false;
+        }
+        fprintf(counters_file, "Generation,Stamp,Events");
+        for (int counter = 0; counter < NB_COUNTERS; counter++)
+            fprintf(counters_file, ",%s", COUNTER_NAMES[counter]);
+        fprintf(counters_file, "\n");
+
+        for (int counter = 1; counter < NB_COUNTERS; counter++) {
+            if (!counter_available[counter])
+                fprintf(stderr, "Warning: the %s counter is not available\n", COUNTER_NAMES[counter]);
+        }
+
+        counting = true;
+        detail::enabled = true;
+        return true;
+#else
+        fprintf(stderr, "Error: the performance counters are only available on Linux\n");
+        return false;
+#endif
+    }
+
+    void start_sums() {
+        allocate_threads();
+        reset_sums();
+        if (!calibrated) calibrate();
+        summing = true;
+        detail::enabled = true;
+    }
+
+    Sum sum(Stamp stamp) {
+        Sum sum{0, 0.0};
+        uint64_t ticks = 0;
+        for (auto &data: threads) {
+            sum.nb_events += data.sum_events[stamp];
+            ticks += data.sum_ticks[stamp];
+        }
+        sum.seconds = double(ticks) * ns_per_tick * 1e-9;
+        return sum;
+    }
+
+    void reset_sums() {
+        for (auto &data: threads) {
+            for (int stamp = 0; stamp < NB_STAMPS; stamp++)
+                data.sum_events[stamp] = data.sum_ticks[stamp] = 0;
+        }
+    }
+
+    const char *name(Stamp stamp) {
+        return STAMP_NAMES[stamp];
+    }
+
+    void stop() {
+        flush(-1);
+        detail::enabled = false;
+        summing = false;
+
+        if (tracing) {
+            tracing = false;
+            fprintf(trace_file, "],\"otherData\":{\"clock\":\"%s\",\"dropped_events\":%llu}}\n",
+                    use_tsc ? "tsc" : "steady_clock", (unsigned long long) dropped);
+            if (fclose(trace_file) != 0)
+                fprintf(stderr, "Error while writing the trace file\n");
+            trace_file = nullptr;
+            if (dropped > 0)
+                fprintf(stderr, "Warning: %llu trace events were dropped, increase the capacity of the trace "
+                                "buffers\n", (unsigned long long) dropped);
+        }
+
+        if (counting) {
+            counting = false;
+            if (fclose(counters_file) != 0)
+                fprintf(stderr, "Error while writing the counters file\n");
+            counters_file = nullptr;
+        }
+    }
+
+    Start begin() {
+        Start start;
+        start.time = now();
+        if (counting) {
+            ThreadData *data = thread_data();
+            if (data != nullptr) read_counters(*data, start.counters);
+        }
+        return start;
+    }
+
+    void record(Stamp stamp, const Start &start, int indiv_id) {
+        uint64_t end = now();
+        ThreadData *data = thread_data();
+        // More threads than data: their events are lost
+        if (data == nullptr) return;
+
+        if (summing) {
+            data->sum_events[stamp]++;
+            data->sum_ticks[stamp] += end - start.time;
+        }
+
+        if (counting) {
+            uint64_t counters[NB_COUNTERS];
+            read_counters(*data, counters);
+            Totals &totals = data->totals[stamp];
+            totals.nb_events++;
+            for (int counter = 0; counter < NB_COUNTERS; counter++)
+                totals.counters[counter] += counters[counter] - start.counters[counter];
+        }
+
+        // Not started before the tracing
+        if (tracing && start.time >= origin) {
+            data->events[data->head % capacity] = {start.time, end, stamp, indiv_id};
+            data->head++;
+        }
+    }
+
+    void flush(int generation) {
+        if (tracing) write_events(generation);
+        if (counting) write_counters(generation);
+    }
+}
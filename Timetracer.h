@@ -1,134 +1,97 @@
 #pragma once
 
-#ifdef TRACES
-
-#include <chrono>
-#include <iostream>
-#include <fstream>
-#include <vector>
-
-#ifdef OMP_USE
-
-#include <omp.h>
-
-#endif
-
-#define CSV_HEADER "Gen,Resource,Stamp,TimeStamp_Start,TimeStamp_End,Duration,Indiv_id"
-#define GET_TIME std::chrono::steady_clock::now().time_since_epoch().count()
-
-#ifdef OMP_USE
-#define GET_RESOURCE omp_get_thread_num()
-#define GET_MAX_RESOURCES omp_get_max_threads()
-#else
-#define GET_RESOURCE 0
-#define GET_MAX_RESOURCES 1
-#endif
-
+#include <cstdint>
+
+/**
+ * Tracing of the phases of the simulation, always compiled and switched on at runtime (see time_tracer::start).
+ *
+ * Each thread records its events in its own preallocated ring buffer, with TSC timestamps when the CPU has an
+ * invariant TSC (steady_clock nanoseconds otherwise). The buffers are written to a Chrome trace (JSON, readable by
+ * chrome://tracing and Perfetto) by FLUSH_TRACES, outside of the parallel regions. A buffer that fills up between two
+ * flushes overwrites its oldest events, whose number is reported at the end of the trace.
+ *
+ * The same stamps can also sample hardware counters (see time_tracer::start_counters), or only sum their durations
+ * (see time_tracer::start_sums).
+ *
+ * When tracing, counting and summing are off, a stamp costs a test of a flag.
+ */
 namespace time_tracer {
-    std::vector<const char *> stamp_name;
-
-    static std::ofstream trace_file;
-    static std::vector<long> *starts = nullptr;
-    static std::vector<long> *ends = nullptr;
-    static std::vector<int> *stamp_int = nullptr;
-    static std::vector<int> *indiv_id = nullptr;
-
-    static int nb_resources = 0;
-
-    static void init_tracer(const char *trace_file_name, std::vector<const char *> stamps) {
-        trace_file.open(trace_file_name, std::ofstream::trunc);
-        trace_file << CSV_HEADER << std::endl;
-
-        stamp_name = std::move(stamps);
-        nb_resources = GET_MAX_RESOURCES;
-
-        starts = new std::vector<long>[nb_resources];
-        ends = new std::vector<long>[nb_resources];
-        stamp_int = new std::vector<int>[nb_resources];
-        indiv_id = new std::vector<int>[nb_resources];
+    enum Stamp : int32_t {
+        FIRST_EVALUATION, STEP, FITNESS_GRID, SELECTION, MUTATION, EVALUATION, RNA, START_PROTEIN, PROTEIN,
+        TRANSLATION, PHENOTYPE, STATS, BACKUP, HALO_EXCHANGE, NB_STAMPS
+    };
+
+    /// Counters read by start_counters: CPU time (ns), cycles, instructions, last level cache misses, branch misses
+    constexpr int NB_COUNTERS = 5;
+
+    /// Events buffered per thread between two flushes
+    constexpr int DEFAULT_CAPACITY = 1 << 16;
+
+    /// Start tracing to trace_file_name, false (after printing the cause) if it cannot be opened
+    bool start(const char *trace_file_name, int capacity = DEFAULT_CAPACITY);
+
+    /**
+     * Count the counters of each thread with perf_event_open (Linux), and write their sums per stamp and generation
+     * to counters_file_name (CSV) at each flush. The counts of a stamp include those of the stamps nested in it.
+     * A counter the CPU or the kernel does not provide is left empty, the CPU time is always available.
+     *
+     * Each sample is a read() system call: the counts include its cost, which matters for the shortest stamps.
+     *
+     * @return false, after printing the cause, if the file cannot be opened or the counters are not available
+     */
+    bool start_counters(const char *counters_file_name);
+
+    /**
+     * Sum the number of events and the time of each stamp, over the threads (see sum). Cheaper than the counters: it
+     * only reads the clock.
+     */
+    void start_sums();
+
+    struct Sum {
+        uint64_t nb_events;
+        double seconds;
+    };
+
+    /// Sum of the events of a stamp since start_sums or reset_sums (not thread-safe)
+    Sum sum(Stamp stamp);
+
+    void reset_sums();
+
+    /// Name of a stamp, as in the trace and the counters file
+    const char *name(Stamp stamp);
+
+    /// Write the buffered events, close the trace and the counters file, and stop the sums
+    void stop();
+
+    /// Write the events and counts buffered since the last flush, as those of the given generation (not thread-safe)
+    void flush(int generation);
+
+    namespace detail {
+        extern bool enabled;
     }
 
-    static void stop_tracer() {
-        delete[] starts;
-        delete[] ends;
-        delete[] stamp_int;
-        starts = nullptr;
-        ends = nullptr;
-        stamp_int = nullptr;
-        indiv_id = nullptr;
-        nb_resources = 0;
-        stamp_name.clear();
-
-        trace_file.close();
-    }
+    inline bool enabled() { return detail::enabled; }
 
-    static void timestamp_start() {
-        starts[GET_RESOURCE].push_back(GET_TIME);
-    }
-
-    static void timestamp_end(int stamp_id) {
-        auto resource = GET_RESOURCE;
-        ends[resource].push_back(GET_TIME);
-        stamp_int[resource].push_back(stamp_id);
-        indiv_id[resource].push_back(-1);
-    }
+    /// Start of a stamp: time in ticks, and counters when they are on
+    struct Start {
+        uint64_t time;
+        uint64_t counters[NB_COUNTERS];
+    };
 
-    static void timestamp_end(int stamp_id, int id) {
-        auto resource = GET_RESOURCE;
-        ends[resource].push_back(GET_TIME);
-        stamp_int[resource].push_back(stamp_id);
-        indiv_id[resource].push_back(id);
-    }
-
-    static void set_traces() {
-        for (int i = 0; i < nb_resources; ++i) {
-            starts[i].clear();
-            ends[i].clear();
-            stamp_int[i].clear();
-        }
-    }
+    /// Start of a stamp of the calling thread
+    Start begin();
 
-    static void write_traces(int generation) {
-        for (int res = 0; res < nb_resources; ++res) {
-            for (int stamp = 0; stamp < stamp_int[res].size(); ++stamp) {
-                trace_file << generation
-                           << "," << (res + 1)
-                           << "," << stamp_name[stamp_int[res][stamp]]
-                           << "," << starts[res][stamp]
-                           << "," << ends[res][stamp]
-                           << "," << ends[res][stamp] - starts[res][stamp]
-                           << "," << indiv_id[res][stamp]
-                           << std::endl;
-            }
-        }
-        trace_file.flush();
-        set_traces();
-    }
+    /// Record an event of the calling thread, that lasted from start until now
+    void record(Stamp stamp, const Start &start, int indiv_id = -1);
 }
 
-#define INIT_TRACER(file_name, ...) time_tracer::init_tracer(file_name, __VA_ARGS__);
-
-#define TIMESTAMP(STAMP, BLOCK) { \
-time_tracer::timestamp_start(); \
-BLOCK \
-time_tracer::timestamp_end(STAMP); \
-}
+// Time a block of code (which may contain commas) as a STAMP event, of the organism of cell ID for TIMESTAMP_ID
+#define TIMESTAMP(STAMP, ...) TIMESTAMP_ID(STAMP, -1, __VA_ARGS__)
 
-#define TIMESTAMP_ID(STAMP, ID, BLOCK) { \
-time_tracer::timestamp_start(); \
-BLOCK \
-time_tracer::timestamp_end(STAMP, ID); \
+#define TIMESTAMP_ID(STAMP, ID, ...) { \
+const time_tracer::Start time_tracer_start = time_tracer::enabled() ? time_tracer::begin() : time_tracer::Start{}; \
+__VA_ARGS__ \
+if (time_tracer::enabled()) time_tracer::record(time_tracer::STAMP, time_tracer_start, ID); \
 }
 
-#define FLUSH_TRACES(generation) time_tracer::write_traces(generation);
-#define STOP_TRACER time_tracer::stop_tracer();
-
-#else //#ifndef TREACES
-
-#define INIT_TRACER(file_name, ...)
-#define TIMESTAMP(STAMP, BLOCK) BLOCK
-#define TIMESTAMP_ID(STAMP, ID, BLOCK) BLOCK
-#define FLUSH_TRACES(generation)
-#define STOP_TRACER
-
-#endif //TRACES
\ No newline at end of file
+#define FLUSH_TRACES(generation) if (time_tracer::enabled()) time_tracer::flush(generation);
@@ -0,0 +1,251 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include "TrajectoryChecker.h"
+
+#include <cinttypes>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace {
+    constexpr size_t RECORD_HEADER_SIZE = 2 * sizeof(int32_t) + 2 * sizeof(double);
+    constexpr size_t CELL_SIZE = sizeof(double) + sizeof(uint64_t);
+
+    size_t record_size(int nb_indivs) { return RECORD_HEADER_SIZE + nb_indivs * CELL_SIZE; }
+
+    /// Fitness as written in the stats files
+    std::string csv_value(double value) {
+        std::ostringstream out;
+        out << value;
+        return out.str();
+    }
+
+    /// Read the fitness (2nd column) of each generation (1st column) of a stats CSV file, false if it cannot be read
+    bool read_stats(const std::string &file_name, std::unordered_map<int, std::string> &fitness) {
+        std::ifstream file(file_name);
+        if (!file) {
+            fprintf(stderr, "Error: could not open stats file %s\n", file_name.c_str());
+            return false;
+        }
+
+        std::string line;
+        // Header
+        std::getline(file, line);
+        while (std::getline(file, line)) {
+            size_t first = line.find(',');
+            if (first == std::string::npos) continue;
+            size_t second = line.find(',', first + 1);
+            fitness[atoi(line.c_str())] = line.substr(first + 1, second == std::string::npos ? std::string::npos
+                                                                                              : second - first - 1);
+        }
+        return true;
+    }
+
+    bool same(double a, double b) { return memcmp(&a, &b, sizeof(a)) == 0; }
+}
+
+std::unique_ptr<TrajectoryChecker> TrajectoryChecker::record(const char *file_name) {
+    std::unique_ptr<TrajectoryChecker> checker(new TrajectoryChecker(RECORD, file_name));
+    checker->file_ = fopen(file_name, "wb");
+    if (checker->file_ == nullptr) {
+        fprintf(stderr, "Error: could not create trajectory file %s\n", file_name);
+        return nullptr;
+    }
+    return checker;
+}
+
+std::unique_ptr<TrajectoryChecker> TrajectoryChecker::verify(const char *reference_name) {
+    struct stat status;
+    if (stat(reference_name, &status) == 0 && S_ISDIR(status.st_mode)) {
+        std::unique_ptr<TrajectoryChecker> checker(new TrajectoryChecker(VERIFY_STATS, reference_name));
+        std::string directory(reference_name);
+        if (!read_stats(directory + "/stats_simd_best.csv", checker->best_fitness_) ||
+            !read_stats(directory + "/stats_simd_mean.csv", checker->mean_fitness_))
+            return nullptr;
+        return checker;
+    }
+
+    std::unique_ptr<TrajectoryChecker> checker(new TrajectoryChecker(VERIFY_TRAJECTORY, reference_name));
+    checker->file_ = fopen(reference_name, "rb");
+    if (checker->file_ == nullptr) {
+        fprintf(stderr, "Error: could not open trajectory file %s\n", reference_name);
+        return nullptr;
+    }
+
+    int32_t header[3];
+    if (fread(header, sizeof(header), 1, checker->file_) != 1 || header[0] != TRAJECTORY_MAGIC ||
+        header[1] != TRAJECTORY_VERSION || header[2] <= 0) {
+        fprintf(stderr, "Error: %s is not a trajectory file\n", reference_name);
+        return nullptr;
+    }
+    checker->nb_indivs_ = header[2];
+    checker->record_.resize(record_size(checker->nb_indivs_));
+    checker->has_record_ = fread(checker->record_.data(), checker->record_.size(), 1, checker->file_) == 1;
+    return checker;
+}
+
+TrajectoryChecker::~TrajectoryChecker() {
+    if (file_ != nullptr) fclose(file_);
+}
+
+bool TrajectoryChecker::check(int generation, int nb_indivs, const double *fitness, const uint64_t *hashes) {
+    double best = fitness[0];
+    double mean = 0;
+    for (int indiv_id = 0; indiv_id < nb_indivs; indiv_id++) {
+        if (fitness[indiv_id] > best) best = fitness[indiv_id];
+        mean += fitness[indiv_id];
+    }
+    mean /= nb_indivs;
+
+    bool ok;
+    if (mode_ == RECORD) {
+        if (nb_checked_ == 0) {
+            int32_t header[3] = {TRAJECTORY_MAGIC, TRAJECTORY_VERSION, nb_indivs};
+            fwrite(header, sizeof(header), 1, file_);
+        }
+
+        int32_t record_generation[2] = {generation, 0};
+        double values[2] = {best, mean};
+        fwrite(record_generation, sizeof(record_generation), 1, file_);
+        fwrite(values, sizeof(values), 1, file_);
+        for (int indiv_id = 0; indiv_id < nb_indivs; indiv_id++) {
+            fwrite(&fitness[indiv_id], sizeof(fitness[indiv_id]), 1, file_);
+            fwrite(&hashes[indiv_id], sizeof(hashes[indiv_id]), 1, file_);
+        }
+        ok = !ferror(file_);
+        if (!ok) fprintf(stderr, "Error while writing the trajectory file %s\n", file_name_.c_str());
+        nb_checked_++;
+    } else if (mode_ == VERIFY_TRAJECTORY) {
+        ok = check_trajectory(generation, nb_indivs, fitness, hashes, best, mean);
+    } else {
+        ok = check_stats(generation, best, mean);
+    }
+
+    if (first_generation_ < 0) first_generation_ = generation;
+    last_generation_ = generation;
+    return ok;
+}
+
+bool TrajectoryChecker::check_trajectory(int generation, int nb_indivs, const double *fitness,
+                                         const uint64_t *hashes, double best, double mean) {
+    int32_t reference_generation = 0;
+    // The records are in increasing order of generation
+    while (has_record_) {
+        memcpy(&reference_generation, record_.data(), sizeof(reference_generation));
+        if (reference_generation >= generation) break;
+        has_record_ = fread(record_.data(), record_.size(), 1, file_) == 1;
+    }
+    if (!has_record_ || reference_generation > generation) return true;
+
+    if (nb_indivs != nb_indivs_) {
+        printf("Divergence at generation %d: %d cells instead of %d\n", generation, nb_indivs, nb_indivs_);
+        return false;
+    }
+
+    const char *cells = record_.data() + RECORD_HEADER_SIZE;
+    for (int indiv_id = 0; indiv_id < nb_indivs; indiv_id++) {
+        double reference_fitness;
+        uint64_t reference_hash;
+        memcpy(&reference_fitness, cells + indiv_id * CELL_SIZE, sizeof(reference_fitness));
+        memcpy(&reference_hash, cells + indiv_id * CELL_SIZE + sizeof(double), sizeof(reference_hash));
+
+        if (hashes[indiv_id] != reference_hash) {
+            printf("Divergence at generation %d, cell %d: genome hash %016" PRIx64 " instead of %016" PRIx64 "\n",
+                   generation, indiv_id, hashes[indiv_id], reference_hash);
+            return false;
+        }
+        if (!same(fitness[indiv_id], reference_fitness)) {
+            printf("Divergence at generation %d, cell %d: fitness %.17g instead of %.17g (same genome)\n",
+                   generation, indiv_id, fitness[indiv_id], reference_fitness);
+            return false;
+        }
+    }
+
+    double reference_values[2];
+    memcpy(reference_values, record_.data() + 2 * sizeof(int32_t), sizeof(reference_values));
+    if (!same(best, reference_values[0]) || !same(mean, reference_values[1])) {
+        printf("Divergence at generation %d: best fitness %.17g and mean fitness %.17g instead of %.17g and %.17g\n",
+               generation, best, mean, reference_values[0], reference_values[1]);
+        return false;
+    }
+
+    nb_checked_++;
+    has_record_ = fread(record_.data(), record_.size(), 1, file_) == 1;
+    return true;
+}
+
+bool TrajectoryChecker::check_stats(int generation, double best, double mean) {
+    auto best_reference = best_fitness_.find(generation);
+    auto mean_reference = mean_fitness_.find(generation);
+    if (best_reference == best_fitness_.end() || mean_reference == mean_fitness_.end()) return true;
+
+    if (csv_value(best) != best_reference->second) {
+        printf("Divergence at generation %d: best fitness %s instead of %s\n", generation, csv_value(best).c_str(),
+               best_reference->second.c_str());
+        return false;
+    }
+    if (csv_value(mean) != mean_reference->second) {
+        printf("Divergence at generation %d: mean fitness %s instead of %s\n", generation, csv_value(mean).c_str(),
+               mean_reference->second.c_str());
+        return false;
+    }
+
+    nb_checked_++;
+    return true;
+}
+
+bool TrajectoryChecker::finish() {
+    if (mode_ == RECORD) {
+        bool ok = fclose(file_) == 0;
+        file_ = nullptr;
+        if (!ok) {
+            fprintf(stderr, "Error while writing the trajectory file %s\n", file_name_.c_str());
+            return false;
+        }
+        printf("Trajectory of generations %d to %d recorded to %s\n", first_generation_, last_generation_,
+               file_name_.c_str());
+        return true;
+    }
+
+    if (nb_checked_ == 0) {
+        printf("No generation of %d to %d is in the reference %s\n", first_generation_, last_generation_,
+               file_name_.c_str());
+        return false;
+    }
+    if (mode_ == VERIFY_STATS) {
+        // Only the generations with a row in the stats files were compared
+        printf("Stats verified against %s: the best and mean fitness of %d %s between generations %d and %d are "
+               "identical (the genomes were not compared)\n", file_name_.c_str(), nb_checked_,
+               nb_checked_ == 1 ? "row" : "rows", first_generation_, last_generation_);
+    } else {
+        printf("Trajectory verified against %s: %d %s between %d and %d %s identical\n", file_name_.c_str(),
+               nb_checked_, nb_checked_ == 1 ? "generation" : "generations", first_generation_, last_generation_,
+               nb_checked_ == 1 ? "is" : "are");
+    }
+    return true;
+}
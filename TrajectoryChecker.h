@@ -0,0 +1,106 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Golden trajectory of a simulation: the fitness and the genome hash (see Dna::hash) of every cell at each
+ * generation, recorded from a run and verified against by the later runs of the same simulation (same seed and
+ * parameters, or resumed from the same backup), whatever the engine (serial or threaded CPU, GPU).
+ *
+ * A trajectory file is a header {TRAJECTORY_MAGIC, TRAJECTORY_VERSION, number of cells} followed by a record per
+ * generation: {int32 generation, int32 0, double best fitness, double mean fitness, then for each cell its double
+ * fitness and its uint64 genome hash}. The best fitness is that of the first fittest cell, the mean is summed in the
+ * order of the cells, like in Stats.
+ *
+ * A run can also be verified against a stats directory (stats_simd_best.csv and stats_simd_mean.csv, see Stats): only
+ * the best and mean fitness are compared then, at the precision of the CSV files.
+ */
+class TrajectoryChecker {
+public:
+    /// Record the trajectory to file_name, nullptr (after printing the cause) if the file cannot be created
+    static std::unique_ptr<TrajectoryChecker> record(const char *file_name);
+
+    /// Verify against a trajectory file or a stats directory, nullptr (after printing the cause) if it cannot be read
+    static std::unique_ptr<TrajectoryChecker> verify(const char *reference_name);
+
+    TrajectoryChecker(const TrajectoryChecker &) = delete;
+
+    TrajectoryChecker &operator=(const TrajectoryChecker &) = delete;
+
+    ~TrajectoryChecker();
+
+    /**
+     * Record or verify a generation, from the fitness and the genome hash of each of its nb_indivs cells
+     *
+     * @return false, after printing the first diverging cell (the lowest one) or value, if it differs from the
+     * reference (or the record could not be written)
+     */
+    bool check(int generation, int nb_indivs, const double *fitness, const uint64_t *hashes);
+
+    /// Print a summary, false if the record could not be written or if no generation could be verified
+    bool finish();
+
+private:
+    enum Mode {
+        RECORD, VERIFY_TRAJECTORY, VERIFY_STATS
+    };
+
+    TrajectoryChecker(Mode mode, std::string file_name) : mode_(mode), file_name_(std::move(file_name)) {}
+
+    bool check_trajectory(int generation, int nb_indivs, const double *fitness, const uint64_t *hashes,
+                          double best, double mean);
+
+    bool check_stats(int generation, double best, double mean);
+
+    Mode mode_;
+    std::string file_name_;
+    FILE *file_ = nullptr;
+
+    // Verification against a trajectory: number of cells of the reference, and the next record, read ahead
+    int nb_indivs_ = 0;
+    std::vector<char> record_;
+    bool has_record_ = false;
+
+    // Verification against stats: the fitness of each generation, as written in the CSV files
+    std::unordered_map<int, std::string> best_fitness_;
+    std::unordered_map<int, std::string> mean_fitness_;
+
+    int first_generation_ = -1;
+    int last_generation_ = -1;
+    int nb_checked_ = 0;
+};
+
+// "AEVT": start of a trajectory file
+constexpr int32_t TRAJECTORY_MAGIC = 0x54564541;
+constexpr int32_t TRAJECTORY_VERSION = 1;
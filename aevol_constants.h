@@ -26,6 +26,12 @@ constexpr const char *PROTEIN_END = "001"; // CODON_STOP
 
 constexpr int32_t DO_TRANSLATION_LOOP = SHINE_DAL_SIZE + SD_START_SPACER + 3 * CODON_SIZE;
 
+// Rearrangements: the largest number of bases of a small insertion, and the bounds of the length of a genome (a
+// rearrangement that would leave them is not applied)
+constexpr int8_t MAX_INDEL_SIZE = 6;
+constexpr int32_t MIN_GENOME_LENGTH = 1000;
+constexpr int32_t MAX_GENOME_LENGTH = 1 << 24;
+
 // Codon
 constexpr int8_t CODON_START = 0b000;
 constexpr int8_t CODON_STOP  = 0b001;
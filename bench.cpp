@@ -0,0 +1,310 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "DnaMutator.h"
+#include "Gaussian.h"
+#include "Organism.h"
+#include "SelectionEngine.h"
+#include "SelectionPolicy.h"
+#include "Threefry.h"
+
+/**
+ * Micro-benchmarks of the evaluation pipeline: the motif searches of Dna, each stage of Organism::evaluate, the
+ * selection, the generation of the mutations and the cloning of an Organism.
+ *
+ * The organisms are those the simulation starts from (random genomes with a fitness better than nothing), drawn with
+ * fixed seeds, so that two runs benchmark the same genomes. The benchmarks are swept over genome lengths, mutation
+ * rates and grid sizes; the items per second are bases, mutations or cells.
+ *
+ * Usage: micro_aevol_bench [Google Benchmark options], e.g. --benchmark_filter=Evaluate --benchmark_format=json
+ */
+
+constexpr int SEED = 42;
+
+/// Genome lengths of the sweeps, the default length of the simulation included
+const std::vector<int64_t> LENGTHS = {1000, 5000, 20000, 100000};
+
+/// Mutation rates of the sweeps, as 1e-RATE_EXPONENT
+const std::vector<int64_t> RATE_EXPONENTS = {6, 5, 4, 3};
+
+namespace {
+    /// Environmental target of the simulation (see the ExpManager constructor)
+    const std::vector<double> &target() {
+        static const std::vector<double> target = [] {
+            Gaussian g1(1.2, 0.52, 0.12);
+            Gaussian g2(-1.4, 0.5, 0.07);
+            Gaussian g3(0.3, 0.8, 0.03);
+
+            std::vector<double> values(FUZZY_SAMPLING);
+            for (int i = 0; i < FUZZY_SAMPLING; i++) {
+                double pt_i = ((double) i) / (double) FUZZY_SAMPLING;
+                double tmp = g1.compute_y(pt_i) + g2.compute_y(pt_i) + g3.compute_y(pt_i);
+                tmp = tmp > Y_MAX ? Y_MAX : tmp;
+                tmp = tmp < Y_MIN ? Y_MIN : tmp;
+                values[i] = tmp;
+            }
+            return values;
+        }();
+        return target;
+    }
+
+    double geometric_area() {
+        double area = 0;
+        for (int i = 0; i < FUZZY_SAMPLING - 1; i++)
+            area += ((fabs(target()[i]) + fabs(target()[i + 1])) / (2 * (double) FUZZY_SAMPLING));
+        return area;
+    }
+
+    /// Evaluated organism of `length` bases better than nothing, the first drawn from SEED (cached per length)
+    std::shared_ptr<Organism> initial_organism(int length) {
+        static std::vector<std::pair<int, std::shared_ptr<Organism>>> cache;
+        for (const auto &entry: cache) {
+            if (entry.first == length) return entry.second;
+        }
+
+        Threefry rng(1, 1, SEED);
+        std::shared_ptr<Organism> organism;
+        double r_compare = 0;
+        while (r_compare >= 0) {
+            organism = std::make_shared<Organism>(length, rng.gen(0, Threefry::MUTATION));
+            organism->locate_promoters();
+            organism->evaluate(target().data());
+            r_compare = round((organism->metaerror - geometric_area()) * 1E10) / 1E10;
+        }
+
+        cache.emplace_back(length, organism);
+        return organism;
+    }
+
+    double mutation_rate(int64_t exponent) { return std::pow(10.0, -double(exponent)); }
+
+    /// Mutant of parent at the given rate (unevaluated, possibly without any mutation)
+    std::shared_ptr<Organism> mutant(const std::shared_ptr<Organism> &parent, double rate, Threefry &rng,
+                                     DnaMutator &mutator) {
+        auto gen = rng.gen(0, Threefry::MUTATION);
+        mutator.generate_mutations(gen, parent->length(), rate);
+        auto organism = std::make_shared<Organism>(parent);
+        if (mutator.hasMutate()) organism->apply_mutations(mutator.mutation_list_);
+        return organism;
+    }
+
+    void length_sweep(benchmark::internal::Benchmark *bench) {
+        bench->ArgName("length");
+        for (int64_t length: LENGTHS) bench->Arg(length);
+    }
+
+    void rate_sweep(benchmark::internal::Benchmark *bench) {
+        bench->ArgNames({"length", "rate_exp"})->ArgsProduct({LENGTHS, RATE_EXPONENTS});
+    }
+
+    double seconds_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+/// Access to the stages of Organism::evaluate
+struct OrganismBenchmark {
+    static void compute_RNA(Organism &organism) { organism.compute_RNA(); }
+
+    static void search_start_protein(Organism &organism) { organism.search_start_protein(); }
+
+    static void compute_protein(Organism &organism) { organism.compute_protein(); }
+
+    static void translate_protein(Organism &organism) { organism.translate_protein(); }
+
+    static void compute_phenotype(Organism &organism) { organism.compute_phenotype(target().data()); }
+
+    /// Number of stages of evaluate
+    static constexpr int NB_STAGES = 5;
+
+    static const char *stage_name(int stage) {
+        const char *names[NB_STAGES] = {"RNA", "StartProtein", "Protein", "Translation", "Phenotype"};
+        return names[stage];
+    }
+
+    /// Run the first `stage` stages of evaluate, then time the next one
+    static double time_stage(Organism &organism, int stage) {
+        void (*stages[NB_STAGES])(Organism &) = {compute_RNA, search_start_protein, compute_protein,
+                                                 translate_protein, compute_phenotype};
+        for (int i = 0; i < stage; i++) stages[i](organism);
+
+        auto start = std::chrono::steady_clock::now();
+        stages[stage](organism);
+        return seconds_since(start);
+    }
+};
+
+static void BM_PromoterAt(benchmark::State &state) {
+    const Dna &dna = *initial_organism(state.range(0))->dna_;
+    for (auto _: state) {
+        int sum = 0;
+        for (int pos = 0; pos < dna.length(); pos++) sum += dna.promoter_at(pos);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * dna.length());
+}
+BENCHMARK(BM_PromoterAt)->Apply(length_sweep);
+
+static void BM_TerminatorAt(benchmark::State &state) {
+    const Dna &dna = *initial_organism(state.range(0))->dna_;
+    for (auto _: state) {
+        int sum = 0;
+        for (int pos = 0; pos < dna.length(); pos++) sum += dna.terminator_at(pos);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * dna.length());
+}
+BENCHMARK(BM_TerminatorAt)->Apply(length_sweep);
+
+static void BM_LocatePromoters(benchmark::State &state) {
+    const Dna &dna = *initial_organism(state.range(0))->dna_;
+    for (auto _: state) {
+        Organism organism(new Dna(dna));
+        organism.locate_promoters();
+        benchmark::DoNotOptimize(organism.promoters_.size());
+    }
+    state.SetItemsProcessed(state.iterations() * dna.length());
+}
+BENCHMARK(BM_LocatePromoters)->Apply(length_sweep);
+
+/// One stage of evaluate (range(1)) on the initial organism, timed alone
+static void BM_EvaluateStage(benchmark::State &state) {
+    Organism organism(std::make_shared<Organism>(initial_organism(state.range(0))));
+    int stage = state.range(1);
+    state.SetLabel(OrganismBenchmark::stage_name(stage));
+    for (auto _: state) state.SetIterationTime(OrganismBenchmark::time_stage(organism, stage));
+    state.SetItemsProcessed(state.iterations() * organism.length());
+}
+BENCHMARK(BM_EvaluateStage)->ArgNames({"length", "stage"})
+        ->ArgsProduct({LENGTHS, benchmark::CreateDenseRange(0, OrganismBenchmark::NB_STAGES - 1, 1)})
+        ->UseManualTime();
+
+static void BM_Evaluate(benchmark::State &state) {
+    Organism organism(initial_organism(state.range(0)));
+    for (auto _: state) {
+        organism.evaluate(target().data());
+        benchmark::DoNotOptimize(organism.fitness);
+    }
+    state.SetItemsProcessed(state.iterations() * organism.length());
+}
+BENCHMARK(BM_Evaluate)->Apply(length_sweep);
+
+/// Evaluation of mutants by Organism::evaluate(target, parent) (the mutations are not timed)
+static void BM_EvaluateDelta(benchmark::State &state) {
+    auto parent = initial_organism(state.range(0));
+    double rate = mutation_rate(state.range(1));
+    Threefry rng(1, 1, SEED);
+    DnaMutator mutator;
+    for (auto _: state) {
+        auto organism = mutant(parent, rate, rng, mutator);
+        auto start = std::chrono::steady_clock::now();
+        organism->evaluate(target().data(), *parent);
+        state.SetIterationTime(seconds_since(start));
+        benchmark::DoNotOptimize(organism->fitness);
+    }
+    state.SetItemsProcessed(state.iterations() * parent->length());
+}
+BENCHMARK(BM_EvaluateDelta)->Apply(rate_sweep)->UseManualTime();
+
+static void BM_GenerateMutations(benchmark::State &state) {
+    int length = state.range(0);
+    double rate = mutation_rate(state.range(1));
+    Threefry rng(1, 1, SEED);
+    DnaMutator mutator;
+    for (auto _: state) {
+        auto gen = rng.gen(0, Threefry::MUTATION);
+        mutator.generate_mutations(gen, length, rate);
+        benchmark::DoNotOptimize(mutator.mutation_list_.data());
+    }
+    state.SetItemsProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_GenerateMutations)->Apply(rate_sweep);
+
+/// Clone of an organism, then the mutations (Organism::apply_mutations) the simulation applies to it
+static void BM_CloneAndMutate(benchmark::State &state) {
+    auto parent = initial_organism(state.range(0));
+    double rate = mutation_rate(state.range(1));
+    Threefry rng(1, 1, SEED);
+    DnaMutator mutator;
+    for (auto _: state) {
+        auto organism = mutant(parent, rate, rng, mutator);
+        benchmark::DoNotOptimize(organism.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CloneAndMutate)->Apply(rate_sweep);
+
+static void BM_Clone(benchmark::State &state) {
+    auto parent = initial_organism(state.range(0));
+    for (auto _: state) {
+        auto organism = std::make_shared<Organism>(parent);
+        benchmark::DoNotOptimize(organism.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Clone)->Apply(length_sweep);
+
+/**
+ * Selection of the reproducers of a square grid of side range(0) (see ExpManager::selection): the fitness grid, then
+ * a draw for each cell. The organisms are clones with random fitness.
+ */
+template<class Selection>
+static void BM_Selection(benchmark::State &state) {
+    int side = state.range(0);
+    int nb_indivs = side * side;
+    Threefry rng(side, side, SEED);
+
+    auto parent = initial_organism(LENGTHS[0]);
+    std::vector<std::shared_ptr<Organism>> population(nb_indivs);
+    for (int indiv_id = 0; indiv_id < nb_indivs; indiv_id++) {
+        population[indiv_id] = std::make_shared<Organism>(parent);
+        population[indiv_id]->fitness = rng.gen(indiv_id, Threefry::MUTATION).random();
+    }
+
+    SelectionEngine engine(side, side, Selection::WIDTH, Selection::WIDTH);
+    std::vector<int> reproducers(nb_indivs);
+    for (auto _: state) {
+        engine.prepare(population.data(), Selection::NEEDS_PROBABILITIES);
+        for (int indiv_id = 0; indiv_id < nb_indivs; indiv_id++) {
+            auto gen = rng.gen(indiv_id, Threefry::REPROD);
+            reproducers[indiv_id] = engine.neighbor(indiv_id, Selection::draw(engine, indiv_id, gen));
+        }
+        benchmark::DoNotOptimize(reproducers.data());
+    }
+    state.SetItemsProcessed(state.iterations() * nb_indivs);
+}
+BENCHMARK_TEMPLATE(BM_Selection, FitnessProportionalSelection<1>)->ArgName("side")->RangeMultiplier(2)->Range(16, 256);
+BENCHMARK_TEMPLATE(BM_Selection, TournamentSelection<1>)->ArgName("side")->RangeMultiplier(2)->Range(16, 256);
+BENCHMARK_TEMPLATE(BM_Selection, RankSelection<1>)->ArgName("side")->RangeMultiplier(2)->Range(16, 256);
+
+BENCHMARK_MAIN();
@@ -10,6 +10,7 @@
 #include <cmath>
 #include "nvToolsExt.h"
 #include <cuda_profiler_api.h>
+#include <vector>
 #include <zlib.h>
 
 #include "AeTime.h"
@@ -38,8 +39,17 @@ checkCuda(cudaGetLastError());
 #endif
 
 cuExpManager::cuExpManager(const ExpManager* cpu_exp) {
+    if (cpu_exp->selection_scheme_ != FITNESS_PROPORTIONAL || cpu_exp->selection_radius_ != 1) {
+        printf("Error: the GPU selection kernel only implements the fitness proportional selection of radius 1\n");
+        exit(EXIT_FAILURE);
+    }
+    if (cpu_exp->rearrangement_rate_ != 0.0) {
+        printf("Error: the GPU mutation kernel only implements the switches (no rearrangements)\n");
+        exit(EXIT_FAILURE);
+    }
+
     grid_height_ = cpu_exp->grid_height_;
-    grid_width_ = cpu_exp->grid_height_;
+    grid_width_ = cpu_exp->grid_width_;
 
     mutation_rate_ = cpu_exp->mutation_rate_;
 
@@ -47,12 +57,12 @@ cuExpManager::cuExpManager(const ExpManager* cpu_exp) {
 
     nb_indivs_ = grid_height_ * grid_width_;
 
-    genome_length_ = cpu_exp->internal_organisms_[0]->length();
+    genome_length_ = (*cpu_exp->population_)[0].length();
     host_individuals_ = new char *[nb_indivs_];
     for (int i = 0; i < nb_indivs_; ++i) {
         host_individuals_[i] = new char[genome_length_];
-        const auto& org = cpu_exp->internal_organisms_[i];
-        memcpy(host_individuals_[i], org->dna_->seq_.data(), genome_length_ * sizeof(char));
+        const Organism &org = (*cpu_exp->population_)[i];
+        org.dna_->to_char(host_individuals_[i]);
     }
 
     target_ = new double[FUZZY_SAMPLING];
@@ -119,6 +129,7 @@ void cuExpManager::run_evolution(int nb_gen) {
     swap(all_parent_genome_, all_child_genome_);
     check_result<<<1,1>>>(nb_indivs_, device_individuals_);
     CHECK_KERNEL
+    if (trajectory_checker_ != nullptr) check_trajectory();
 
     printf("Running evolution GPU from %d to %d\n", AeTime::time(), AeTime::time() + nb_gen);
     for (int gen = 0; gen < nb_gen; gen++) {
@@ -126,6 +137,7 @@ void cuExpManager::run_evolution(int nb_gen) {
         printf("Generation %d : \n",AeTime::time());
 
         run_a_step();
+        if (trajectory_checker_ != nullptr) check_trajectory();
 
         if (AeTime::time() % backup_step_ == 0) {
             save(AeTime::time());
@@ -138,6 +150,25 @@ void cuExpManager::run_evolution(int nb_gen) {
     cudaProfilerStop();
 }
 
+void cuExpManager::check_trajectory() {
+    CHECK_KERNEL
+    transfer_to_host();
+
+    std::vector<cuIndividual> individuals(nb_indivs_);
+    checkCuda(cudaMemcpy(individuals.data(), device_individuals_, nb_indivs_ * sizeof(cuIndividual),
+                         cudaMemcpyDeviceToHost));
+
+    std::vector<double> fitness(nb_indivs_);
+    std::vector<uint64_t> hashes(nb_indivs_);
+    for (int indiv_id = 0; indiv_id < nb_indivs_; ++indiv_id) {
+        fitness[indiv_id] = individuals[indiv_id].fitness;
+        hashes[indiv_id] = Dna::hash(host_individuals_[indiv_id], genome_length_);
+    }
+
+    if (!trajectory_checker_->check(AeTime::time(), nb_indivs_, fitness.data(), hashes.data()))
+        exit(EXIT_FAILURE);
+}
+
 void cuExpManager::save(int t) const {
     char exp_backup_file_name[255];
     sprintf(exp_backup_file_name, "backup/backup_%d.zae", t);
@@ -378,7 +409,7 @@ void selection(uint grid_height, uint grid_width, const cuIndividual* individual
             int cur_x = (grid_x + i + grid_width) % grid_width;
             int cur_y = (grid_y + j + grid_height) % grid_height;
 
-            local_fit_array[count] = individuals[cur_x * grid_width + cur_y].fitness;
+            local_fit_array[count] = individuals[cur_x * grid_height + cur_y].fitness;
             sum_local_fit += local_fit_array[count];
 
             count++;
@@ -389,11 +420,11 @@ void selection(uint grid_height, uint grid_width, const cuIndividual* individual
         local_fit_array[i] /= sum_local_fit;
     }
 
-    uint grid_idx = grid_x * grid_width + grid_y;
+    uint grid_idx = grid_x * grid_height + grid_y;
 
     auto selected_cell = rand_service->random_roulette(local_fit_array, NEIGHBORHOOD_SIZE, grid_idx, SELECTION);
 
-    int x_offset = (selected_cell / NEIGHBORHOOD_WIDTH) - 1;
+    int x_offset = (selected_cell / NEIGHBORHOOD_HEIGHT) - 1;
     int y_offset = (selected_cell % NEIGHBORHOOD_HEIGHT) - 1;
     int selected_x = (grid_x + x_offset + grid_width) % grid_width;
     int selected_y = (grid_y + y_offset + grid_height) % grid_height;
@@ -25,6 +25,9 @@ public:
 private:
     void run_a_step();
 
+    /// Check the current generation with the trajectory checker (the genomes are copied back from the device)
+    void check_trajectory();
+
     // Interface Host - Device
     void transfer_to_device();
     void transfer_to_host() const;
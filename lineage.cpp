@@ -0,0 +1,96 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+
+#include "Checkpoint.h"
+#include "LineageLog.h"
+
+/**
+ * Rebuild the genome of an organism from a lineage log (see LineageLog) and the nearest backup before it
+ *
+ * Usage: micro_aevol_lineage LINEAGE_FILE GENERATION CELL [GENOME_FILE]
+ * Run from the directory of the simulation (the backups are read from backup/). The genome is written as one line of
+ * 0 and 1 to GENOME_FILE, or to the standard output.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 4 || argc > 5) {
+        printf("Usage : %s LINEAGE_FILE GENERATION CELL [GENOME_FILE]\n", argv[0]);
+        printf("Rebuild the genome of the organism of CELL at GENERATION (see the -L option of micro_aevol_cpu)\n");
+        return EXIT_FAILURE;
+    }
+    int generation = atoi(argv[2]);
+    int indiv_id = atoi(argv[3]);
+
+    auto reader = LineageReader::open(argv[1]);
+    if (!reader)
+        return EXIT_FAILURE;
+    if (generation < reader->first_generation() || generation > reader->last_generation()) {
+        fprintf(stderr, "Error: %s logs the generations %d to %d\n", argv[1], reader->first_generation(),
+                reader->last_generation());
+        return EXIT_FAILURE;
+    }
+
+    // The last backup up to the generation
+    char backup_file_name[255];
+    int backup_time = generation;
+    for (; backup_time >= reader->first_generation(); backup_time--) {
+        sprintf(backup_file_name, "backup/backup_%d.zae", backup_time);
+        struct stat status;
+        if (stat(backup_file_name, &status) == 0) break;
+    }
+    if (backup_time < reader->first_generation()) {
+        fprintf(stderr, "Error: no backup of a generation between %d and %d\n", reader->first_generation(),
+                generation);
+        return EXIT_FAILURE;
+    }
+
+    auto checkpoint = Checkpoint::read(backup_file_name);
+    if (!checkpoint)
+        return EXIT_FAILURE;
+    auto organism = reader->rebuild(*checkpoint, generation, indiv_id);
+    if (!organism)
+        return EXIT_FAILURE;
+
+    FILE *genome_file = argc == 5 ? fopen(argv[4], "w") : stdout;
+    if (genome_file == nullptr) {
+        fprintf(stderr, "Error: could not create %s\n", argv[4]);
+        return EXIT_FAILURE;
+    }
+    std::vector<char> genome(organism->length());
+    organism->dna_->to_char(genome.data());
+    bool ok = fwrite(genome.data(), 1, genome.size(), genome_file) == genome.size() && fputc('\n', genome_file) != EOF;
+    ok = (genome_file == stdout ? fflush(genome_file) : fclose(genome_file)) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Error while writing the genome\n");
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Genome of cell %d at generation %d (%d bases) rebuilt from %s\n", indiv_id, generation,
+            organism->length(), backup_file_name);
+    return EXIT_SUCCESS;
+}
@@ -33,8 +33,21 @@
 #ifdef USE_CUDA
 #include "cuda/cuExpManager.h"
 #endif
+#ifdef USE_MPI
+#include <mpi.h>
+#include <string>
+
+#include "MpiExpManager.h"
+#endif
 #include "Abstract_ExpManager.h"
+#include "AeTime.h"
+#include "Ensemble.h"
 #include "ExpManager.h"
+#include "LineageLog.h"
+#include "ProgressLog.h"
+#include "ScalingBenchmark.h"
+#include "Timetracer.h"
+#include "TrajectoryChecker.h"
 
 void print_help(char* prog_path) {
     // Get the program file-name in prog_name (strip prog_path of the path)
@@ -71,20 +84,83 @@ void print_help(char* prog_path) {
     printf("  -b, --backup_step BACKUP_STEP\tDo a simulation backup/checkpoint every BACKUP_STEP\n");
     printf("  -r, --resume RESUME_STEP\tResume the simulation from the RESUME_STEP generations\n");
     printf("  -s, --seed SEED\tChange the seed for the pseudo random generator\n");
+    printf("  -I, --rearrangement_rate RATE\tRearrangements (small insertions, deletions, duplications and translocations) per base and generation (default 0)\n");
+    printf("  -f, --full_evaluation\tEvaluate every mutant from scratch instead of reusing the RNAs of its parent\n");
+    printf("  -E, --evaluation_cache ENTRIES\tReuse the evaluations of the last ENTRIES genomes evaluated for the mutants of the same genome (default 0, none)\n");
+    printf("  -N, --numa\tPin the threads on the NUMA nodes and keep the memory of each cell on the node evaluating it\n");
+    printf("  -a, --async_backup\tWrite the backups in the background while the simulation goes on\n");
+    printf("  -W, --no_backup_wait\tWith -a, abandon the backup being written at the end of the run instead of waiting for it\n");
+    printf("  -F, --backup_format FORMAT\tWrite the backups as FORMAT: gzip (default), chunked (zlib blocks), chunked-zstd, chunked-lz4 or mmap (uncompressed)\n");
+    printf("  -T, --stats_format FORMAT\tWrite the stats as FORMAT: csv (default) or binary (see micro_aevol_stats_to_csv)\n");
+    printf("  -t, --stats_step STATS_STEP\tWrite the stats every STATS_STEP generations (default 1)\n");
+    printf("  -P, --trace TRACE_FILE\tTrace the phases of the simulation to TRACE_FILE (Chrome trace JSON, for chrome://tracing or Perfetto)\n");
+    printf("  -B, --benchmark REPORT_FILE\tRun NB_GENERATIONS without stats nor backups for every number of threads and grid size below, and write their speed and that of each phase to REPORT_FILE (CSV)\n");
+    printf("  -j, --bench_threads LIST\tWith -B, the comma-separated numbers of threads (default 1, 2, 4... up to the number of cores)\n");
+    printf("  -G, --bench_grids LIST\tWith -B, the comma-separated WIDTHxHEIGHT grid sizes (default the one of -w and -h)\n");
+    printf("  -Y, --record_trajectory FILE\tRecord the fitness and the genome hash of every cell at each generation to FILE, a reference for -V\n");
+    printf("  -V, --verify REFERENCE\tVerify each generation against REFERENCE, a file of -Y or a stats directory (fitness only), and report the first divergence (e.g. with OMP_NUM_THREADS=1, then more threads, or on the GPU)\n");
+    printf("  -L, --lineage LINEAGE_FILE\tLog the reproducer and the mutations of every cell at each generation to LINEAGE_FILE, from which micro_aevol_lineage rebuilds any organism\n");
+    printf("  -C, --perf_counters COUNTERS_FILE\tCount the CPU time, cycles, instructions, cache and branch misses of each phase, per generation, to COUNTERS_FILE (CSV)\n");
+    printf("  -D, --delta_backup PERIOD\tWrite the backups as deltas from the previous one, with a full backup every PERIOD backups\n");
+    printf("  -e, --ensemble NB_SEEDS\tRun NB_SEEDS replicates (seeds SEED, SEED + 1...) for each mutation rate of -M in one process, in the directories replicate_K, with a summary in ensemble.csv\n");
+    printf("  -M, --ensemble_rates LIST\tWith -e, the comma-separated mutation rates of the replicates (default the one of -m)\n");
+    printf("  -v, --verbosity LEVEL\tProgress messages: 0 none, 1 the best fitness of each generation and the backups (default), 2 with the speed of the run\n");
+    printf("  -p, --progress_step STEP\tPrint the progress of the generations that are multiples of STEP only (default 1)\n");
+    printf("  -i, --progress_interval SECONDS\tPrint the progress at most every SECONDS seconds (default 0, no limit)\n");
+    printf("  -O, --progress_file FILE\tRewrite the progress of the run (JSON) to FILE every second, for a job monitor\n");
+    printf("  -S, --selection SCHEME\tSelect the reproducers with SCHEME: fitness (proportional, default), tournament or rank\n");
+    printf("  -R, --radius RADIUS\tThe selection neighbourhood is the square of side 2 * RADIUS + 1 (from 1 to %d, default 1)\n",
+           MAX_SELECTION_RADIUS);
 }
 
 int main(int argc, char* argv[]) {
+#ifdef USE_MPI
+    // Only the main thread of a rank communicates
+    int thread_support;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support);
+    int rank, nb_ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nb_ranks);
+    // Rank 0 prints for all of them
+    if (rank != 0 && freopen("/dev/null", "w", stdout) == nullptr)
+        exit(EXIT_FAILURE);
+#endif
 
     int nbstep = -1;
     int width = -1;
     int height = -1;
     double mutation_rate = -1;
+    double rearrangement_rate = -1;
     int genome_size = -1;
     int resume = -1;
     int backup_step = -1;
     int seed = -1;
+    bool full_evaluation = false;
+    int cache_entries = 0;
+    bool numa = false;
+    int selection_scheme = -1;
+    int selection_radius = -1;
+    bool async_backup = false;
+    bool wait_backup = true;
+    Checkpoint::Format backup_format = Checkpoint::GZIP;
+    int full_backup_period = 0;
+    Stats::Format stats_format = Stats::CSV;
+    int stats_step = 1;
+    const char *trace_file_name = nullptr;
+    const char *counters_file_name = nullptr;
+    const char *benchmark_file_name = nullptr;
+    const char *trajectory_file_name = nullptr;
+    const char *reference_name = nullptr;
+    const char *lineage_file_name = nullptr;
+    ScalingBenchmark benchmark;
+    int nb_seeds = 0;
+    std::vector<double> ensemble_rates;
+    int verbosity = 1;
+    int progress_step = 1;
+    double progress_interval = 0.0;
+    const char *progress_file_name = nullptr;
 
-    const char * options_list = "Hn:w:h:m:g:b:r:s:";
+    const char * options_list = "Hn:w:h:m:I:g:b:r:s:fE:NS:R:aWF:D:T:t:P:C:B:j:G:Y:V:L:e:M:v:p:i:O:";
     static struct option long_options_list[] = {
             // Print help
             { "help",     no_argument,        NULL, 'H' },
@@ -96,6 +172,8 @@ int main(int argc, char* argv[]) {
             { "height", required_argument,  NULL, 'h' },
             // Mutation rate
             { "mutation_rate", required_argument,  NULL, 'm' },
+            // Rearrangement rate
+            { "rearrangement_rate", required_argument,  NULL, 'I' },
             // Size of the initial genome
             { "genome_size", required_argument,  NULL, 'g' },
             // Resuming from generation X
@@ -104,6 +182,44 @@ int main(int argc, char* argv[]) {
             { "backup_step", required_argument,  NULL, 'b' },
             // Seed
             { "seed", required_argument,  NULL, 's' },
+            // Evaluate mutants from scratch
+            { "full_evaluation", no_argument,  NULL, 'f' },
+            // Evaluation cache
+            { "evaluation_cache", required_argument,  NULL, 'E' },
+            // NUMA placement
+            { "numa", no_argument,  NULL, 'N' },
+            // Selection scheme and neighbourhood
+            { "selection", required_argument,  NULL, 'S' },
+            { "radius", required_argument,  NULL, 'R' },
+            // Background backups
+            { "async_backup", no_argument,  NULL, 'a' },
+            { "no_backup_wait", no_argument,  NULL, 'W' },
+            // Backup format
+            { "backup_format", required_argument,  NULL, 'F' },
+            { "delta_backup", required_argument,  NULL, 'D' },
+            // Stats format
+            { "stats_format", required_argument,  NULL, 'T' },
+            { "stats_step", required_argument,  NULL, 't' },
+            // Tracing
+            { "trace", required_argument,  NULL, 'P' },
+            { "perf_counters", required_argument,  NULL, 'C' },
+            // Trajectory
+            { "record_trajectory", required_argument,  NULL, 'Y' },
+            { "verify", required_argument,  NULL, 'V' },
+            // Lineage
+            { "lineage", required_argument,  NULL, 'L' },
+            // Scaling benchmark
+            { "benchmark", required_argument,  NULL, 'B' },
+            { "bench_threads", required_argument,  NULL, 'j' },
+            { "bench_grids", required_argument,  NULL, 'G' },
+            // Ensemble of replicates
+            { "ensemble", required_argument,  NULL, 'e' },
+            { "ensemble_rates", required_argument,  NULL, 'M' },
+            // Progress messages
+            { "verbosity", required_argument,  NULL, 'v' },
+            { "progress_step", required_argument,  NULL, 'p' },
+            { "progress_interval", required_argument,  NULL, 'i' },
+            { "progress_file", required_argument,  NULL, 'O' },
             { 0, 0, 0, 0 }
     };
 
@@ -132,6 +248,14 @@ int main(int argc, char* argv[]) {
                 mutation_rate = atof(optarg);
                 break;
             }
+            case 'I' : {
+                rearrangement_rate = atof(optarg);
+                if (rearrangement_rate < 0.0 || rearrangement_rate > 1.0) {
+                    printf("Error the rearrangement rate must be in [0, 1]\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
             case 'g' : {
                 genome_size = atoi(optarg);
                 break;
@@ -152,6 +276,170 @@ int main(int argc, char* argv[]) {
                 nbstep = atoi(optarg);
                 break;
             }
+            case 'f' : {
+                full_evaluation = true;
+                break;
+            }
+            case 'E' : {
+                cache_entries = atoi(optarg);
+                if (cache_entries < 0) {
+                    printf("Error the number of entries of the evaluation cache can not be negative\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'N' : {
+                numa = true;
+                break;
+            }
+            case 'a' : {
+                async_backup = true;
+                break;
+            }
+            case 'W' : {
+                wait_backup = false;
+                break;
+            }
+            case 'F' : {
+                if (strcmp(optarg, "gzip") == 0) backup_format = Checkpoint::GZIP;
+                else if (strcmp(optarg, "chunked") == 0) backup_format = Checkpoint::CHUNKED_ZLIB;
+                else if (strcmp(optarg, "chunked-zstd") == 0) backup_format = Checkpoint::CHUNKED_ZSTD;
+                else if (strcmp(optarg, "chunked-lz4") == 0) backup_format = Checkpoint::CHUNKED_LZ4;
+                else if (strcmp(optarg, "mmap") == 0) backup_format = Checkpoint::MAPPED;
+                else {
+                    printf("Error unknown backup format %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                if (!Checkpoint::format_available(backup_format)) {
+                    printf("Error the backup format %s is not available in this build\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'D' : {
+                full_backup_period = atoi(optarg);
+                if (full_backup_period < 1) {
+                    printf("Error the period of the full backups must be at least 1\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'T' : {
+                if (strcmp(optarg, "csv") == 0) stats_format = Stats::CSV;
+                else if (strcmp(optarg, "binary") == 0) stats_format = Stats::BINARY;
+                else {
+                    printf("Error unknown stats format %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 't' : {
+                stats_step = atoi(optarg);
+                if (stats_step < 1) {
+                    printf("Error the stats step must be at least 1\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'P' : {
+                trace_file_name = optarg;
+                break;
+            }
+            case 'C' : {
+                counters_file_name = optarg;
+                break;
+            }
+            case 'Y' : {
+                trajectory_file_name = optarg;
+                break;
+            }
+            case 'V' : {
+                reference_name = optarg;
+                break;
+            }
+            case 'L' : {
+                lineage_file_name = optarg;
+                break;
+            }
+            case 'B' : {
+                benchmark_file_name = optarg;
+                break;
+            }
+            case 'j' : {
+                if (!ScalingBenchmark::parse_thread_counts(optarg, benchmark.thread_counts)) {
+                    printf("Error the numbers of threads must be a comma-separated list of positive integers\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'G' : {
+                if (!ScalingBenchmark::parse_grids(optarg, benchmark.grids)) {
+                    printf("Error the grid sizes must be a comma-separated list of WIDTHxHEIGHT\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'e' : {
+                nb_seeds = atoi(optarg);
+                if (nb_seeds < 1) {
+                    printf("Error the ensemble needs at least one seed\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'M' : {
+                if (!Ensemble::parse_rates(optarg, ensemble_rates)) {
+                    printf("Error the mutation rates must be a comma-separated list of rates in [0, 1]\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'v' : {
+                verbosity = atoi(optarg);
+                if (verbosity < 0 || verbosity > 2) {
+                    printf("Error the verbosity must be 0, 1 or 2\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'p' : {
+                progress_step = atoi(optarg);
+                if (progress_step < 1) {
+                    printf("Error the progress step must be a positive number of generations\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'i' : {
+                progress_interval = atof(optarg);
+                if (progress_interval < 0) {
+                    printf("Error the progress interval must be a non-negative number of seconds\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'O' : {
+                progress_file_name = optarg;
+                break;
+            }
+            case 'S' : {
+                if (strcmp(optarg, "fitness") == 0) selection_scheme = FITNESS_PROPORTIONAL;
+                else if (strcmp(optarg, "tournament") == 0) selection_scheme = TOURNAMENT;
+                else if (strcmp(optarg, "rank") == 0) selection_scheme = RANK;
+                else {
+                    printf("Error unknown selection scheme %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'R' : {
+                selection_radius = atoi(optarg);
+                if (selection_radius < 1 || selection_radius > MAX_SELECTION_RADIUS) {
+                    printf("Error the selection radius must be in [1, %d]\n", MAX_SELECTION_RADIUS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
             default : {
                 // An error message is printed in getopt_long, we just need to exit
                 printf("Error unknown parameter\n");
@@ -163,12 +451,36 @@ int main(int argc, char* argv[]) {
 #ifdef USE_CUDA
     printf("Activate CUDA\n");
 #endif
+    // Whether the mutants are evaluated by the ExpManager of the host
+#if defined(USE_MPI) || defined(USE_CUDA)
+    const bool host_evaluation = false;
+#else
+    const bool host_evaluation = true;
+#endif
+    if (cache_entries > 0 && !host_evaluation) {
+        fprintf(stderr, "Error the evaluation cache needs the evaluations on the host (the CPU build)\n");
+        exit(EXIT_FAILURE);
+    }
+    if (numa && !host_evaluation) {
+        fprintf(stderr, "Error the NUMA placement needs the evaluations on the host (the CPU build)\n");
+        exit(EXIT_FAILURE);
+    }
+    if (lineage_file_name != nullptr && !host_evaluation) {
+        fprintf(stderr, "Error the lineage log needs the evaluations on the host (the CPU build)\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((verbosity != 1 || progress_step != 1 || progress_interval > 0 || progress_file_name != nullptr) &&
+        !host_evaluation) {
+        fprintf(stderr, "Error the progress options need the evaluations on the host (the CPU build)\n");
+        exit(EXIT_FAILURE);
+    }
 
     printf("Start ExpManager\n");
 
     if (resume >= 0) {
         if ((width != -1) || (height != -1)|| (mutation_rate != -1.0) || (genome_size != -1) ||
-            (backup_step != -1) || (seed != -1)) {
+            (backup_step != -1) || (seed != -1) || (selection_scheme != -1) || (selection_radius != -1) ||
+            (rearrangement_rate != -1.0)) {
             printf("Parameter(s) can not change during the simulation (i.e. when resuming a simulation, parameter(s) can not change)\n");
             exit(EXIT_FAILURE);
         }
@@ -181,26 +493,188 @@ int main(int argc, char* argv[]) {
         if (genome_size == -1) genome_size = 5000;
         if (backup_step == -1) backup_step = 1000;
         if (seed == -1) seed = 566545665;
+        if (selection_scheme == -1) selection_scheme = FITNESS_PROPORTIONAL;
+        if (selection_radius == -1) selection_radius = 1;
+        if (rearrangement_rate == -1) rearrangement_rate = 0.0;
+    }
+
+    if (benchmark_file_name != nullptr) {
+#ifdef USE_MPI
+        fprintf(stderr, "Error the benchmark is not available in the MPI build\n");
+        exit(EXIT_FAILURE);
+#endif
+        if (resume >= 0) {
+            printf("Error a benchmark can not resume a simulation\n");
+            exit(EXIT_FAILURE);
+        }
+        benchmark.nb_gen = nbstep;
+        benchmark.mutation_rate = mutation_rate;
+        benchmark.genome_size = genome_size;
+        benchmark.seed = seed;
+        benchmark.selection_scheme = static_cast<SelectionScheme>(selection_scheme);
+        benchmark.selection_radius = selection_radius;
+        benchmark.delta_evaluation = !full_evaluation;
+        if (benchmark.thread_counts.empty()) benchmark.thread_counts = ScalingBenchmark::default_thread_counts();
+        if (benchmark.grids.empty()) benchmark.grids.emplace_back(width, height);
+        benchmark.reserve_threads();
+
+        if (trace_file_name != nullptr && !time_tracer::start(trace_file_name))
+            exit(EXIT_FAILURE);
+        if (counters_file_name != nullptr && !time_tracer::start_counters(counters_file_name))
+            exit(EXIT_FAILURE);
+
+        bool done = benchmark.run(benchmark_file_name);
+        time_tracer::stop();
+        return done ? 0 : EXIT_FAILURE;
+    }
+
+    if (nb_seeds > 0 || !ensemble_rates.empty()) {
+#ifdef USE_MPI
+        fprintf(stderr, "Error the ensemble is not available in the MPI build\n");
+        exit(EXIT_FAILURE);
+#endif
+        if (resume >= 0) {
+            printf("Error an ensemble can not resume a simulation\n");
+            exit(EXIT_FAILURE);
+        }
+        if (trajectory_file_name != nullptr || reference_name != nullptr || lineage_file_name != nullptr ||
+            trace_file_name != nullptr || counters_file_name != nullptr) {
+            printf("Error the replicates of an ensemble can not be traced, verified nor logged\n");
+            exit(EXIT_FAILURE);
+        }
+        if (numa || cache_entries > 0 || full_backup_period > 1) {
+            printf("Error the replicates of an ensemble have no NUMA placement, evaluation cache nor delta backups\n");
+            exit(EXIT_FAILURE);
+        }
+
+        Ensemble ensemble;
+        ensemble.nb_gen = nbstep;
+        ensemble.width = width;
+        ensemble.height = height;
+        ensemble.genome_size = genome_size;
+        ensemble.backup_step = backup_step;
+        ensemble.seed = seed;
+        ensemble.nb_seeds = nb_seeds > 0 ? nb_seeds : 1;
+        ensemble.mutation_rates = ensemble_rates.empty() ? std::vector<double>{mutation_rate} : ensemble_rates;
+        ensemble.rearrangement_rate = rearrangement_rate;
+        ensemble.selection_scheme = static_cast<SelectionScheme>(selection_scheme);
+        ensemble.selection_radius = selection_radius;
+        ensemble.delta_evaluation = !full_evaluation;
+        ensemble.async_backup = async_backup;
+        ensemble.backup_format = backup_format;
+        ensemble.stats_format = stats_format;
+        ensemble.stats_step = stats_step;
+        ensemble.verbosity = verbosity;
+        ensemble.progress_step = progress_step;
+        ensemble.progress_interval = progress_interval;
+        ensemble.progress_file = progress_file_name != nullptr ? progress_file_name : "";
+        return ensemble.run("ensemble.csv") ? 0 : EXIT_FAILURE;
     }
 
-    Abstract_ExpManager *exp_manager;
+#ifdef USE_MPI
+    if (rearrangement_rate > 0.0) {
+        fprintf(stderr, "Error the rearrangements are not available in the MPI build\n");
+        exit(EXIT_FAILURE);
+    }
+    if (async_backup || !wait_backup || full_backup_period > 1) {
+        fprintf(stderr, "Error the asynchronous and delta backups are not available in the MPI build\n");
+        exit(EXIT_FAILURE);
+    }
+
+    MpiExpManager *mpi_exp_manager;
     if (resume == -1) {
-        exp_manager = new ExpManager(height, width, seed, mutation_rate, genome_size, backup_step);
+        mpi_exp_manager = new MpiExpManager(height, width, seed, mutation_rate, genome_size, backup_step,
+                                            static_cast<SelectionScheme>(selection_scheme), selection_radius);
     } else {
         printf("Resuming...\n");
-        exp_manager = new ExpManager(resume);
+        mpi_exp_manager = new MpiExpManager(resume);
     }
+    mpi_exp_manager->set_delta_evaluation(!full_evaluation);
+    mpi_exp_manager->set_backup_format(backup_format);
+    mpi_exp_manager->set_stats_format(stats_format);
+    mpi_exp_manager->set_stats_step(stats_step);
+
+    Abstract_ExpManager *exp_manager = mpi_exp_manager;
+
+    // The checker is on rank 0, which gathers the trajectory, and each rank traces to its own files
+    if (rank != 0) {
+        trajectory_file_name = nullptr;
+        reference_name = nullptr;
+    }
+    std::string trace_file, counters_file;
+    if (nb_ranks > 1 && trace_file_name != nullptr) {
+        trace_file = std::string(trace_file_name) + ".rank_" + std::to_string(rank);
+        trace_file_name = trace_file.c_str();
+    }
+    if (nb_ranks > 1 && counters_file_name != nullptr) {
+        counters_file = std::string(counters_file_name) + ".rank_" + std::to_string(rank);
+        counters_file_name = counters_file.c_str();
+    }
+#else
+    ExpManager *cpu_exp_manager;
+    if (resume == -1) {
+        cpu_exp_manager = new ExpManager(height, width, seed, mutation_rate, genome_size, backup_step,
+                                         static_cast<SelectionScheme>(selection_scheme), selection_radius);
+        cpu_exp_manager->set_rearrangement_rate(rearrangement_rate);
+    } else {
+        printf("Resuming...\n");
+        cpu_exp_manager = new ExpManager(resume);
+    }
+    cpu_exp_manager->set_delta_evaluation(!full_evaluation);
+    cpu_exp_manager->set_async_backup(async_backup, wait_backup);
+    cpu_exp_manager->set_backup_format(backup_format);
+    cpu_exp_manager->set_delta_backup(full_backup_period);
+    cpu_exp_manager->set_stats_format(stats_format);
+    cpu_exp_manager->set_stats_step(stats_step);
+    cpu_exp_manager->set_evaluation_cache(cache_entries);
+    cpu_exp_manager->set_numa(numa);
+    if (lineage_file_name != nullptr) {
+        auto lineage_log = LineageLog::create(lineage_file_name, cpu_exp_manager->nb_indivs(), AeTime::time());
+        if (!lineage_log)
+            exit(EXIT_FAILURE);
+        cpu_exp_manager->set_lineage_log(std::move(lineage_log));
+    }
+    cpu_exp_manager->set_progress_log(std::unique_ptr<ProgressLog>(
+            new ProgressLog(verbosity, progress_step, progress_interval,
+                            progress_file_name != nullptr ? progress_file_name : "")));
+
+    Abstract_ExpManager *exp_manager = cpu_exp_manager;
 
 #ifdef USE_CUDA
     // Not very clean but the goal is to re-use the initialization on the host to transfer data to device
     auto* tmp = dynamic_cast<ExpManager *>(exp_manager);
     exp_manager = new cuExpManager(tmp);
     delete tmp;
+#endif
 #endif
 
+    if (trajectory_file_name != nullptr && reference_name != nullptr) {
+        printf("Error a run can not both record and verify a trajectory\n");
+        exit(EXIT_FAILURE);
+    }
+    std::unique_ptr<TrajectoryChecker> trajectory_checker;
+    if (trajectory_file_name != nullptr) trajectory_checker = TrajectoryChecker::record(trajectory_file_name);
+    if (reference_name != nullptr) trajectory_checker = TrajectoryChecker::verify(reference_name);
+    if ((trajectory_file_name != nullptr || reference_name != nullptr) && !trajectory_checker)
+        exit(EXIT_FAILURE);
+    exp_manager->set_trajectory_checker(trajectory_checker.get());
+
+    if (trace_file_name != nullptr && !time_tracer::start(trace_file_name))
+        exit(EXIT_FAILURE);
+    if (counters_file_name != nullptr && !time_tracer::start_counters(counters_file_name))
+        exit(EXIT_FAILURE);
+
     exp_manager->run_evolution(nbstep);
 
+    time_tracer::stop();
+
+    if (trajectory_checker && !trajectory_checker->finish())
+        exit(EXIT_FAILURE);
+
     delete exp_manager;
 
+#ifdef USE_MPI
+    MPI_Finalize();
+#endif
     return 0;
 }
@@ -0,0 +1,58 @@
+// ***************************************************************************************************************
+//
+//          Mini-Aevol is a reduced version of Aevol -- An in silico experimental evolution platform
+//
+// ***************************************************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package or <https://gitlab.inria.fr/rouzaudc/mini-aevol>
+// Web: https://gitlab.inria.fr/rouzaudc/mini-aevol
+// E-mail: See <jonathan.rouzaud-cornabas@inria.fr>
+// Original Authors : Jonathan Rouzaud-Cornabas
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ***************************************************************************************************************
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "Stats.h"
+
+/**
+ * Convert a binary stats file (see Stats) to CSV
+ *
+ * Usage: micro_aevol_stats_to_csv STATS_FILE [CSV_FILE]
+ * CSV_FILE defaults to STATS_FILE with its .bin extension replaced by .csv
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        printf("Usage : %s STATS_FILE [CSV_FILE]\n", argv[0]);
+        printf("Convert a binary stats file (e.g. stats/stats_simd_best.bin) to CSV\n");
+        return EXIT_FAILURE;
+    }
+
+    std::string csv_file_name;
+    if (argc == 3) {
+        csv_file_name = argv[2];
+    } else {
+        csv_file_name = argv[1];
+        size_t extension = csv_file_name.rfind(".bin");
+        if (extension != std::string::npos && extension + 4 == csv_file_name.size())
+            csv_file_name.erase(extension);
+        csv_file_name += ".csv";
+    }
+
+    return Stats::to_csv(argv[1], csv_file_name.c_str()) ? EXIT_SUCCESS : EXIT_FAILURE;
+}